@@ -0,0 +1,170 @@
+﻿# Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+# Loopback soak of TFPP movement: starts a dedicated server with -TfppSoak and N headless bot clients on 127.0.0.1,
+# waits for the server to write its report, then compares the runs. See UTfppSoakSubsystem for what is measured.
+#
+# Usage:
+#   python TfppSoak.py --exe <UnrealEditor or packaged binary> [--project Game.uproject] --map /Game/Maps/Soak
+#                      [--bots 8] [--warmup 10] [--duration 60] [--runs 3] [--port 7777] [--report Soak.csv]
+#                      [--variant Label="-ServerArg ..."]...
+#
+# Every --variant is run --runs times with its arguments added to the server command line, and the variants are
+# compared with each other. For instance the dedicated server profile of the TFPP settings:
+#   --variant Off="-ini:Game:[/Script/TfppSystem.TfppDevSettings]:bUseDedicatedServerProfile=False"
+#   --variant On="-ini:Game:[/Script/TfppSystem.TfppDevSettings]:bUseDedicatedServerProfile=True"
+# or the bandwidth of a replication graph using UTfppReplicationGraphNode_FirstPersonView against the default
+# replication, compared through OutBytesPerSecond:
+#   --variant Default="-ini:Engine:[/Script/OnlineSubsystemUtils.IpNetDriver]:ReplicationDriverClassName="
+#   --variant Graph="-ini:Engine:[/Script/OnlineSubsystemUtils.IpNetDriver]:ReplicationDriverClassName=/Script/Game.GameReplicationGraph"
+#
+# With an editor binary pass --project, the server then runs with -server and the bots with -game. Every bot gets
+# the seed --seed + its index, so a run replays the same bot decisions as the previous ones. Server and bots cap
+# their frame rate (--server-tick-rate, --bot-fps) so the load doesn't depend on how fast the machine is.
+
+import argparse
+import csv
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+COMPARED_COLUMNS = ["TickAvgMs", "TickMsPerBot", "TickP95Ms", "TickP99Ms", "InBytesPerSecond", "OutBytesPerSecond",
+                    "CorrectionsPerBotMinute", "OutOfBandCorrectionsPerBotMinute"]
+
+
+def base_command(args):
+    command = [args.exe]
+    if args.project:
+        command.append(os.path.abspath(args.project))
+    return command
+
+
+def start_server(args, log_dir, run, server_args):
+    command = base_command(args) + [
+        args.map,
+        "-server" if args.project else "",
+        "-log", "-unattended", "-nullrhi", "-nosound",
+        f"-port={args.port}",
+        f"-ini:Engine:[/Script/OnlineSubsystemUtils.IpNetDriver]:NetServerMaxTickRate={args.server_tick_rate}",
+        "-TfppSoak", "-TfppSoakExit",
+        f"-TfppSoakBots={args.bots}",
+        f"-TfppSoakWarmup={args.warmup}",
+        f"-TfppSoakDuration={args.duration}",
+        f"-TfppSoakReport={os.path.abspath(args.report)}",
+        f"-abslog={os.path.join(log_dir, f'Server-{run}.log')}",
+    ] + server_args
+    return subprocess.Popen([part for part in command if part])
+
+
+def start_bot(args, log_dir, run, index):
+    command = base_command(args) + [
+        f"127.0.0.1:{args.port}",
+        "-game" if args.project else "",
+        "-log", "-unattended", "-nullrhi", "-nosound", "-windowed", "-ResX=320", "-ResY=240",
+        f"-TfppSoakBot={args.seed + index}",
+        f"-ExecCmds=t.MaxFPS {args.bot_fps}",
+        f"-abslog={os.path.join(log_dir, f'Bot-{run}-{index}.log')}",
+    ]
+    return subprocess.Popen([part for part in command if part], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+
+def run_soak(args, log_dir, run, server_args):
+    server = start_server(args, log_dir, run, server_args)
+    bots = []
+    try:
+        time.sleep(args.server_startup)
+        bots = [start_bot(args, log_dir, run, index) for index in range(args.bots)]
+
+        # The server quits by itself once it wrote its report
+        server.wait(timeout=args.server_startup + args.connect_timeout + args.warmup + args.duration)
+        return server.returncode == 0
+    except subprocess.TimeoutExpired:
+        print(f"Run {run}: the server didn't finish in time, are the bots connecting?", file=sys.stderr)
+        server.kill()
+        return False
+    finally:
+        for bot in bots:
+            bot.terminate()
+        for bot in bots:
+            try:
+                bot.wait(timeout=30)
+            except subprocess.TimeoutExpired:
+                bot.kill()
+
+
+def read_last_run(args):
+    if not os.path.exists(args.report):
+        return None
+    with open(args.report, newline="") as report:
+        rows = list(csv.DictReader(report))
+    if not rows:
+        return None
+    row = rows[-1]
+    row["TickMsPerBot"] = float(row["TickAvgMs"]) / max(int(row["Bots"]), 1)
+    return row
+
+
+def compare_runs(results):
+    if not any(results.values()):
+        print("No run made it to the report.", file=sys.stderr)
+        return
+
+    print(f"{'':26}" + "".join(f"{column:>24}" for column in COMPARED_COLUMNS))
+    for label, rows in results.items():
+        print(label)
+        for row in rows:
+            print(f"  {row['Date']:24}" + "".join(f"{float(row[column]):>24.3f}" for column in COMPARED_COLUMNS))
+
+        if len(rows) > 1:
+            means = [statistics.mean(float(row[column]) for row in rows) for column in COMPARED_COLUMNS]
+            deviations = [statistics.stdev(float(row[column]) for row in rows) for column in COMPARED_COLUMNS]
+            print(f"  {'Mean':24}" + "".join(f"{mean:>24.3f}" for mean in means))
+            print(f"  {'Deviation %':24}" + "".join(
+                f"{(100.0 * deviation / mean if mean else 0.0):>24.1f}" for mean, deviation in zip(means, deviations)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Loopback soak of TFPP movement with headless bots.")
+    parser.add_argument("--exe", required=True, help="UnrealEditor or packaged game binary")
+    parser.add_argument("--project", help=".uproject, only with an editor binary")
+    parser.add_argument("--map", required=True, help="map the server opens")
+    parser.add_argument("--bots", type=int, default=8)
+    parser.add_argument("--warmup", type=float, default=10.0, help="seconds the server waits before measuring")
+    parser.add_argument("--duration", type=float, default=60.0, help="seconds the server measures")
+    parser.add_argument("--runs", type=int, default=1)
+    parser.add_argument("--port", type=int, default=7777)
+    parser.add_argument("--seed", type=int, default=1, help="seed of the first bot")
+    parser.add_argument("--server-tick-rate", type=int, default=30)
+    parser.add_argument("--bot-fps", type=int, default=30)
+    parser.add_argument("--server-startup", type=float, default=15.0, help="seconds to wait before starting the bots")
+    parser.add_argument("--connect-timeout", type=float, default=120.0, help="seconds the bots have to connect")
+    parser.add_argument("--report", default="TfppSoak.csv", help="CSV the server appends its results to")
+    parser.add_argument("--logs", default="TfppSoakLogs", help="directory of the server and bot logs")
+    parser.add_argument("--variant", action="append", default=[], metavar="LABEL=ARGS",
+                        help="server arguments of a variant to compare, can be repeated")
+    args = parser.parse_args()
+
+    log_dir = os.path.abspath(args.logs)
+    os.makedirs(log_dir, exist_ok=True)
+
+    variants = [variant.partition("=") for variant in args.variant] or [("Default", "", "")]
+    results = {}
+    failed = 0
+    for label, _, server_args in variants:
+        results[label] = []
+        for run in range(args.runs):
+            print(f"{label}, run {run + 1} of {args.runs}: {args.bots} bots, {args.warmup:.0f} s warmup, "
+                  f"{args.duration:.0f} s measured")
+            row = read_last_run(args) if run_soak(args, log_dir, f"{label}-{run}", server_args.split()) else None
+            if row:
+                results[label].append(row)
+            else:
+                failed += 1
+
+    compare_runs(results)
+    return 0 if failed == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
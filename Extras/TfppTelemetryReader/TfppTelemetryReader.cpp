@@ -0,0 +1,272 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+// Standalone reader of the TFPP telemetry shared memory region, it doesn't need the engine.
+//
+// Build:
+//   Linux/Mac: c++ -std=c++17 -O2 -I../../Source/TfppSystem/Public TfppTelemetryReader.cpp -o TfppTelemetryReader
+//   Windows:   cl /std:c++17 /O2 /EHsc /I..\..\Source\TfppSystem\Public TfppTelemetryReader.cpp
+//
+// Usage:
+//   TfppTelemetryReader [--region Name] [--interval Ms] [--count N]
+//       Prints the counters every interval, forever or N times.
+//   TfppTelemetryReader [--region Name] --check N [--threads T]
+//       Consistency check, run it while a game with bEnableTelemetry is writing the region. T threads each take
+//       N snapshots as fast as they can and verify every snapshot against its checksum and against the previous one:
+//       counters never decrease and the frame never goes backwards. Exits with 1 on the first torn or inconsistent
+//       snapshot, or if the writer never published anything new during the check.
+//   TfppTelemetryReader --self-test N [--threads T]
+//       The same check against a writer thread of the reader itself, which uses the game's publishing code.
+//
+// The game names the region TfppTelemetry_<process id> by default, see TelemetryRegionName in the TFPP settings.
+
+#include "TfppTelemetryLayout.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const FTfppTelemetryRegion* MapRegion(const std::string& Name)
+	{
+#if defined(_WIN32)
+		HANDLE Mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, Name.c_str());
+		if (!Mapping)
+		{
+			return nullptr;
+		}
+		return static_cast<const FTfppTelemetryRegion*>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, sizeof(FTfppTelemetryRegion)));
+#else
+		// The engine prefixes the region name with a slash on POSIX platforms
+		const int File = shm_open(("/" + Name).c_str(), O_RDONLY, 0);
+		if (File < 0)
+		{
+			return nullptr;
+		}
+		void* Address = mmap(nullptr, sizeof(FTfppTelemetryRegion), PROT_READ, MAP_SHARED, File, 0);
+		close(File);
+		return Address == MAP_FAILED ? nullptr : static_cast<const FTfppTelemetryRegion*>(Address);
+#endif
+	}
+
+	/** Copies the payload out of the region, retrying while the game writes it. Returns the number of retries. */
+	uint64_t ReadSnapshot(const FTfppTelemetryRegion* Region, FTfppTelemetryPayload& OutPayload)
+	{
+		uint64_t Retries = 0;
+		while (!TfppTelemetryTryRead(*Region, OutPayload))
+		{
+			++Retries;
+			std::this_thread::yield();
+		}
+		return Retries;
+	}
+
+	void Print(const FTfppTelemetryPayload& Payload)
+	{
+		std::printf("Frame %llu  Time %.3fs  Pawns %llu\n", static_cast<unsigned long long>(Payload.Frame),
+			Payload.TimeSeconds, static_cast<unsigned long long>(Payload.ActivePawns));
+
+		std::printf("  Paces entered   ");
+		for (int32_t Index = 0; Index < TfppTelemetryNumPaces; ++Index)
+		{
+			std::printf(" %llu", static_cast<unsigned long long>(Payload.PacesEntered[Index]));
+		}
+		std::printf("\n  Stances entered ");
+		for (int32_t Index = 0; Index < TfppTelemetryNumStances; ++Index)
+		{
+			std::printf(" %llu", static_cast<unsigned long long>(Payload.StancesEntered[Index]));
+		}
+		std::printf("\n  Sprint gate rejections %llu  Pitch clamp hits %llu\n",
+			static_cast<unsigned long long>(Payload.SprintGateRejections), static_cast<unsigned long long>(Payload.PitchClampHits));
+
+		std::printf("  Stance transitions per frame  0: %llu", static_cast<unsigned long long>(Payload.StanceTransitionsPerFrame[0]));
+		for (int32_t Bucket = 1; Bucket < TfppTelemetryNumHistogramBuckets; ++Bucket)
+		{
+			std::printf("  %llu%s: %llu", 1ull << (Bucket - 1), Bucket == TfppTelemetryNumHistogramBuckets - 1 ? "+" : "",
+				static_cast<unsigned long long>(Payload.StanceTransitionsPerFrame[Bucket]));
+		}
+		std::printf("\n");
+	}
+
+	int RunCheck(const FTfppTelemetryRegion* Region, uint64_t NumSnapshots, int32_t NumThreads)
+	{
+		std::atomic<bool> bFailed(false);
+		std::atomic<uint64_t> Retries(0);
+		std::atomic<uint64_t> FirstFrame(0);
+		std::atomic<uint64_t> LastFrame(0);
+
+		std::vector<std::thread> Threads;
+		for (int32_t ThreadIndex = 0; ThreadIndex < NumThreads; ++ThreadIndex)
+		{
+			Threads.emplace_back([&, ThreadIndex]()
+			{
+				FTfppTelemetryPayload Previous;
+				Retries += ReadSnapshot(Region, Previous);
+				if (ThreadIndex == 0)
+				{
+					FirstFrame = Previous.Frame;
+				}
+
+				for (uint64_t Snapshot = 1; Snapshot < NumSnapshots && !bFailed; ++Snapshot)
+				{
+					FTfppTelemetryPayload Current;
+					Retries += ReadSnapshot(Region, Current);
+
+					if (const char* Error = TfppTelemetryFindInconsistency(Previous, Current))
+					{
+						std::fprintf(stderr, "Thread %d, snapshot %llu of frame %llu: %s\n", ThreadIndex,
+							static_cast<unsigned long long>(Snapshot), static_cast<unsigned long long>(Current.Frame), Error);
+						bFailed = true;
+					}
+					Previous = Current;
+				}
+
+				if (ThreadIndex == 0)
+				{
+					LastFrame = Previous.Frame;
+				}
+			});
+		}
+		for (std::thread& Thread : Threads)
+		{
+			Thread.join();
+		}
+
+		if (bFailed)
+		{
+			return 1;
+		}
+		if (LastFrame == FirstFrame)
+		{
+			std::fprintf(stderr, "The writer didn't publish during the check, is the game running with telemetry enabled?\n");
+			return 1;
+		}
+
+		std::printf("%llu consistent snapshots per thread on %d threads over frames %llu to %llu, %llu retries.\n",
+			static_cast<unsigned long long>(NumSnapshots), NumThreads, static_cast<unsigned long long>(FirstFrame.load()),
+			static_cast<unsigned long long>(LastFrame.load()), static_cast<unsigned long long>(Retries.load()));
+		return 0;
+	}
+
+	/** Runs the consistency check against a writer thread of this process that publishes as fast as it can. */
+	int RunSelfTest(uint64_t NumSnapshots, int32_t NumThreads)
+	{
+		FTfppTelemetryRegion Region = {};
+		Region.Header.Magic = TfppTelemetryMagic;
+		Region.Header.Version = TfppTelemetryVersion;
+		Region.Header.Size = sizeof(FTfppTelemetryRegion);
+
+		FTfppTelemetryPayload Payload = {};
+		Payload.Checksum = TfppTelemetryChecksum(Payload);
+		TfppTelemetryWrite(Region, Payload);
+
+		std::atomic<bool> bStop(false);
+		std::thread Writer([&]()
+		{
+			while (!bStop)
+			{
+				// Every counter moves on every write so a torn copy mixes old and new values
+				++Payload.Frame;
+				Payload.TimeSeconds = Payload.Frame / 60.0;
+				Payload.ActivePawns = Payload.Frame % 64;
+				for (int32_t Index = 0; Index < TfppTelemetryNumPaces; ++Index)
+				{
+					Payload.PacesEntered[Index] += Index + 1;
+				}
+				for (int32_t Index = 0; Index < TfppTelemetryNumStances; ++Index)
+				{
+					Payload.StancesEntered[Index] += Index + 1;
+				}
+				++Payload.SprintGateRejections;
+				++Payload.PitchClampHits;
+				++Payload.StanceTransitionsPerFrame[TfppTelemetryHistogramBucket(Payload.Frame % 16)];
+				Payload.Checksum = TfppTelemetryChecksum(Payload);
+				TfppTelemetryWrite(Region, Payload);
+			}
+		});
+
+		const int Result = RunCheck(&Region, NumSnapshots, NumThreads);
+		bStop = true;
+		Writer.join();
+		return Result;
+	}
+}
+
+int main(int ArgC, char** ArgV)
+{
+	std::string RegionName;
+	int32_t IntervalMs = 1000;
+	uint64_t Count = 0;
+	uint64_t CheckSnapshots = 0;
+	uint64_t SelfTestSnapshots = 0;
+	int32_t NumThreads = 4;
+
+	for (int Index = 1; Index + 1 < ArgC; Index += 2)
+	{
+		const std::string Option = ArgV[Index];
+		const char* Value = ArgV[Index + 1];
+		if (Option == "--region") RegionName = Value;
+		else if (Option == "--interval") IntervalMs = std::atoi(Value);
+		else if (Option == "--count") Count = std::strtoull(Value, nullptr, 10);
+		else if (Option == "--check") CheckSnapshots = std::strtoull(Value, nullptr, 10);
+		else if (Option == "--threads") NumThreads = std::atoi(Value);
+		else if (Option == "--self-test") SelfTestSnapshots = std::strtoull(Value, nullptr, 10);
+		else
+		{
+			std::fprintf(stderr, "Unknown option %s\n", Option.c_str());
+			return 2;
+		}
+	}
+
+	if (SelfTestSnapshots > 0)
+	{
+		return RunSelfTest(SelfTestSnapshots, NumThreads > 0 ? NumThreads : 1);
+	}
+
+	if (RegionName.empty())
+	{
+		std::fprintf(stderr, "Pass the region with --region, the game logs its name when telemetry starts.\n");
+		return 2;
+	}
+
+	const FTfppTelemetryRegion* Region = MapRegion(RegionName);
+	if (!Region)
+	{
+		std::fprintf(stderr, "Couldn't open the telemetry region %s.\n", RegionName.c_str());
+		return 2;
+	}
+	if (Region->Header.Magic != TfppTelemetryMagic || Region->Header.Version != TfppTelemetryVersion
+		|| Region->Header.Size != sizeof(FTfppTelemetryRegion))
+	{
+		std::fprintf(stderr, "%s isn't a version %u TFPP telemetry region.\n", RegionName.c_str(), TfppTelemetryVersion);
+		return 2;
+	}
+
+	if (CheckSnapshots > 0)
+	{
+		return RunCheck(Region, CheckSnapshots, NumThreads > 0 ? NumThreads : 1);
+	}
+
+	for (uint64_t Iteration = 0; Count == 0 || Iteration < Count; ++Iteration)
+	{
+		FTfppTelemetryPayload Payload;
+		ReadSnapshot(Region, Payload);
+		Print(Payload);
+		std::this_thread::sleep_for(std::chrono::milliseconds(IntervalMs));
+	}
+	return 0;
+}
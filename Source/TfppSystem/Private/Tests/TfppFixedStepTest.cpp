@@ -0,0 +1,69 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppFixedStep.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppFixedStepRateTest, "TfppSystem.FixedStep.StepsIndependentOfFrameRate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppFixedStepRateTest::RunTest(const FString& Parameters)
+{
+	constexpr float SimulationRate = 60.f;
+	constexpr float StepTime = 1.f / SimulationRate;
+	constexpr float Seconds = 10.f;
+	constexpr int32 MaxSteps = 4;
+
+	// The simulation has to cost the same whatever the frame rate, only the number of steps per frame changes
+	for (const float FrameRate : { 30.f, 60.f, 90.f, 144.f, 240.f })
+	{
+		FTfppFixedStep FixedStep;
+		const int32 NumFrames = FMath::RoundToInt32(Seconds * FrameRate);
+		int32 NumSteps = 0;
+		int32 MaxStepsInFrame = 0;
+		bool bAlphaInRange = true;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const int32 FrameSteps = FixedStep.Advance(1.f / FrameRate, StepTime, MaxSteps);
+			NumSteps += FrameSteps;
+			MaxStepsInFrame = FMath::Max(MaxStepsInFrame, FrameSteps);
+			const float Alpha = FixedStep.GetAlpha(StepTime);
+			bAlphaInRange &= Alpha >= 0.f && Alpha <= 1.f;
+		}
+
+		const int32 ExpectedSteps = FMath::RoundToInt32(Seconds * SimulationRate);
+		TestTrue(FString::Printf(TEXT("%.0f fps runs %d steps, expected %d"), FrameRate, NumSteps, ExpectedSteps),
+			FMath::Abs(NumSteps - ExpectedSteps) <= 1);
+		TestTrue(FString::Printf(TEXT("%.0f fps keeps alpha between 0 and 1"), FrameRate), bAlphaInRange);
+		// Rounding can leave a step for the next frame, which then runs one more
+		const int32 AllowedStepsInFrame = FMath::CeilToInt32(SimulationRate / FrameRate) + 1;
+		TestTrue(FString::Printf(TEXT("%.0f fps runs at most %d steps per frame"), FrameRate, AllowedStepsInFrame),
+			MaxStepsInFrame <= AllowedStepsInFrame);
+		AddInfo(FString::Printf(TEXT("%.0f fps: %d frames, %d steps, %.2f steps per frame."),
+			FrameRate, NumFrames, NumSteps, static_cast<float>(NumSteps) / NumFrames));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppFixedStepHitchTest, "TfppSystem.FixedStep.HitchDropsTime",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppFixedStepHitchTest::RunTest(const FString& Parameters)
+{
+	constexpr float StepTime = 1.f / 60.f;
+	constexpr int32 MaxSteps = 4;
+
+	FTfppFixedStep FixedStep;
+	FixedStep.Advance(StepTime * 0.5f, StepTime, MaxSteps);
+	TestEqual(TEXT("Half a step rendered between two steps"), FixedStep.GetAlpha(StepTime), 0.5f, 0.001f);
+
+	// A one second hitch runs the maximum number of steps and drops the rest instead of catching up later
+	TestEqual(TEXT("Steps of the hitch"), FixedStep.Advance(1.f, StepTime, MaxSteps), MaxSteps);
+	TestEqual(TEXT("Alpha after the hitch"), FixedStep.GetAlpha(StepTime), 0.f);
+	TestEqual(TEXT("Steps of the frame after the hitch"), FixedStep.Advance(StepTime, StepTime, MaxSteps), 1);
+	return true;
+}
+
+#endif
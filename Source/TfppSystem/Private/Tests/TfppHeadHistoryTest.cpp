@@ -0,0 +1,137 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppHeadHistory.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TfppHeadHistoryTest
+{
+	// Samples 125 ms apart, exact in binary so every recorded time lands on a whole millisecond
+	constexpr double StartTime = 1.0;
+	constexpr double Interval = 0.125;
+
+	// Location is stored in millimeters, rotations in 1/65536 of a turn
+	constexpr double LocationTolerance = 0.05;
+	constexpr double RotationTolerance = 0.01;
+
+	static double GetSampleTime(int32 Index)
+	{
+		return StartTime + Index * Interval;
+	}
+
+	// Every sample moves 100 cm forward and turns 10 degrees, so the expected pose at any time is a straight line
+	static void RecordSamples(FTfppHeadPoseHistory& History, int32 NumSamples)
+	{
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			History.Record(GetSampleTime(Index), FVector(100.0 * Index, -50.0, 170.0), FRotator(0.0, 10.0 * Index, 0.0),
+				FRotator(-5.0, 10.0 * Index, 0.0));
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppHeadHistoryRewindTest, "TfppSystem.HeadHistory.Rewind",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppHeadHistoryRewindTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppHeadHistoryTest;
+
+	FTfppHeadPoseHistory History;
+	History.Init(8);
+
+	FTfppHeadPose Pose;
+	TestFalse(TEXT("Nothing to rewind before the first sample"), History.Rewind(StartTime, Pose));
+
+	RecordSamples(History, 4);
+	TestEqual(TEXT("Samples stored"), History.Num(), 4);
+
+	// On a sample
+	TestTrue(TEXT("Rewind on a sample"), History.Rewind(GetSampleTime(2), Pose));
+	TestEqual(TEXT("Location on a sample"), Pose.CameraLocation, FVector(200.0, -50.0, 170.0), LocationTolerance);
+	TestEqual(TEXT("Yaw on a sample"), Pose.CameraRotation.Yaw, 20.0, RotationTolerance);
+
+	// A quarter of the way between the second and third samples
+	TestTrue(TEXT("Rewind between samples"), History.Rewind(GetSampleTime(1) + Interval * 0.25, Pose));
+	TestEqual(TEXT("Interpolated location"), Pose.CameraLocation, FVector(125.0, -50.0, 170.0), LocationTolerance);
+	TestEqual(TEXT("Interpolated camera yaw"), Pose.CameraRotation.Yaw, 12.5, RotationTolerance);
+	TestEqual(TEXT("Interpolated view yaw"), Pose.ViewRotation.Yaw, 12.5, RotationTolerance);
+	TestEqual(TEXT("View pitch"), Pose.ViewRotation.Pitch, -5.0, RotationTolerance);
+
+	// Out of range times clamp to the oldest and newest samples
+	TestTrue(TEXT("Rewind before the oldest sample"), History.Rewind(StartTime - 10.0, Pose));
+	TestEqual(TEXT("Clamped to the oldest location"), Pose.CameraLocation, FVector(0.0, -50.0, 170.0), LocationTolerance);
+	TestTrue(TEXT("Rewind after the newest sample"), History.Rewind(GetSampleTime(10), Pose));
+	TestEqual(TEXT("Clamped to the newest location"), Pose.CameraLocation, FVector(300.0, -50.0, 170.0), LocationTolerance);
+	TestEqual(TEXT("Clamped to the newest yaw"), Pose.CameraRotation.Yaw, 30.0, RotationTolerance);
+
+	// Samples that don't move time forward are ignored
+	History.Record(GetSampleTime(1), FVector(9999.0), FRotator::ZeroRotator, FRotator::ZeroRotator);
+	TestEqual(TEXT("Samples stored after an older sample"), History.Num(), 4);
+	TestTrue(TEXT("Rewind after an older sample"), History.Rewind(GetSampleTime(1), Pose));
+	TestEqual(TEXT("Older sample ignored"), Pose.CameraLocation, FVector(100.0, -50.0, 170.0), LocationTolerance);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppHeadHistoryWrapTest, "TfppSystem.HeadHistory.WrapAround",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppHeadHistoryWrapTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppHeadHistoryTest;
+
+	constexpr int32 Capacity = 4;
+	constexpr int32 NumSamples = 10;
+
+	FTfppHeadPoseHistory History;
+	History.Init(Capacity);
+	const SIZE_T AllocatedSize = History.GetAllocatedSize();
+	RecordSamples(History, NumSamples);
+
+	TestEqual(TEXT("Samples stored"), History.Num(), Capacity);
+	TestTrue(TEXT("Memory doesn't grow"), History.GetAllocatedSize() == AllocatedSize);
+	TestEqual(TEXT("Oldest time"), History.GetOldestTime(), GetSampleTime(NumSamples - Capacity), 0.001);
+
+	// The overwritten samples are gone, older times clamp to the oldest one left
+	FTfppHeadPose Pose;
+	TestTrue(TEXT("Rewind to an overwritten sample"), History.Rewind(GetSampleTime(1), Pose));
+	TestEqual(TEXT("Clamped to the oldest sample left"), Pose.CameraLocation, FVector(600.0, -50.0, 170.0), LocationTolerance);
+
+	// Interpolate across every pair, whichever slots they ended up in
+	for (int32 Index = NumSamples - Capacity; Index < NumSamples - 1; ++Index)
+	{
+		TestTrue(TEXT("Rewind between samples"), History.Rewind(GetSampleTime(Index) + Interval * 0.5, Pose));
+		TestEqual(FString::Printf(TEXT("Location after sample %d"), Index), Pose.CameraLocation,
+			FVector(100.0 * Index + 50.0, -50.0, 170.0), LocationTolerance);
+		TestEqual(FString::Printf(TEXT("Yaw after sample %d"), Index), Pose.CameraRotation.Yaw,
+			FRotator::NormalizeAxis(10.0 * Index + 5.0), RotationTolerance);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppHeadHistoryQuantizationTest, "TfppSystem.HeadHistory.Quantization",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppHeadHistoryQuantizationTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppHeadHistoryTest;
+
+	FTfppHeadPoseHistory History;
+	History.Init(2);
+
+	const FVector Location(123456.789, -98765.432, 1234.5678);
+	const FRotator CameraRotation(-33.3333, 170.1234, 12.3456);
+	const FRotator ViewRotation(44.4444, -120.9876, 0.0);
+	History.Record(StartTime, Location, CameraRotation, ViewRotation);
+
+	FTfppHeadPose Pose;
+	TestTrue(TEXT("Rewind"), History.Rewind(StartTime, Pose));
+	TestEqual(TEXT("Location within a millimeter"), Pose.CameraLocation, Location, LocationTolerance);
+	TestTrue(TEXT("Camera rotation within the short compression"), Pose.CameraRotation.Equals(CameraRotation, RotationTolerance));
+	TestTrue(TEXT("View rotation within the short compression"), Pose.ViewRotation.Equals(ViewRotation, RotationTolerance));
+	return true;
+}
+
+#endif
@@ -0,0 +1,156 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppCharacter.h"
+#include "TfppCharacterMovementComponent.h"
+#include "TfppTestWorld.h"
+#include "TfppTraversal.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TfppMantleTest
+{
+	constexpr float DeltaSeconds = 1.f / 60.f;
+
+	// A 100 cm high ledge whose face is at X = 100, deeper than anything that can be vaulted
+	const FVector LedgeCenter(250.0, 0.0, 50.0);
+	const FVector LedgeSize(300.0, 400.0, 100.0);
+	constexpr double LedgeFaceX = 100.0;
+	constexpr double LedgeTopZ = 100.0;
+
+	// Below the overhang of the second test, the bake only sees the floor and the ledge
+	const FBox BakeBounds(FVector(-200.0, -300.0, -50.0), FVector(600.0, 300.0, 150.0));
+
+	/** Spawns a block of the engine cube, which is 100 cm wide and centered on its pivot. */
+	static AStaticMeshActor* SpawnBlock(FTfppTestWorld& TestWorld, const FVector& Center, const FVector& Size)
+	{
+		UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+		AStaticMeshActor* Block = TestWorld.Spawn<AStaticMeshActor>(Center);
+		if (!Cube || !Block)
+		{
+			return nullptr;
+		}
+
+		// Static components can't change mesh once the world plays
+		UStaticMeshComponent* Mesh = Block->GetStaticMeshComponent();
+		Mesh->SetMobility(EComponentMobility::Movable);
+		Mesh->SetStaticMesh(Cube);
+		Block->SetActorScale3D(Size / 100.0);
+		return Block;
+	}
+
+	/** Builds a floor and the ledge, bakes them and spawns a character standing against the ledge, facing it. */
+	static ATfppCharacter* BuildLedge(FAutomationTestBase& Test, FTfppTestWorld& TestWorld)
+	{
+		if (!SpawnBlock(TestWorld, FVector(0.0, 0.0, -5.0), FVector(2000.0, 2000.0, 10.0))
+			|| !SpawnBlock(TestWorld, LedgeCenter, LedgeSize))
+		{
+			Test.AddError(TEXT("Couldn't spawn the geometry, the engine cube is missing."));
+			return nullptr;
+		}
+		TestWorld.Tick(DeltaSeconds);
+
+		// Baked while unregistered so the memory stat of the subsystem stays right
+		ATfppTraversalVolume* Volume = TestWorld.Spawn<ATfppTraversalVolume>();
+		UTfppTraversalSubsystem* Traversal = TestWorld.World->GetSubsystem<UTfppTraversalSubsystem>();
+		if (!Volume || !Traversal)
+		{
+			Test.AddError(TEXT("Couldn't spawn the traversal volume."));
+			return nullptr;
+		}
+		Traversal->UnregisterVolume(Volume);
+		Volume->BakeBounds(BakeBounds);
+		Traversal->RegisterVolume(Volume);
+		Test.TestTrue(TEXT("The ledge is baked"), Volume->GetIndex().GetNumEdges() > 0);
+
+		ATfppCharacter* Character = TestWorld.Spawn<ATfppCharacter>();
+		if (!Character)
+		{
+			Test.AddError(TEXT("Couldn't spawn the character."));
+			return nullptr;
+		}
+		float Radius = 0.f;
+		float HalfHeight = 0.f;
+		Character->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+		Character->SetActorLocation(FVector(LedgeFaceX - Radius - 10.0, 0.0, HalfHeight + 5.0));
+		Character->GetTfppCharacterMovement()->bRunPhysicsWithNoController = true;
+
+		// Land on the floor first
+		for (int32 Frame = 0; Frame < 10; ++Frame)
+		{
+			TestWorld.Tick(DeltaSeconds);
+		}
+		return Character;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppMantleLedgeTest, "TfppSystem.Traversal.Mantle.ClimbsLedge",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppMantleLedgeTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppMantleTest;
+
+	FTfppTestWorld TestWorld;
+	ATfppCharacter* Character = BuildLedge(*this, TestWorld);
+	if (!Character)
+	{
+		return false;
+	}
+	UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement();
+	TestTrue(TEXT("The character stands on the floor"), Movement->IsMovingOnGround());
+
+	Movement->Mantle();
+	TestWorld.Tick(DeltaSeconds);
+	TestTrue(TEXT("The mantle starts"), Movement->IsMantling());
+
+	for (int32 Frame = 0; Frame < 120 && Movement->IsMantling(); ++Frame)
+	{
+		TestWorld.Tick(DeltaSeconds);
+	}
+
+	const FVector Location = Character->GetActorLocation();
+	TestFalse(TEXT("The mantle ends"), Movement->IsMantling());
+	TestTrue(TEXT("The character is past the edge"), Location.X > LedgeFaceX);
+	TestTrue(TEXT("The character is on top of the ledge"), Location.Z - Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() > LedgeTopZ - 1.0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppMantleOverhangTest, "TfppSystem.Traversal.Mantle.BlockedByOverhang",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppMantleOverhangTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppMantleTest;
+
+	FTfppTestWorld TestWorld;
+
+	// A slab over the character, too low to rise past it but out of the bake, which only sees the ledge under it
+	if (!SpawnBlock(TestWorld, FVector(-50.0, 0.0, 225.0), FVector(280.0, 400.0, 50.0)))
+	{
+		AddError(TEXT("Couldn't spawn the overhang."));
+		return false;
+	}
+	ATfppCharacter* Character = BuildLedge(*this, TestWorld);
+	if (!Character)
+	{
+		return false;
+	}
+	UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement();
+
+	Movement->Mantle();
+	for (int32 Frame = 0; Frame < 60; ++Frame)
+	{
+		TestWorld.Tick(DeltaSeconds);
+		TestFalse(TEXT("The mantle doesn't start under the overhang"), Movement->IsMantling());
+	}
+	TestTrue(TEXT("The character is still on the floor"), Character->GetActorLocation().Z < LedgeTopZ);
+	return true;
+}
+
+#endif
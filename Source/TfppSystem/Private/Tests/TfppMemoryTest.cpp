@@ -0,0 +1,92 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppMemory.h"
+#include "TfppCharacter.h"
+#include "TfppDevSettings.h"
+#include "TfppFootPlacementComponent.h"
+#include "TfppFootsteps.h"
+#include "TfppHeadHistory.h"
+#include "TfppTestWorld.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TfppMemoryTest
+{
+	constexpr int32 NumPawns = 16;
+
+	// Budget checked when the project doesn't configure one, well above what a TFPP pawn should ever own.
+	constexpr int64 DefaultBudget = 64 * 1024;
+
+	static void SpawnPawns(FTfppTestWorld& TestWorld)
+	{
+		for (int32 PawnIndex = 0; PawnIndex < NumPawns; ++PawnIndex)
+		{
+			ATfppCharacter* Character = TestWorld.Spawn<ATfppCharacter>(FVector(PawnIndex * 200.f, 0.f, 100.f));
+			if (!Character)
+			{
+				continue;
+			}
+
+			// The components owning containers, so their allocations are part of the measure
+			for (UClass* ComponentClass : { UTfppFootPlacementComponent::StaticClass(), UTfppHeadHistoryComponent::StaticClass(), UTfppFootstepComponent::StaticClass() })
+			{
+				UActorComponent* Component = NewObject<UActorComponent>(Character, ComponentClass);
+				Component->RegisterComponent();
+			}
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppMemoryBudgetTest, "TfppSystem.Memory.PawnsWithinBudget",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppMemoryBudgetTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppMemoryTest;
+
+	FTfppTestWorld TestWorld;
+	SpawnPawns(TestWorld);
+
+	int64& Budget = UTfppDevSettings::Get()->PerPawnMemoryBudget;
+	TGuardValue<int64> BudgetGuard(Budget, Budget > 0 ? Budget : DefaultBudget);
+
+	FTfppPawnMemoryReport Aggregate;
+	int32 NumMeasured = 0;
+	int32 NumOverBudget = 0;
+	const bool bWithinBudget = TfppMemory::MeasureWorld(TestWorld.World, Aggregate, NumMeasured, NumOverBudget);
+
+	TestEqual(TEXT("Measured pawns"), NumMeasured, NumPawns);
+	TestEqual(TEXT("Pawns over the budget"), NumOverBudget, 0);
+	TestTrue(TEXT("MeasureWorld reports the world within budget"), bWithinBudget);
+	TestTrue(TEXT("Components are measured"), Aggregate.OtherComponents > 0);
+	AddInfo(FString::Printf(TEXT("%llu bytes per pawn on average, budget %lld bytes."),
+		static_cast<uint64>(Aggregate.GetTotal() / FMath::Max(NumMeasured, 1)), Budget));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppMemoryOverrunTest, "TfppSystem.Memory.OverrunIsReported",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppMemoryOverrunTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppMemoryTest;
+
+	FTfppTestWorld TestWorld;
+	SpawnPawns(TestWorld);
+
+	// No pawn fits in a single byte, every one of them has to be reported
+	TGuardValue<int64> BudgetGuard(UTfppDevSettings::Get()->PerPawnMemoryBudget, 1);
+
+	FTfppPawnMemoryReport Aggregate;
+	int32 NumMeasured = 0;
+	int32 NumOverBudget = 0;
+	const bool bWithinBudget = TfppMemory::MeasureWorld(TestWorld.World, Aggregate, NumMeasured, NumOverBudget);
+
+	TestFalse(TEXT("MeasureWorld reports the overrun"), bWithinBudget);
+	TestEqual(TEXT("Pawns over the budget"), NumOverBudget, NumPawns);
+	return true;
+}
+
+#endif
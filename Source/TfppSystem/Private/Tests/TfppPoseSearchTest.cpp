@@ -0,0 +1,239 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppPoseSearch.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TfppPoseSearchTest
+{
+	constexpr int32 NumFeatures = 8;
+	constexpr int32 NumPoses = 2000;
+	constexpr int32 NumQueries = 500;
+
+	// Two velocity channels in cm/s followed by three future positions in cm, like the locomotion database
+	static void MakeFeatures(FRandomStream& Random, TArrayView<float> OutFeatures)
+	{
+		OutFeatures[0] = Random.FRandRange(-600.f, 600.f);
+		OutFeatures[1] = Random.FRandRange(-600.f, 600.f);
+		for (int32 Feature = 2; Feature < NumFeatures; ++Feature)
+		{
+			OutFeatures[Feature] = Random.FRandRange(-50.f, 50.f) * Feature;
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppPoseSearchTreeTest, "TfppSystem.PoseSearch.TreeMatchesBruteForce",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppPoseSearchTreeTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppPoseSearchTest;
+
+	FRandomStream Random(1234);
+	TArray<float> Features;
+	Features.SetNumUninitialized(NumPoses * NumFeatures);
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		MakeFeatures(Random, TArrayView<float>(&Features[Pose * NumFeatures], NumFeatures));
+	}
+
+	FTfppPoseSearchIndex Index;
+	Index.Build(Features, NumFeatures, 4);
+	TestEqual(TEXT("Indexed poses"), Index.GetNumPoses(), NumPoses);
+
+	TArray<float> Query;
+	Query.SetNumUninitialized(NumFeatures);
+	double TreeSeconds = 0.0;
+	double BruteForceSeconds = 0.0;
+	int32 NumMismatches = 0;
+	for (int32 QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+	{
+		MakeFeatures(Random, Query);
+
+		float TreeDistanceSq = 0.f;
+		float BruteForceDistanceSq = 0.f;
+		double StartSeconds = FPlatformTime::Seconds();
+		const int32 TreePose = Index.Search(Query, &TreeDistanceSq);
+		TreeSeconds += FPlatformTime::Seconds() - StartSeconds;
+		StartSeconds = FPlatformTime::Seconds();
+		const int32 BruteForcePose = Index.SearchBruteForce(Query, &BruteForceDistanceSq);
+		BruteForceSeconds += FPlatformTime::Seconds() - StartSeconds;
+
+		// Two poses at the same distance are both valid answers
+		if (TreePose != BruteForcePose && !FMath::IsNearlyEqual(TreeDistanceSq, BruteForceDistanceSq, UE_KINDA_SMALL_NUMBER))
+		{
+			++NumMismatches;
+		}
+	}
+
+	TestEqual(TEXT("Queries where the tree missed the nearest pose"), NumMismatches, 0);
+	AddInfo(FString::Printf(TEXT("Tree %.2f us per query, brute force %.2f us per query over %d poses."),
+		TreeSeconds * 1e6 / NumQueries, BruteForceSeconds * 1e6 / NumQueries, NumPoses));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppPoseSearchFullSpaceTest, "TfppSystem.PoseSearch.ReducedSpaceMatchesFullSpace",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppPoseSearchFullSpaceTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppPoseSearchTest;
+
+	// Poses lie in a three dimensional subspace, so three components have to keep every distance
+	constexpr int32 NumLatents = 3;
+	FRandomStream Random(5678);
+	TArray<float> Basis;
+	Basis.SetNumUninitialized(NumLatents * NumFeatures);
+	for (int32 Latent = 0; Latent < NumLatents; ++Latent)
+	{
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			Basis[Latent * NumFeatures + Feature] = Random.FRandRange(-1.f, 1.f) * (Feature < 2 ? 600.f : 50.f);
+		}
+	}
+
+	auto MakeLatentFeatures = [&Random, &Basis](TArrayView<float> OutFeatures)
+	{
+		const float Latents[NumLatents] = { Random.FRandRange(-3.f, 3.f), Random.FRandRange(-2.f, 2.f), Random.FRandRange(-1.f, 1.f) };
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			OutFeatures[Feature] = 0.f;
+			for (int32 Latent = 0; Latent < NumLatents; ++Latent)
+			{
+				OutFeatures[Feature] += Latents[Latent] * Basis[Latent * NumFeatures + Feature];
+			}
+		}
+	};
+
+	TArray<float> Features;
+	Features.SetNumUninitialized(NumPoses * NumFeatures);
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		MakeLatentFeatures(TArrayView<float>(&Features[Pose * NumFeatures], NumFeatures));
+	}
+
+	FTfppPoseSearchIndex Index;
+	Index.Build(Features, NumFeatures, NumLatents);
+
+	// Same standardization as the index, computed independently
+	float Mean[NumFeatures] = {};
+	float InvDeviation[NumFeatures] = {};
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			Mean[Feature] += Features[Pose * NumFeatures + Feature] / NumPoses;
+		}
+	}
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			InvDeviation[Feature] += FMath::Square(Features[Pose * NumFeatures + Feature] - Mean[Feature]) / NumPoses;
+		}
+	}
+	for (float& Value : InvDeviation)
+	{
+		Value = 1.f / FMath::Sqrt(Value);
+	}
+
+	auto StandardizedDistanceSq = [&](const float* A, const float* B)
+	{
+		float DistanceSq = 0.f;
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			DistanceSq += FMath::Square((A[Feature] - B[Feature]) * InvDeviation[Feature]);
+		}
+		return DistanceSq;
+	};
+
+	TArray<float> Query;
+	Query.SetNumUninitialized(NumFeatures);
+	int32 NumMismatches = 0;
+	for (int32 QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+	{
+		MakeLatentFeatures(Query);
+
+		float BestDistanceSq = MAX_flt;
+		for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+		{
+			BestDistanceSq = FMath::Min(BestDistanceSq, StandardizedDistanceSq(Query.GetData(), &Features[Pose * NumFeatures]));
+		}
+
+		float ReducedDistanceSq = 0.f;
+		const int32 Pose = Index.Search(Query, &ReducedDistanceSq);
+		if (!TestTrue(TEXT("Found a pose"), Features.IsValidIndex(Pose * NumFeatures)))
+		{
+			return false;
+		}
+
+		// The pose found in the reduced space has to be as close as the best one in the full space
+		const float FoundDistanceSq = StandardizedDistanceSq(Query.GetData(), &Features[Pose * NumFeatures]);
+		if (!FMath::IsNearlyEqual(FoundDistanceSq, BestDistanceSq, 1e-3f + BestDistanceSq * 1e-2f))
+		{
+			++NumMismatches;
+		}
+	}
+
+	TestEqual(TEXT("Queries where the reduced space missed the nearest pose"), NumMismatches, 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppPoseSearchStandardizationTest, "TfppSystem.PoseSearch.StandardizedFeatures",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppPoseSearchStandardizationTest::RunTest(const FString& Parameters)
+{
+	using namespace TfppPoseSearchTest;
+
+	// Velocities are noise in cm/s, positions all follow the same pose parameter in cm. On raw features the first
+	// component is a velocity, once standardized it has to be the pose
+	FRandomStream Random(91011);
+	TArray<float> PoseParameters;
+	TArray<float> Features;
+	PoseParameters.SetNumUninitialized(NumPoses);
+	Features.SetNumUninitialized(NumPoses * NumFeatures);
+
+	auto MakePoseFeatures = [&Random](float PoseParameter, TArrayView<float> OutFeatures)
+	{
+		OutFeatures[0] = Random.FRandRange(-600.f, 600.f);
+		OutFeatures[1] = Random.FRandRange(-600.f, 600.f);
+		for (int32 Feature = 2; Feature < NumFeatures; ++Feature)
+		{
+			OutFeatures[Feature] = PoseParameter * 10.f * Feature;
+		}
+	};
+
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		PoseParameters[Pose] = Random.FRandRange(-1.f, 1.f);
+		MakePoseFeatures(PoseParameters[Pose], TArrayView<float>(&Features[Pose * NumFeatures], NumFeatures));
+	}
+
+	FTfppPoseSearchIndex Index;
+	Index.Build(Features, NumFeatures, 1);
+
+	TArray<float> Query;
+	Query.SetNumUninitialized(NumFeatures);
+	float MaxError = 0.f;
+	for (int32 QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+	{
+		const float PoseParameter = Random.FRandRange(-1.f, 1.f);
+		MakePoseFeatures(PoseParameter, Query);
+
+		const int32 Pose = Index.Search(Query);
+		if (!TestTrue(TEXT("Found a pose"), PoseParameters.IsValidIndex(Pose)))
+		{
+			return false;
+		}
+		MaxError = FMath::Max(MaxError, FMath::Abs(PoseParameters[Pose] - PoseParameter));
+	}
+
+	// With 2000 poses spread over [-1, 1] the closest one is a few thousandths away
+	TestTrue(FString::Printf(TEXT("Pose parameter error %f is small"), MaxError), MaxError < 0.02f);
+	return true;
+}
+
+#endif
@@ -0,0 +1,126 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppTelemetryLayout.h"
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+#include <atomic>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppTelemetrySeqlockTest, "TfppSystem.Telemetry.Seqlock",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppTelemetrySeqlockTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumReaders = 4;
+	constexpr int32 NumSnapshots = 100000;
+
+	FTfppTelemetryRegion Region = {};
+	FTfppTelemetryPayload Payload = {};
+	Payload.Checksum = TfppTelemetryChecksum(Payload);
+	TfppTelemetryWrite(Region, Payload);
+
+	// The writer publishes as fast as it can with every counter moving, so a torn copy mixes old and new values
+	std::atomic<bool> bStop(false);
+	TFuture<void> Writer = Async(EAsyncExecution::Thread, [&Region, &Payload, &bStop]()
+	{
+		while (!bStop.load(std::memory_order_relaxed))
+		{
+			++Payload.Frame;
+			Payload.TimeSeconds = Payload.Frame / 60.0;
+			for (int32 Index = 0; Index < TfppTelemetryNumPaces; ++Index)
+			{
+				Payload.PacesEntered[Index] += Index + 1;
+			}
+			for (int32 Index = 0; Index < TfppTelemetryNumStances; ++Index)
+			{
+				Payload.StancesEntered[Index] += Index + 1;
+			}
+			++Payload.SprintGateRejections;
+			++Payload.PitchClampHits;
+			++Payload.StanceTransitionsPerFrame[TfppTelemetryHistogramBucket(Payload.Frame % 16)];
+			Payload.Checksum = TfppTelemetryChecksum(Payload);
+			TfppTelemetryWrite(Region, Payload);
+		}
+	});
+
+	struct FReaderResult
+	{
+		const char* Error = nullptr;
+		uint64 FirstFrame = 0;
+		uint64 LastFrame = 0;
+	};
+	TArray<TFuture<FReaderResult>> Readers;
+	for (int32 ReaderIndex = 0; ReaderIndex < NumReaders; ++ReaderIndex)
+	{
+		Readers.Add(Async(EAsyncExecution::Thread, [&Region]()
+		{
+			FReaderResult Result;
+			FTfppTelemetryPayload Previous;
+			while (!TfppTelemetryTryRead(Region, Previous))
+			{
+			}
+			Result.FirstFrame = Previous.Frame;
+
+			for (int32 Snapshot = 1; Snapshot < NumSnapshots && !Result.Error; ++Snapshot)
+			{
+				FTfppTelemetryPayload Current;
+				while (!TfppTelemetryTryRead(Region, Current))
+				{
+				}
+				Result.Error = TfppTelemetryFindInconsistency(Previous, Current);
+				Previous = Current;
+			}
+			Result.LastFrame = Previous.Frame;
+			return Result;
+		}));
+	}
+
+	bool bWriterPublished = false;
+	for (int32 ReaderIndex = 0; ReaderIndex < NumReaders; ++ReaderIndex)
+	{
+		const FReaderResult Result = Readers[ReaderIndex].Get();
+		TestTrue(FString::Printf(TEXT("Reader %d found no inconsistent snapshot (%s)"), ReaderIndex,
+			Result.Error ? ANSI_TO_TCHAR(Result.Error) : TEXT("none")), Result.Error == nullptr);
+		bWriterPublished |= Result.LastFrame > Result.FirstFrame;
+	}
+	bStop = true;
+	Writer.Wait();
+
+	// Without a single publish during the reads the test wouldn't have proved anything
+	TestTrue(TEXT("The writer published while the readers were reading"), bWriterPublished);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTfppTelemetryInconsistencyTest, "TfppSystem.Telemetry.Inconsistency",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTfppTelemetryInconsistencyTest::RunTest(const FString& Parameters)
+{
+	FTfppTelemetryPayload Previous = {};
+	Previous.Frame = 10;
+	Previous.PacesEntered[2] = 5;
+	Previous.Checksum = TfppTelemetryChecksum(Previous);
+
+	FTfppTelemetryPayload Current = Previous;
+	Current.Frame = 11;
+	Current.Checksum = TfppTelemetryChecksum(Current);
+	TestTrue(TEXT("A later snapshot is consistent"), TfppTelemetryFindInconsistency(Previous, Current) == nullptr);
+
+	FTfppTelemetryPayload Torn = Current;
+	Torn.PacesEntered[2] = 6;
+	TestTrue(TEXT("A torn snapshot fails its checksum"), TfppTelemetryFindInconsistency(Previous, Torn) != nullptr);
+
+	FTfppTelemetryPayload Decreased = Current;
+	Decreased.PacesEntered[2] = 4;
+	Decreased.Checksum = TfppTelemetryChecksum(Decreased);
+	TestTrue(TEXT("A decreasing counter is inconsistent"), TfppTelemetryFindInconsistency(Previous, Decreased) != nullptr);
+
+	FTfppTelemetryPayload Backwards = Current;
+	Backwards.Frame = 9;
+	Backwards.Checksum = TfppTelemetryChecksum(Backwards);
+	TestTrue(TEXT("A frame going backwards is inconsistent"), TfppTelemetryFindInconsistency(Previous, Backwards) != nullptr);
+	return true;
+}
+
+#endif
@@ -0,0 +1,53 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Game world created for the duration of an automation test, so tests can spawn pawns without loading a map.
+ * The world begins play when created and is destroyed with this object.
+ */
+struct FTfppTestWorld
+{
+	FTfppTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("TfppTestWorld"));
+		FWorldContext& Context = GEngine->CreateNewWorldContext(EWorldType::Game);
+		Context.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FTfppTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	FTfppTestWorld(const FTfppTestWorld&) = delete;
+	FTfppTestWorld& operator=(const FTfppTestWorld&) = delete;
+
+	/** Spawns an actor at the given location, ignoring collisions. */
+	template <typename ActorType>
+	ActorType* Spawn(const FVector& Location = FVector::ZeroVector)
+	{
+		FActorSpawnParameters Params;
+		Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		return World->SpawnActor<ActorType>(Location, FRotator::ZeroRotator, Params);
+	}
+
+	/** Ticks the world once, movement, physics and timers included. */
+	void Tick(float DeltaSeconds)
+	{
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+	}
+
+	UWorld* World = nullptr;
+};
+
+#endif
@@ -0,0 +1,30 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppAIController.h"
+#include "TfppCharacter.h"
+#include "TfppNavigation.h"
+#include "Engine/World.h"
+#include "NavigationData.h"
+#include "NavigationSystemTypes.h"
+
+ATfppAIController::ATfppAIController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UTfppPathFollowingComponent>(TEXT("PathFollowingComponent")))
+{
+}
+
+bool ATfppAIController::BuildPathfindingQuery(const FAIMoveRequest& MoveRequest, FPathFindingQuery& OutQuery) const
+{
+	if (!Super::BuildPathfindingQuery(MoveRequest, OutQuery))
+	{
+		return false;
+	}
+
+	const ATfppCharacter* Character = Cast<ATfppCharacter>(GetPawn());
+	UTfppNavigationSubsystem* Navigation = GetWorld()->GetSubsystem<UTfppNavigationSubsystem>();
+	if (Character && Navigation && OutQuery.NavData.IsValid() && !MoveRequest.GetNavigationFilter())
+	{
+		OutQuery.QueryFilter = Navigation->GetQueryFilter(*OutQuery.NavData,
+			UTfppNavigationSubsystem::GetStanceMask(*Character->GetTfppCharacterMovement()));
+	}
+	return true;
+}
@@ -3,3 +3,116 @@
 
 #include "TfppSystem/Public/TfppAnimInstance.h"
 
+#include "TfppAnimationSets.h"
+#include "TfppCharacter.h"
+#include "TfppDevSettings.h"
+#include "TfppHeadHistory.h"
+#include "TfppPoseSearch.h"
+#include "Animation/AnimSequence.h"
+
+void UTfppAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+
+	// Evaluated here rather than through the character, since the anim instance can initialize before its BeginPlay.
+	// Lag compensation records the head pose on the server, it has to come from the clips the client plays too
+	const AActor* Owner = GetOwningActor();
+	bSkipCosmeticUpdates = IsRunningDedicatedServer() && UTfppDevSettings::Get()->bUseDedicatedServerProfile
+		&& !(Owner && Owner->FindComponentByClass<UTfppHeadHistoryComponent>());
+
+	if (Owner)
+	{
+		FootPlacementComponent = Owner->FindComponentByClass<UTfppFootPlacementComponent>();
+	}
+
+	if (UWorld* World = GetWorld(); World && AnimationSets)
+	{
+		if (UTfppAnimationStreamingSubsystem* Streaming = World->GetSubsystem<UTfppAnimationStreamingSubsystem>())
+		{
+			Streaming->RegisterAnimInstance(this);
+		}
+	}
+}
+
+void UTfppAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
+{
+	Super::NativeUpdateAnimation(DeltaSeconds);
+
+	if (bSkipCosmeticUpdates)
+	{
+		return;
+	}
+
+	if (const ATfppCharacter* Character = Cast<ATfppCharacter>(TryGetPawnOwner()))
+	{
+		if (LocomotionDatabase)
+		{
+			UpdateLocomotionMatch(*Character, DeltaSeconds);
+		}
+	}
+
+	if (FootPlacementComponent)
+	{
+		FootPlacements = FootPlacementComponent->GetFootPlacements();
+	}
+}
+
+void UTfppAnimInstance::NativeUninitializeAnimation()
+{
+	if (UWorld* World = GetWorld())
+	{
+		if (UTfppAnimationStreamingSubsystem* Streaming = World->GetSubsystem<UTfppAnimationStreamingSubsystem>())
+		{
+			Streaming->UnregisterAnimInstance(this);
+		}
+	}
+
+	Super::NativeUninitializeAnimation();
+}
+
+void UTfppAnimInstance::UpdateLocomotionMatch(const ATfppCharacter& Character, float DeltaSeconds)
+{
+	LocomotionClipTime += DeltaSeconds;
+	if (LocomotionClip && LocomotionClipTime > LocomotionClip->GetPlayLength())
+	{
+		// Force a search rather than playing past the end of a clip
+		LocomotionSearchCountdown = 0.f;
+	}
+
+	LocomotionSearchCountdown -= DeltaSeconds;
+	if (LocomotionSearchCountdown > 0.f)
+	{
+		return;
+	}
+	LocomotionSearchCountdown = LocomotionSearchInterval;
+
+	const UTfppCharacterMovementComponent* Movement = Character.GetTfppCharacterMovement();
+	if (!Movement)
+	{
+		return;
+	}
+
+	// The database is sampled from root motion, which is expressed in mesh space
+	const FTransform& MeshTransform = GetSkelMeshComponent()->GetComponentTransform();
+	const FVector CurrentVelocity = MeshTransform.InverseTransformVectorNoScale(Movement->Velocity);
+	const FVector DesiredVelocity = MeshTransform.InverseTransformVectorNoScale(
+		Movement->GetCurrentAcceleration().GetSafeNormal() * Movement->GetMaxSpeed());
+
+	float Query[UTfppLocomotionDatabase::NumFeatures];
+	LocomotionDatabase->MakeQuery(CurrentVelocity, DesiredVelocity, Query);
+
+	FTfppPoseSearchResult Result;
+	if (!LocomotionDatabase->Search(Movement->GetCurrentPace(), Movement->GetCurrentStance(), Query, Result))
+	{
+		return;
+	}
+
+	// Keep playing when the match is close to what is already playing, this avoids pops from tiny time jumps
+	if (Result.Clip == LocomotionClip && FMath::Abs(Result.Time - LocomotionClipTime) <= LocomotionSameClipTolerance)
+	{
+		return;
+	}
+
+	LocomotionClip = Result.Clip;
+	LocomotionClipTime = Result.Time;
+}
@@ -0,0 +1,161 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppAnimationBudget.h"
+#include "TfppCharacter.h"
+#include "TfppDevSettings.h"
+#include "TfppHeadHistory.h"
+#include "TfppStats.h"
+#include "AnimationBudgetAllocatorParameters.h"
+#include "IAnimationBudgetAllocator.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+void UTfppAnimationBudgetSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const UTfppDevSettings* Settings = UTfppDevSettings::Get();
+	if (!Settings->bUseAnimationBudget)
+	{
+		return;
+	}
+
+	if (IAnimationBudgetAllocator* Allocator = IAnimationBudgetAllocator::Get(&InWorld))
+	{
+		FAnimationBudgetAllocatorParameters Parameters;
+		Parameters.BudgetInMs = Settings->AnimationBudgetMs;
+		Allocator->SetParameters(Parameters);
+		Allocator->SetEnabled(true);
+	}
+	// The time the allocator actually spends is only known to it, see stat AnimationBudgetAllocator
+	SET_FLOAT_STAT(STAT_TfppAnimBudgetConfiguredMs, Settings->AnimationBudgetMs);
+}
+
+void UTfppAnimationBudgetSubsystem::Deinitialize()
+{
+	for (FBudgetedCharacter& Budgeted : Characters)
+	{
+		SetRegistered(Budgeted, false);
+	}
+	Characters.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTfppAnimationBudgetSubsystem::RegisterCharacter(ATfppCharacter* Character)
+{
+	USkeletalMeshComponentBudgeted* Mesh = Cast<USkeletalMeshComponentBudgeted>(Character->GetMesh());
+	if (!Mesh || !UTfppDevSettings::Get()->bUseAnimationBudget)
+	{
+		return;
+	}
+
+	// Dedicated servers have their own animation tick option, and lag compensation needs the head animated every frame
+	if (Character->GetNetMode() == NM_DedicatedServer || Character->FindComponentByClass<UTfppHeadHistoryComponent>())
+	{
+		return;
+	}
+
+	FBudgetedCharacter& Budgeted = Characters.AddDefaulted_GetRef();
+	Budgeted.Character = Character;
+	Budgeted.Mesh = Mesh;
+	// Registered on the next tick, once it is known whether the character is locally controlled
+}
+
+void UTfppAnimationBudgetSubsystem::UnregisterCharacter(ATfppCharacter* Character)
+{
+	const int32 Index = Characters.IndexOfByPredicate([Character](const FBudgetedCharacter& Budgeted) { return Budgeted.Character == Character; });
+	if (Index != INDEX_NONE)
+	{
+		SetRegistered(Characters[Index], false);
+		Characters.RemoveAtSwap(Index);
+	}
+}
+
+bool UTfppAnimationBudgetSubsystem::SetRegistered(FBudgetedCharacter& Budgeted, bool bRegister) const
+{
+	USkeletalMeshComponentBudgeted* Mesh = Budgeted.Mesh.Get();
+	IAnimationBudgetAllocator* Allocator = IAnimationBudgetAllocator::Get(GetWorld());
+	if (!Mesh || !Allocator || Budgeted.bRegistered == bRegister)
+	{
+		return Budgeted.bRegistered;
+	}
+
+	if (bRegister)
+	{
+		Allocator->RegisterComponent(Mesh);
+	}
+	else
+	{
+		Allocator->UnregisterComponent(Mesh);
+	}
+	Budgeted.bRegistered = bRegister;
+	return bRegister;
+}
+
+void UTfppAnimationBudgetSubsystem::Tick(float DeltaTime)
+{
+	IAnimationBudgetAllocator* Allocator = IAnimationBudgetAllocator::Get(GetWorld());
+	if (!Allocator || Characters.Num() == 0)
+	{
+		return;
+	}
+
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector Location;
+			FRotator Rotation;
+			PlayerController->GetPlayerViewPoint(Location, Rotation);
+			ViewLocations.Add(Location);
+		}
+	}
+
+	const float SignificanceDistance = FMath::Max(UTfppDevSettings::Get()->AnimationBudgetSignificanceDistance, 1.f);
+	int32 NumRegistered = 0;
+	int32 NumThrottled = 0;
+
+	Characters.RemoveAllSwap([](const FBudgetedCharacter& Budgeted) { return !Budgeted.Character.IsValid() || !Budgeted.Mesh.IsValid(); });
+	for (FBudgetedCharacter& Budgeted : Characters)
+	{
+		const ATfppCharacter* Character = Budgeted.Character.Get();
+		if (!SetRegistered(Budgeted, !Character->IsLocallyControlled()))
+		{
+			continue;
+		}
+
+		double ClosestDistanceSquared = UE_BIG_NUMBER;
+		const FVector Location = Character->GetActorLocation();
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(Location, ViewLocation));
+		}
+
+		USkeletalMeshComponentBudgeted* Mesh = Budgeted.Mesh.Get();
+		const float Significance = 1.f - FMath::Min(static_cast<float>(FMath::Sqrt(ClosestDistanceSquared)) / SignificanceDistance, 1.f);
+		Allocator->SetComponentSignificance(Mesh, Significance);
+
+		++NumRegistered;
+		if (Mesh->GetExternalTickRate() > 1)
+		{
+			++NumThrottled;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TfppAnimBudgetPawns, NumRegistered);
+	SET_DWORD_STAT(STAT_TfppAnimBudgetThrottled, NumThrottled);
+}
+
+TStatId UTfppAnimationBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTfppAnimationBudgetSubsystem, STATGROUP_Tickables);
+}
+
+bool UTfppAnimationBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
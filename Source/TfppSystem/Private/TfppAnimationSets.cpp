@@ -0,0 +1,271 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppAnimationSets.h"
+#include "TfppAnimInstance.h"
+#include "TfppCharacter.h"
+#include "TfppDevSettings.h"
+#include "TfppLog.h"
+#include "TfppStats.h"
+#include "TfppTransitionGraph.h"
+#include "Animation/AnimationAsset.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+
+FName UTfppAnimationSetDatabase::GetStanceBundleName(ECharacterStances Stance)
+{
+	return FName(TEXT("TfppStance"), static_cast<int32>(Stance) + 1);
+}
+
+FName UTfppAnimationSetDatabase::GetPaceBundleName(EMovementPaces Pace)
+{
+	return FName(TEXT("TfppPace"), static_cast<int32>(Pace) + 1);
+}
+
+const FTfppAnimationSet* UTfppAnimationSetDatabase::FindAnimationSet(FName BundleName) const
+{
+	for (const TPair<ECharacterStances, FTfppAnimationSet>& Pair : StanceAnimations)
+	{
+		if (GetStanceBundleName(Pair.Key) == BundleName)
+		{
+			return &Pair.Value;
+		}
+	}
+	for (const TPair<EMovementPaces, FTfppAnimationSet>& Pair : PaceAnimations)
+	{
+		if (GetPaceBundleName(Pair.Key) == BundleName)
+		{
+			return &Pair.Value;
+		}
+	}
+	return nullptr;
+}
+
+#if WITH_EDITORONLY_DATA
+void UTfppAnimationSetDatabase::UpdateAssetBundleData()
+{
+	Super::UpdateAssetBundleData();
+
+	for (const TPair<ECharacterStances, FTfppAnimationSet>& Pair : StanceAnimations)
+	{
+		for (const TSoftObjectPtr<UAnimationAsset>& Animation : Pair.Value.Animations)
+		{
+			AssetBundleData.AddBundleAsset(GetStanceBundleName(Pair.Key), Animation.ToSoftObjectPath().GetAssetPath());
+		}
+	}
+	for (const TPair<EMovementPaces, FTfppAnimationSet>& Pair : PaceAnimations)
+	{
+		for (const TSoftObjectPtr<UAnimationAsset>& Animation : Pair.Value.Animations)
+		{
+			AssetBundleData.AddBundleAsset(GetPaceBundleName(Pair.Key), Animation.ToSoftObjectPath().GetAssetPath());
+		}
+	}
+}
+#endif
+
+void UTfppAnimationStreamingSubsystem::RegisterAnimInstance(UTfppAnimInstance* AnimInstance)
+{
+	AnimInstances.AddUnique(AnimInstance);
+	// Load what the new instance needs right away instead of waiting for the next update
+	UpdateCountdown = 0.f;
+}
+
+void UTfppAnimationStreamingSubsystem::UnregisterAnimInstance(UTfppAnimInstance* AnimInstance)
+{
+	AnimInstances.RemoveSwap(AnimInstance);
+}
+
+void UTfppAnimationStreamingSubsystem::Tick(float DeltaTime)
+{
+	UpdateCountdown -= DeltaTime;
+	if (UpdateCountdown > 0.f)
+	{
+		return;
+	}
+
+	const UTfppDevSettings* Settings = UTfppDevSettings::Get();
+	UpdateCountdown = Settings->AnimationBundleUpdateInterval;
+
+	const double Now = GetWorld()->GetRealTimeSeconds();
+	const FTfppTransitionTable& Transitions = FTfppTransitionTable::Get();
+
+	AnimInstances.RemoveAllSwap([](const TWeakObjectPtr<UTfppAnimInstance>& Instance) { return !Instance.IsValid(); });
+	for (const TWeakObjectPtr<UTfppAnimInstance>& Instance : AnimInstances)
+	{
+		const UTfppAnimationSetDatabase* Database = Instance->AnimationSets;
+		const ATfppCharacter* Character = Cast<ATfppCharacter>(Instance->TryGetPawnOwner());
+		const UTfppCharacterMovementComponent* Movement = Character ? Character->GetTfppCharacterMovement() : nullptr;
+		if (!Database || !Movement)
+		{
+			continue;
+		}
+
+		const FPrimaryAssetId AssetId = Database->GetPrimaryAssetId();
+		FDatabaseState& State = Databases.FindOrAdd(AssetId);
+		State.AssetId = AssetId;
+		State.Database = Database;
+
+		const EMobilities Mobility = Movement->GetCurrentMobility();
+		const ECharacterStances Stance = Movement->GetCurrentStance();
+		const EMovementPaces Pace = Movement->GetCurrentPace();
+
+		// Stances and paces the database has no animations for have no bundle to load
+		if (Database->StanceAnimations.Contains(Stance))
+		{
+			NeedBundle(State, UTfppAnimationSetDatabase::GetStanceBundleName(Stance), true, Now);
+		}
+		if (Database->PaceAnimations.Contains(Pace))
+		{
+			NeedBundle(State, UTfppAnimationSetDatabase::GetPaceBundleName(Pace), true, Now);
+		}
+
+		const uint16 ReachableStances = Transitions.GetReachableStances(Mobility, Stance);
+		for (int32 Index = 0; Index < TfppTypes::NumStances; ++Index)
+		{
+			const ECharacterStances Reachable = static_cast<ECharacterStances>(Index);
+			if ((ReachableStances & (1u << Index)) && Reachable != Stance && Database->StanceAnimations.Contains(Reachable))
+			{
+				NeedBundle(State, UTfppAnimationSetDatabase::GetStanceBundleName(Reachable), false, Now);
+			}
+		}
+
+		const uint16 AllowedPaces = Transitions.GetAllowedPaces(Mobility, Stance);
+		for (int32 Index = 0; Index < TfppTypes::NumPaces; ++Index)
+		{
+			const EMovementPaces Allowed = static_cast<EMovementPaces>(Index);
+			if ((AllowedPaces & (1u << Index)) && Allowed != Pace && Database->PaceAnimations.Contains(Allowed))
+			{
+				NeedBundle(State, UTfppAnimationSetDatabase::GetPaceBundleName(Allowed), false, Now);
+			}
+		}
+	}
+
+	// Unload whatever nobody needed for the whole cooldown
+	for (TPair<FPrimaryAssetId, FDatabaseState>& DatabasePair : Databases)
+	{
+		for (TPair<FName, FBundleState>& BundlePair : DatabasePair.Value.Bundles)
+		{
+			FBundleState& Bundle = BundlePair.Value;
+			if (Bundle.bRequested && Now - Bundle.LastNeededTime > Settings->AnimationBundleUnloadCooldown)
+			{
+				ReleaseBundle(DatabasePair.Value, BundlePair.Key, Bundle);
+			}
+		}
+	}
+}
+
+void UTfppAnimationStreamingSubsystem::NeedBundle(FDatabaseState& State, FName BundleName, bool bInUse, double Now)
+{
+	FBundleState& Bundle = State.Bundles.FindOrAdd(BundleName);
+	Bundle.LastNeededTime = Now;
+
+	if (!Bundle.bRequested)
+	{
+		Bundle.bRequested = true;
+		Bundle.bRequestedAhead = !bInUse;
+		Bundle.RequestTime = Now;
+		UAssetManager::Get().ChangeBundleStateForPrimaryAssets({State.AssetId}, {BundleName}, {}, false,
+			FStreamableDelegate::CreateUObject(this, &UTfppAnimationStreamingSubsystem::OnBundleLoaded, State.AssetId, BundleName));
+	}
+
+	// A bundle first requested while already in use is a cold load, not a miss of the streaming ahead of time
+	if (bInUse && Bundle.bRequestedAhead && !Bundle.bLoaded && Bundle.StallStartTime < 0.0)
+	{
+		Bundle.StallStartTime = Now;
+		++NumStalls;
+		INC_DWORD_STAT(STAT_TfppAnimBundleStalls);
+		DEV_LOG_ARGS(Warning, "%s is in use before it finished loading.", *BundleName.ToString());
+	}
+}
+
+void UTfppAnimationStreamingSubsystem::ReleaseBundle(const FDatabaseState& State, FName BundleName, FBundleState& Bundle)
+{
+	UAssetManager::Get().ChangeBundleStateForPrimaryAssets({State.AssetId}, {}, {BundleName});
+
+	if (Bundle.bLoaded)
+	{
+		ResidentBytes -= Bundle.ResidentBytes;
+		DEC_DWORD_STAT(STAT_TfppAnimBundlesResident);
+		DEC_MEMORY_STAT_BY(STAT_TfppAnimBundleMemory, Bundle.ResidentBytes);
+	}
+	Bundle = FBundleState();
+}
+
+void UTfppAnimationStreamingSubsystem::OnBundleLoaded(FPrimaryAssetId AssetId, FName BundleName)
+{
+	FDatabaseState* State = Databases.Find(AssetId);
+	FBundleState* Bundle = State ? State->Bundles.Find(BundleName) : nullptr;
+	if (!Bundle || !Bundle->bRequested || Bundle->bLoaded)
+	{
+		// Released before the load finished
+		return;
+	}
+
+	Bundle->bLoaded = true;
+	Bundle->ResidentBytes = 0;
+	if (const UTfppAnimationSetDatabase* Database = State->Database.Get())
+	{
+		if (const FTfppAnimationSet* Set = Database->FindAnimationSet(BundleName))
+		{
+			for (const TSoftObjectPtr<UAnimationAsset>& Animation : Set->Animations)
+			{
+				if (const UAnimationAsset* Asset = Animation.Get())
+				{
+					Bundle->ResidentBytes += Asset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+				}
+			}
+		}
+	}
+
+	const double Now = GetWorld()->GetRealTimeSeconds();
+	if (Bundle->StallStartTime >= 0.0)
+	{
+		LongestStallSeconds = FMath::Max(LongestStallSeconds, Now - Bundle->StallStartTime);
+		Bundle->StallStartTime = -1.0;
+	}
+
+	ResidentBytes += Bundle->ResidentBytes;
+	PeakResidentBytes = FMath::Max(PeakResidentBytes, ResidentBytes);
+	INC_DWORD_STAT(STAT_TfppAnimBundlesResident);
+	INC_MEMORY_STAT_BY(STAT_TfppAnimBundleMemory, Bundle->ResidentBytes);
+	DEV_LOG_ARGS(Verbose, "Loaded %s in %.3fs, %lld bytes.", *BundleName.ToString(), Now - Bundle->RequestTime, Bundle->ResidentBytes);
+}
+
+void UTfppAnimationStreamingSubsystem::DumpState(FOutputDevice& Ar) const
+{
+	for (const TPair<FPrimaryAssetId, FDatabaseState>& DatabasePair : Databases)
+	{
+		Ar.Logf(TEXT("%s"), *DatabasePair.Key.ToString());
+		for (const TPair<FName, FBundleState>& BundlePair : DatabasePair.Value.Bundles)
+		{
+			const FBundleState& Bundle = BundlePair.Value;
+			Ar.Logf(TEXT("  %s: %s, %lld bytes"), *BundlePair.Key.ToString(),
+				Bundle.bLoaded ? TEXT("loaded") : (Bundle.bRequested ? TEXT("loading") : TEXT("unloaded")), Bundle.ResidentBytes);
+		}
+	}
+	Ar.Logf(TEXT("Resident %lld bytes, peak %lld bytes, %d load stalls, longest %.3fs"),
+		ResidentBytes, PeakResidentBytes, NumStalls, LongestStallSeconds);
+}
+
+TStatId UTfppAnimationStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTfppAnimationStreamingSubsystem, STATGROUP_Tickables);
+}
+
+bool UTfppAnimationStreamingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs TfppAnimBundlesCommand(
+	TEXT("Tfpp.AnimBundles"),
+	TEXT("Lists the TFPP animation bundles of the world with their resident memory, peak memory and load stalls."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const UTfppAnimationStreamingSubsystem* Subsystem = World ? World->GetSubsystem<UTfppAnimationStreamingSubsystem>() : nullptr)
+		{
+			Subsystem->DumpState(*GLog);
+		}
+	}));
@@ -0,0 +1,120 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppCameraCollisionComponent.h"
+#include "TfppStats.h"
+#include "Camera/CameraComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+
+UTfppCameraCollisionComponent::UTfppCameraCollisionComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// The head has to be animated already, and the camera managers are updated right after this group
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UTfppCameraCollisionComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Camera = GetOwner()->FindComponentByClass<UCameraComponent>();
+	if (Camera)
+	{
+		DefaultRelativeLocation = Camera->GetRelativeLocation();
+		const ACharacter* Character = Cast<ACharacter>(GetOwner());
+		if (Character && Character->GetMesh())
+		{
+			// Read the neck once this frame's pose is in
+			AddTickPrerequisiteComponent(Character->GetMesh());
+		}
+	}
+	else
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UTfppCameraCollisionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppCameraCollision);
+
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (!Character || !Character->IsLocallyControlled() || !Camera)
+	{
+		return;
+	}
+
+	const FVector Neck = Character->GetMesh()->GetSocketLocation(NeckSocketName);
+	const FVector DesiredCamera = GetDesiredCameraLocation();
+
+	if (PendingSweep.IsValid())
+	{
+		FTraceDatum Datum;
+		if (GetWorld()->QueryTraceData(PendingSweep, Datum))
+		{
+			const FHitResult* Hit = FHitResult::GetFirstBlockingHit(Datum.OutHits);
+			SafeFraction = Hit ? Hit->Time : 1.f;
+			PendingSweep = FTraceHandle();
+		}
+		else if (!GetWorld()->IsTraceHandleValid(PendingSweep, false))
+		{
+			// The result expired before it could be read, sweep again
+			PendingSweep = FTraceHandle();
+			LastNeck = FVector(UE_BIG_NUMBER);
+		}
+	}
+
+	const float ThresholdSq = FMath::Square(HeadMotionThreshold);
+	const bool bHeadMoved = FVector::DistSquared(Neck, LastNeck) > ThresholdSq
+		|| FVector::DistSquared(DesiredCamera, LastDesiredCamera) > ThresholdSq;
+
+	if (bHeadMoved)
+	{
+		LastNeck = Neck;
+		LastDesiredCamera = DesiredCamera;
+		INC_DWORD_STAT(STAT_TfppCameraSweeps);
+
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(TfppCameraCollision), false, GetOwner());
+		const FCollisionShape Shape = FCollisionShape::MakeSphere(ProbeRadius);
+		if (bUseAsyncSweep)
+		{
+			PendingSweep = GetWorld()->AsyncSweepByChannel(EAsyncTraceType::Single, Neck, DesiredCamera, FQuat::Identity, ProbeChannel, Shape, Params);
+		}
+		else
+		{
+			FHitResult Hit;
+			SafeFraction = GetWorld()->SweepSingleByChannel(Hit, Neck, DesiredCamera, FQuat::Identity, ProbeChannel, Shape, Params)
+				? Hit.Time
+				: 1.f;
+		}
+	}
+
+	ApplyFraction(SafeFraction, Neck, DesiredCamera);
+}
+
+void UTfppCameraCollisionComponent::ApplyFraction(float Fraction, const FVector& Neck, const FVector& DesiredCamera)
+{
+	if (Fraction >= 1.f)
+	{
+		Camera->SetRelativeLocation(DefaultRelativeLocation);
+		NearGeometryAlpha = 0.f;
+		return;
+	}
+
+	const FVector SafeCamera = FMath::Lerp(Neck, DesiredCamera, Fraction);
+	Camera->SetWorldLocation(SafeCamera);
+	NearGeometryAlpha = FMath::Clamp(FVector::Dist(SafeCamera, DesiredCamera) / FadeDistance, 0.f, 1.f);
+}
+
+FVector UTfppCameraCollisionComponent::GetDesiredCameraLocation() const
+{
+	const USceneComponent* Parent = Camera->GetAttachParent();
+	if (!Parent)
+	{
+		return Camera->GetComponentLocation();
+	}
+	return Parent->GetSocketTransform(Camera->GetAttachSocketName()).TransformPosition(DefaultRelativeLocation);
+}
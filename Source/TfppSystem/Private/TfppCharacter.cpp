@@ -4,23 +4,41 @@
 #include "TfppSystem/Public/TfppCharacter.h"
 
 #include "TfppCharacterMovementComponent.h"
+#include "TfppAnimationBudget.h"
+#include "TfppStats.h"
+#include "TfppTelemetry.h"
+#include "TfppDevSettings.h"
+#include "TfppHeadHistory.h"
+#include "TfppLog.h"
 #include "Camera/CameraComponent.h"
+#include "Components/SkeletalMeshComponent.h"
 #include "Math/UnrealMathUtility.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "Engine/World.h"
 #include "GameFramework/PlayerController.h"
 
 // Sets default values
 ATfppCharacter::ATfppCharacter(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer.SetDefaultSubobjectClass<UTfppCharacterMovementComponent>(
-		  ATfppCharacter::CharacterMovementComponentName)), PlayerController(nullptr), AdjustedViewRotation()
+		  ATfppCharacter::CharacterMovementComponentName)
+		  .SetDefaultSubobjectClass<USkeletalMeshComponentBudgeted>(ACharacter::MeshComponentName)), PlayerController(nullptr), AdjustedViewRotation()
 {
 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	// The animation budget subsystem decides whether the mesh is budgeted, it has to stay out for local players
+	if (USkeletalMeshComponentBudgeted* BudgetedMesh = Cast<USkeletalMeshComponentBudgeted>(GetMesh()))
+	{
+		BudgetedMesh->SetAutoRegisterWithBudgetAllocator(false);
+	}
+
 	TfppCharacterMovement = Cast<UTfppCharacterMovementComponent>(ACharacter::GetMovementComponent());
 }
 
 void ATfppCharacter::SetPace(EMovementPaces NewPace)
 {
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppSetPace);
+
 	if (TfppCharacterMovement)
 	{
 		TfppCharacterMovement->SetPace(NewPace);
@@ -33,7 +51,9 @@ void ATfppCharacter::SetPace(EMovementPaces NewPace)
 
 void ATfppCharacter::SetStance(ECharacterStances NewStance)
 {
-	if (!TfppCharacterMovement)
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppSetStance);
+
+	if (!TfppCharacterMovement || !TfppCharacterMovement->CanEnterStance(NewStance))
 	{
 		return;
 	}
@@ -56,6 +76,8 @@ void ATfppCharacter::SetStance(ECharacterStances NewStance)
 
 FVector2D ATfppCharacter::GetMovingDirection() const
 {
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppGetMovingDirection);
+
 	FVector Velocity = GetCharacterMovement()->Velocity;
 	FVector Local = GetActorRotation().UnrotateVector(Velocity);
 	FVector2D Dir2D = FVector2D(Local.X, Local.Y).GetSafeNormal();
@@ -66,14 +88,32 @@ FVector2D ATfppCharacter::GetMovingDirection() const
 	return InputLikeDir;
 }
 
+FRotator ATfppCharacter::GetAdjustedViewRotation()
+{
+	if (bUseDedicatedServerProfile && ViewRotationFrame != GFrameCounter && GetController())
+	{
+		ViewRotationFrame = GFrameCounter;
+		CalculateViewRotation();
+	}
+	return AdjustedViewRotation;
+}
+
 void ATfppCharacter::CalculateViewRotation()
 {
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppCalculateViewRotation);
+
 	AdjustedViewRotation = FRotator(ProcessPitch(), ProcessYaw(), 0.f);
 }
 
 float ATfppCharacter::ProcessPitch() const
 {
-	return FMath::ClampAngle(GetControlRotation().Pitch, PitchRange.X, PitchRange.Y);
+	const float Pitch = FRotator::NormalizeAxis(GetControlRotation().Pitch);
+	const float ClampedPitch = FMath::ClampAngle(Pitch, PitchRange.X, PitchRange.Y);
+	if (!FMath::IsNearlyEqual(Pitch, ClampedPitch))
+	{
+		TfppTelemetry::AddPitchClampHit();
+	}
+	return ClampedPitch;
 }
 
 float ATfppCharacter::ProcessYaw() const
@@ -88,22 +128,93 @@ void ATfppCharacter::BeginPlay()
 
 	// Get a reference to the player controller
 	PlayerController = Cast<APlayerController>(GetController());
-	
+
+	if (GetNetMode() == NM_DedicatedServer && UTfppDevSettings::Get()->bUseDedicatedServerProfile)
+	{
+		ApplyDedicatedServerProfile();
+	}
+
+	if (UTfppAnimationBudgetSubsystem* AnimationBudget = GetWorld()->GetSubsystem<UTfppAnimationBudgetSubsystem>())
+	{
+		AnimationBudget->RegisterCharacter(this);
+	}
+
+	TfppStats::AddActivePawn();
+	TfppTelemetry::AddActivePawn();
+}
+
+void ATfppCharacter::ApplyDedicatedServerProfile()
+{
+	bUseDedicatedServerProfile = true;
+
+	// The actor tick only keeps the view rotation up to date, so it can go away unless a blueprint needs it.
+	if (!GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AActor, ReceiveTick)))
+	{
+		SetActorTickEnabled(false);
+	}
+
+	// Lag compensation needs the head to keep moving on the server
+	USkeletalMeshComponent* MeshComponent = GetMesh();
+	if (MeshComponent && !FindComponentByClass<UTfppHeadHistoryComponent>())
+	{
+		MeshComponent->VisibilityBasedAnimTickOption = UTfppDevSettings::Get()->DedicatedServerAnimTickOption;
+	}
+
+	DEV_LOG_ARGS(Verbose, "%s is using the dedicated server profile.", *GetName());
+}
+
+void ATfppCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTfppAnimationBudgetSubsystem* AnimationBudget = GetWorld()->GetSubsystem<UTfppAnimationBudgetSubsystem>())
+	{
+		AnimationBudget->UnregisterCharacter(this);
+	}
+
+	TfppStats::RemoveActivePawn();
+	TfppTelemetry::RemoveActivePawn();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
 // Called every frame
 void ATfppCharacter::Tick(float DeltaTime)
 {
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppCharacterTick);
+
 	Super::Tick(DeltaTime);
 
-	if (PlayerController)
+	// The control rotation only changes once per frame, so even with the fixed simulation rate the view rotation is
+	// calculated once per frame, stepping it would only add latency
+	if (PlayerController && !bUseDedicatedServerProfile)
 	{
 		CalculateViewRotation();
 	}
 	
 }
 
+void ATfppCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	// Pawns possessed after BeginPlay, like every player pawn on a listen server, would never update their view
+	PlayerController = Cast<APlayerController>(GetController());
+}
+
+void ATfppCharacter::UnPossessed()
+{
+	Super::UnPossessed();
+
+	PlayerController = nullptr;
+}
+
+void ATfppCharacter::OnRep_Controller()
+{
+	Super::OnRep_Controller();
+
+	PlayerController = Cast<APlayerController>(GetController());
+}
+
 // Called to bind functionality to input
 void ATfppCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
@@ -2,12 +2,87 @@
 
 
 #include "TfppCharacterMovementComponent.h"
+#include "TfppDevSettings.h"
 #include "TfppLog.h"
+#include "TfppStats.h"
+#include "TfppTelemetry.h"
+#include "TfppTransitionGraph.h"
+#include "TfppTraversal.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/Character.h"
+#include "Engine/World.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+/** Saved move carrying the mantle request to the server and through replays. */
+class FTfppSavedMove : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override
+	{
+		Super::Clear();
+		bWantsToMantle = false;
+	}
+
+	virtual uint8 GetCompressedFlags() const override
+	{
+		uint8 Flags = Super::GetCompressedFlags();
+		if (bWantsToMantle)
+		{
+			Flags |= FLAG_Custom_0;
+		}
+		return Flags;
+	}
+
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override
+	{
+		return bWantsToMantle == static_cast<const FTfppSavedMove*>(NewMove.Get())->bWantsToMantle
+			&& Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+	}
+
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override
+	{
+		Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+		if (const UTfppCharacterMovementComponent* Movement = Cast<UTfppCharacterMovementComponent>(C->GetCharacterMovement()))
+		{
+			bWantsToMantle = Movement->bWantsToMantle;
+		}
+	}
+
+	virtual void PrepMoveFor(ACharacter* C) override
+	{
+		Super::PrepMoveFor(C);
+		if (UTfppCharacterMovementComponent* Movement = Cast<UTfppCharacterMovementComponent>(C->GetCharacterMovement()))
+		{
+			Movement->bWantsToMantle = bWantsToMantle;
+		}
+	}
+
+	bool bWantsToMantle = false;
+};
+
+class FTfppNetworkPredictionData_Client : public FNetworkPredictionData_Client_Character
+{
+public:
+	explicit FTfppNetworkPredictionData_Client(const UCharacterMovementComponent& ClientMovement)
+		: FNetworkPredictionData_Client_Character(ClientMovement)
+	{
+	}
+
+	virtual FSavedMovePtr AllocateNewMove() override
+	{
+		return FSavedMovePtr(new FTfppSavedMove());
+	}
+};
 
 // Sets default values for this component's properties
 UTfppCharacterMovementComponent::UTfppCharacterMovementComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
+	bWantsToMantle = false;
 	bUseControllerDesiredRotation = true;
 	RotationRate = FRotator(0.0f, -1.0f, 0.0f);
 	PacesAngleRestriction.Empty();
@@ -18,43 +93,219 @@ void UTfppCharacterMovementComponent::BeginPlay()
 {
 	Super::BeginPlay();
 	InitializeTfppComponent();
+
+	// Only a server has remote players to validate
+	if (UTfppDevSettings::Get()->bValidateSpeed && CharacterOwner && CharacterOwner->HasAuthority() && !IsNetMode(NM_Standalone))
+	{
+		if (UTfppSpeedValidationSubsystem* SpeedValidation = GetWorld()->GetSubsystem<UTfppSpeedValidationSubsystem>())
+		{
+			SpeedValidation->RegisterMovement(this);
+		}
+	}
+}
+
+void UTfppCharacterMovementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bValidatingSpeed)
+	{
+		if (UTfppSpeedValidationSubsystem* SpeedValidation = GetWorld()->GetSubsystem<UTfppSpeedValidationSubsystem>())
+		{
+			SpeedValidation->UnregisterMovement(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTfppCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	if (!UsesFixedSimulationRate())
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+		return;
+	}
+
+	const UTfppDevSettings* Settings = UTfppDevSettings::Get();
+	const float StepTime = 1.f / Settings->FixedSimulationRate;
+	const int32 NumSteps = FixedStep.Advance(DeltaTime, StepTime, Settings->MaxSimulationStepsPerFrame);
+
+	// The first step consumes the input of the frame, the next ones get it again
+	const FVector Input = PawnOwner->GetPendingMovementInputVector();
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		if (Step > 0)
+		{
+			PawnOwner->AddMovementInput(Input, 1.f, true);
+		}
+		PreviousStepLocation = UpdatedComponent->GetComponentLocation();
+		INC_DWORD_STAT(STAT_TfppSimulationSteps);
+		Super::TickComponent(StepTime, TickType, ThisTickFunction);
+	}
+
+	if (!IsNetMode(NM_DedicatedServer))
+	{
+		UpdateFixedStepMeshOffset(StepTime);
+	}
+}
+
+bool UTfppCharacterMovementComponent::UsesFixedSimulationRate() const
+{
+	if (!UTfppDevSettings::Get()->bUseFixedSimulationRate || !CharacterOwner || !UpdatedComponent)
+	{
+		return false;
+	}
+	const ENetRole Role = CharacterOwner->GetLocalRole();
+	return Role == ROLE_AutonomousProxy || (Role == ROLE_Authority && CharacterOwner->IsLocallyControlled());
+}
+
+void UTfppCharacterMovementComponent::UpdateFixedStepMeshOffset(float StepTime)
+{
+	USkeletalMeshComponent* Mesh = CharacterOwner->GetMesh();
+	if (!Mesh)
+	{
+		return;
+	}
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector StepDelta = Location - PreviousStepLocation;
+
+	FVector Offset = FVector::ZeroVector;
+	if (UTfppDevSettings::Get()->bExtrapolateFixedSimulation)
+	{
+		Offset = Velocity * FixedStep.Accumulator;
+	}
+	else if (StepDelta.SizeSquared() <= FMath::Square(Velocity.Size() * StepTime * 2.f + 10.f))
+	{
+		// Anything faster than the velocity allows is a teleport and isn't interpolated
+		Offset = -StepDelta * (1.f - FixedStep.GetAlpha(StepTime));
+	}
+
+	Mesh->SetRelativeLocation(CharacterOwner->GetBaseTranslationOffset()
+		+ UpdatedComponent->GetComponentTransform().InverseTransformVectorNoScale(Offset));
 }
 
 void UTfppCharacterMovementComponent::InitializeTfppComponent()
 {
-	MaxWalkSpeed = PaceMaxSpeed[DefaultPace];
-	MaxWalkSpeedCrouched = PaceMaxSpeed[DefaultPace] * StanceSpeedMultiplier[CrouchingStance];
+	if (bRestoredFromSnapshot)
+	{
+		// Listeners bound before BeginPlay already saw nothing change, there is nothing to broadcast
+		bRestoredFromSnapshot = false;
+		DEV_LOG_ARGS(Verbose, "Kept restored Pace %s.", *UEnum::GetValueAsString(CurrentPace));
+		return;
+	}
+
 	CurrentPace = DefaultPace;
+	ApplyPaceSpeeds();
 	OnPaceChanged.Broadcast(DefaultPace, CurrentPace);
 	OnStanceChanged.Broadcast(ECharacterStances::StanceType0, CurrentStance);
 	DEV_LOG_ARGS(Verbose, "Initialized Pace to %s.", *UEnum::GetValueAsString(CurrentPace));
 }
 
+void UTfppCharacterMovementComponent::RestoreTfppState(EMovementPaces Pace, ECharacterStances Stance)
+{
+	const EMovementPaces OldPace = CurrentPace;
+	const ECharacterStances OldStance = CurrentStance;
+	if (PaceMaxSpeed.Contains(Pace))
+	{
+		CurrentPace = Pace;
+	}
+	if (StanceSpeedMultiplier.Contains(Stance))
+	{
+		CurrentStance = Stance;
+	}
+	ApplyPaceSpeeds();
+
+	// Before BeginPlay nobody saw the old values, afterwards listeners have to follow the restored ones
+	bRestoredFromSnapshot = !HasBegunPlay();
+	if (bRestoredFromSnapshot)
+	{
+		return;
+	}
+	if (CurrentPace != OldPace)
+	{
+		OnPaceChanged.Broadcast(OldPace, CurrentPace);
+	}
+	if (CurrentStance != OldStance)
+	{
+		OnStanceChanged.Broadcast(OldStance, CurrentStance);
+	}
+}
+
 void UTfppCharacterMovementComponent::SetPace(EMovementPaces NewPace)
 {
+	ChangePace(NewPace, true);
+}
+
+void UTfppCharacterMovementComponent::ChangePace(EMovementPaces NewPace, bool bCheckDirectionAngle)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppMovementSetPace);
+
+	// Fall back to the fastest pace the current stance and mobility allow
+	if (!FTfppTransitionTable::Get().GetBestAllowedPace(GetCurrentMobility(), CurrentStance, NewPace, NewPace))
+	{
+		return;
+	}
 
-	if (NewPace != CurrentPace && PaceMaxSpeed.Contains(NewPace))
+	if (NewPace != CurrentPace && PaceMaxSpeed.Contains(NewPace) && (!bCheckDirectionAngle || IsPaceAllowedOnDirectionAngle(NewPace)))
 	{
 		DEV_LOG_ARGS(Verbose, "Changing Pace to %s.", *UEnum::GetValueAsString(NewPace));
-		MaxWalkSpeed = PaceMaxSpeed[NewPace];
-		MaxWalkSpeedCrouched = PaceMaxSpeed[NewPace] * StanceSpeedMultiplier[CrouchingStance];
 		const EMovementPaces OldPace = CurrentPace;
 		CurrentPace = NewPace;
+		ApplyPaceSpeeds();
+		TfppStats::AddPaceTransition();
+		TfppTelemetry::AddPaceChange(CurrentPace);
 		OnPaceChanged.Broadcast(OldPace, CurrentPace);
 	}
 }
 
 void UTfppCharacterMovementComponent::SetStance(ECharacterStances NewStance)
 {
-	if (NewStance == CurrentStance)
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppMovementSetStance);
+
+	if (NewStance == CurrentStance || !CanEnterStance(NewStance))
 	{
 		return;
 	}
 	const ECharacterStances OldStance = CurrentStance;
 	CurrentStance = NewStance;
+	if (SurfaceMaterial.IsValid())
+	{
+		// The surface may slow some stances more than others
+		ApplyPaceSpeeds();
+	}
+	TfppStats::AddStanceTransition();
+	TfppTelemetry::AddStanceChange(NewStance);
+
+	// The new stance may not allow the pace we were using. The downgrade can't be refused because of the direction,
+	// and it happens before the broadcast so listeners see a pace the stance allows
+	if (!FTfppTransitionTable::Get().CanUsePace(GetCurrentMobility(), CurrentStance, CurrentPace))
+	{
+		ChangePace(CurrentPace, false);
+	}
 	OnStanceChanged.Broadcast(OldStance, NewStance);
 }
 
+EMobilities UTfppCharacterMovementComponent::GetCurrentMobility() const
+{
+	if (MovementMode == MOVE_Custom && CustomMovementMode < TfppTypes::NumMobilities)
+	{
+		return static_cast<EMobilities>(CustomMovementMode);
+	}
+	return EMobilities::MobilityType0;
+}
+
+bool UTfppCharacterMovementComponent::CanEnterStance(ECharacterStances NewStance) const
+{
+	return FTfppTransitionTable::Get().CanEnterStance(GetCurrentMobility(), CurrentStance, NewStance);
+}
+
+EMovementPaces UTfppCharacterMovementComponent::GetBestAllowedPace(EMovementPaces RequestedPace) const
+{
+	EMovementPaces BestPace = CurrentPace;
+	FTfppTransitionTable::Get().GetBestAllowedPace(GetCurrentMobility(), CurrentStance, RequestedPace, BestPace);
+	return BestPace;
+}
+
 void UTfppCharacterMovementComponent::InitializeDefaultPacesSpeed()
 {
 	PaceMaxSpeed.Add(EMovementPaces::PaceType0, 200.0f);
@@ -66,32 +317,426 @@ void UTfppCharacterMovementComponent::InitializeDefaultPacesSpeed()
 	MaxWalkSpeedCrouched = PaceMaxSpeed[DefaultPace] * StanceSpeedMultiplier[ECharacterStances::StanceType1];
 }
 
+void UTfppCharacterMovementComponent::ApplyPaceSpeeds()
+{
+	const float* PaceSpeed = PaceMaxSpeed.Find(CurrentPace);
+	if (!PaceSpeed)
+	{
+		return;
+	}
+
+	MaxWalkSpeed = *PaceSpeed * GetSurfaceMultiplier(CurrentPace, CurrentStance);
+	MaxWalkSpeedCrouched = *PaceSpeed * StanceSpeedMultiplier[CrouchingStance] * GetSurfaceMultiplier(CurrentPace, CrouchingStance);
+}
+
+float UTfppCharacterMovementComponent::GetSurfaceMultiplier(EMovementPaces Pace, ECharacterStances Stance) const
+{
+	const FTfppSurfaceSpeedModifier* Modifier = SurfaceMaterial.IsValid() ? SurfaceSpeedModifiers.Find(SurfaceMaterial.Get()) : nullptr;
+	if (!Modifier)
+	{
+		return 1.f;
+	}
+
+	const float* PaceMultiplier = Modifier->PaceMultipliers.Find(Pace);
+	const float* StanceMultiplier = Modifier->StanceMultipliers.Find(Stance);
+	return Modifier->Multiplier * (PaceMultiplier ? *PaceMultiplier : 1.f) * (StanceMultiplier ? *StanceMultiplier : 1.f);
+}
+
+float UTfppCharacterMovementComponent::GetPaceSpeedLimit() const
+{
+	const ECharacterStances Stance = IsCrouching() ? CrouchingStance : CurrentStance;
+	const float* CrouchMultiplier = IsCrouching() ? StanceSpeedMultiplier.Find(CrouchingStance) : nullptr;
+	const uint16 AllowedPaces = FTfppTransitionTable::Get().GetAllowedPaces(GetCurrentMobility(), CurrentStance);
+
+	float SpeedLimit = 0.f;
+	for (const TPair<EMovementPaces, float>& Pair : PaceMaxSpeed)
+	{
+		if (AllowedPaces & (1u << static_cast<uint8>(Pair.Key)))
+		{
+			SpeedLimit = FMath::Max(SpeedLimit, Pair.Value * GetSurfaceMultiplier(Pair.Key, Stance));
+		}
+	}
+	return SpeedLimit * (CrouchMultiplier ? *CrouchMultiplier : 1.f);
+}
+
+void UTfppCharacterMovementComponent::RecordSpeed(float DeltaSeconds, const FVector& OldLocation)
+{
+	// Moving bases and root motion move the character on their own
+	if (!IsMovingOnGround() || DeltaSeconds <= 0.f || CharacterOwner->IsLocallyControlled()
+		|| MovementBaseUtility::IsDynamicBase(GetMovementBase()) || HasRootMotionSources() || CharacterOwner->IsPlayingNetworkedRootMotionMontage())
+	{
+		return;
+	}
+
+	SpeedAccumulator.Add(FVector::Dist2D(UpdatedComponent->GetComponentLocation(), OldLocation), DeltaSeconds, GetPaceSpeedLimit());
+}
+
+void UTfppCharacterMovementComponent::RevertToValidatedLocation()
+{
+	UpdatedComponent->SetWorldLocation(LastValidatedLocation, false, nullptr, ETeleportType::TeleportPhysics);
+	Velocity = FVector::ZeroVector;
+
+	// Make sure the client gets the correction even if it thinks it is where the server is
+	if (FNetworkPredictionData_Server_Character* ServerData = GetPredictionData_Server_Character())
+	{
+		ServerData->bForceClientUpdate = true;
+	}
+}
+
+void UTfppCharacterMovementComponent::SendClientAdjustment()
+{
+	// Every move found in error since the last adjustment ends up in the same one, count what the client receives
+	const FNetworkPredictionData_Server_Character* ServerData = HasPredictionData_Server() ? GetPredictionData_Server_Character() : nullptr;
+	const bool bPendingCorrection = ServerData && ServerData->PendingAdjustment.TimeStamp > 0.f && !ServerData->PendingAdjustment.bAckGoodMove;
+
+	Super::SendClientAdjustment();
+
+	// The pending adjustment is cleared once sent
+	if (!bPendingCorrection || ServerData->PendingAdjustment.TimeStamp > 0.f)
+	{
+		return;
+	}
+
+	++NumServerCorrections;
+	INC_DWORD_STAT(STAT_TfppServerCorrections);
+
+	const UNetConnection* Connection = CharacterOwner ? CharacterOwner->GetNetConnection() : nullptr;
+	const double Window = (Connection ? Connection->AvgLag : 0.0) + OutOfBandCorrectionMargin;
+	if (OutOfBandChangeTime >= 0.0 && GetWorld()->GetTimeSeconds() - OutOfBandChangeTime <= Window)
+	{
+		++NumOutOfBandCorrections;
+	}
+}
+
+void UTfppCharacterMovementComponent::MarkOutOfBandStateChange()
+{
+	OutOfBandChangeTime = GetWorld()->GetTimeSeconds();
+}
+
+void UTfppCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+	UpdateSurface();
+
+	if (bValidatingSpeed)
+	{
+		RecordSpeed(DeltaSeconds, OldLocation);
+	}
+}
+
+void UTfppCharacterMovementComponent::UpdateSurface()
+{
+	// The last surface is kept while airborne, the floor of the landing decides
+	if (SurfaceSpeedModifiers.IsEmpty() || !IsMovingOnGround())
+	{
+		return;
+	}
+
+	const FHitResult& Hit = CurrentFloor.HitResult;
+	UPrimitiveComponent* Floor = Hit.GetComponent();
+	if (Floor == SurfaceFloor.Get() && Hit.Item == SurfaceFloorItem)
+	{
+		// Landscapes and meshes with several materials can change material without changing primitive, they are
+		// traced again once the character moved far enough
+		if (!Floor || Floor->GetNumMaterials() == 1
+			|| FVector::DistSquared2D(Hit.ImpactPoint, SurfaceTraceLocation) < FMath::Square(SurfaceRetraceDistance))
+		{
+			return;
+		}
+	}
+	SurfaceFloor = Floor;
+	SurfaceFloorItem = Hit.Item;
+	SurfaceTraceLocation = Hit.ImpactPoint;
+
+	// The floor sweep doesn't return physical materials, a line trace against the complex collision of the floor
+	// alone gets the material of the face under the character
+	const UPhysicalMaterial* Material = nullptr;
+	if (Floor)
+	{
+		INC_DWORD_STAT(STAT_TfppSurfaceResolves);
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(TfppSurface), true);
+		Params.bReturnPhysicalMaterial = true;
+		FHitResult SurfaceHit;
+		const FVector Up = UpdatedComponent->GetUpVector() * SurfaceTraceHalfLength;
+		if (Floor->LineTraceComponent(SurfaceHit, Hit.ImpactPoint + Up, Hit.ImpactPoint - Up, Params))
+		{
+			Material = SurfaceHit.PhysMaterial.Get();
+		}
+		if (!Material)
+		{
+			Material = Floor->BodyInstance.GetSimplePhysicalMaterial();
+		}
+	}
+
+	if (Material != SurfaceMaterial.Get())
+	{
+		SurfaceMaterial = Material;
+		ApplyPaceSpeeds();
+	}
+}
+
+FNetworkPredictionData_Client* UTfppCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		UTfppCharacterMovementComponent* MutableThis = const_cast<UTfppCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FTfppNetworkPredictionData_Client(*this);
+	}
+	return ClientPredictionData;
+}
+
+void UTfppCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+	bWantsToMantle = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+}
+
+void UTfppCharacterMovementComponent::Mantle()
+{
+	bWantsToMantle = true;
+}
+
+bool UTfppCharacterMovementComponent::IsMantling() const
+{
+	return MovementMode == MOVE_Custom && CustomMovementMode == static_cast<uint8>(MantleMobility);
+}
+
+void UTfppCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	if (bWantsToMantle)
+	{
+		bWantsToMantle = false;
+		if (!IsMantling() && (IsMovingOnGround() || IsFalling()))
+		{
+			StartMantle();
+		}
+	}
+}
+
+bool UTfppCharacterMovementComponent::StartMantle()
+{
+	const UTfppTraversalSubsystem* Traversal = GetWorld()->GetSubsystem<UTfppTraversalSubsystem>();
+	if (!Traversal || !CharacterOwner)
+	{
+		return false;
+	}
+
+	float Radius = 0.f;
+	float HalfHeight = 0.f;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+
+	FTfppTraversalQuery Query;
+	Query.Location = Location - FVector(0.0, 0.0, HalfHeight);
+	Query.Direction = Acceleration.GetSafeNormal2D(UE_SMALL_NUMBER, UpdatedComponent->GetForwardVector().GetSafeNormal2D());
+	Query.Reach = MantleReach;
+	Query.MinHeight = MinMantleHeight;
+	Query.MaxHeight = MaxMantleHeight;
+	Query.MinFacing = FMath::Cos(FMath::DegreesToRadians(MantleMaxAngle));
+
+	FTfppTraversalHit Hit;
+	if (!Traversal->FindEdge(Query, Hit))
+	{
+		return false;
+	}
+
+	// Land on top of the ledge, or behind the obstacle when vaulting. A little above the floor so the sweep doesn't touch it
+	const FVector Normal(Hit.Edge.Normal.X, Hit.Edge.Normal.Y, 0.0);
+	const bool bVault = bVaultWhenPossible && Hit.Edge.IsVaultable();
+	const FVector Up(0.0, 0.0, HalfHeight + MAX_FLOOR_DIST);
+	const FVector Top = Hit.Point + Up;
+	const FVector Target = bVault
+		? Hit.Point - Normal * (Hit.Edge.Depth + Radius) - FVector(0.0, 0.0, Hit.Edge.LandingDrop) + Up
+		: Hit.Point - Normal * Radius + Up;
+
+	MantlePath.Reset();
+	MantlePath.Add(Location);
+	MantlePath.Add(FVector(Location.X, Location.Y, FMath::Max(Top.Z, Target.Z)));
+	if (bVault)
+	{
+		MantlePath.Add(FVector(Target.X, Target.Y, Top.Z));
+	}
+	MantlePath.Add(Target);
+	MantleDistance = 0.f;
+
+	// The only traces of the mantle: the baked data knows neither overhangs nor what moved since, the character has
+	// to fit along the whole path. It starts against the ledge, the radius is shrunk so touching it doesn't count
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TfppMantle), false, CharacterOwner);
+	FCollisionResponseParams ResponseParams;
+	InitCollisionParams(QueryParams, ResponseParams);
+	const FCollisionShape Capsule = GetPawnCapsuleCollisionShape(SHRINK_RadiusCustom, MAX_FLOOR_DIST);
+	for (int32 Index = 1; Index < MantlePath.Num(); ++Index)
+	{
+		if (GetWorld()->SweepTestByChannel(MantlePath[Index - 1], MantlePath[Index], FQuat::Identity,
+			UpdatedComponent->GetCollisionObjectType(), Capsule, QueryParams, ResponseParams))
+		{
+			MantlePath.Reset();
+			return false;
+		}
+	}
+
+	INC_DWORD_STAT(STAT_TfppMantles);
+	DEV_LOG_ARGS(Verbose, "%s is %s a %.0f cm ledge.", *CharacterOwner->GetName(), bVault ? TEXT("vaulting") : TEXT("mantling"), Hit.Edge.Height);
+	SetMovementMode(MOVE_Custom, static_cast<uint8>(MantleMobility));
+	return true;
+}
+
+void UTfppCharacterMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (IsMantling())
+	{
+		PhysMantle(deltaTime);
+		return;
+	}
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void UTfppCharacterMovementComponent::PhysMantle(float DeltaTime)
+{
+	if (MantlePath.Num() < 2)
+	{
+		// Put in the mobility without a ledge to mantle
+		SetMovementMode(MOVE_Falling);
+		return;
+	}
+	if (DeltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	MantleDistance += MantleSpeed * DeltaTime;
+
+	// Find where the travelled distance ends up on the path
+	FVector Position = MantlePath.Last();
+	bool bFinished = true;
+	float Remaining = MantleDistance;
+	for (int32 Index = 1; Index < MantlePath.Num(); ++Index)
+	{
+		const float SegmentLength = FVector::Dist(MantlePath[Index - 1], MantlePath[Index]);
+		if (Remaining < SegmentLength)
+		{
+			Position = FMath::Lerp(MantlePath[Index - 1], MantlePath[Index], Remaining / SegmentLength);
+			bFinished = false;
+			break;
+		}
+		Remaining -= SegmentLength;
+	}
+
+	// The path was swept when the mantle started, sweeping again would stop the character against the ledge
+	const FVector Delta = Position - UpdatedComponent->GetComponentLocation();
+	MoveUpdatedComponent(Delta, UpdatedComponent->GetComponentQuat(), false);
+	Velocity = Delta / DeltaTime;
+
+	if (bFinished)
+	{
+		Velocity = FVector::ZeroVector;
+		SetMovementMode(MOVE_Walking);
+	}
+}
+
+bool UTfppCharacterMovementComponent::RebuildMantlePath(const FVector& Location)
+{
+	// The server was somewhere on the same path when it corrected, continue from the closest segment
+	int32 ClosestSegment = INDEX_NONE;
+	double ClosestDistanceSq = FMath::Square(MantleCorrectionTolerance);
+	for (int32 Index = 1; Index < MantlePath.Num(); ++Index)
+	{
+		const double DistanceSq = FMath::PointDistToSegmentSquared(Location, MantlePath[Index - 1], MantlePath[Index]);
+		if (DistanceSq <= ClosestDistanceSq)
+		{
+			ClosestDistanceSq = DistanceSq;
+			ClosestSegment = Index;
+		}
+	}
+	if (ClosestSegment == INDEX_NONE)
+	{
+		return false;
+	}
+
+	TArray<FVector, TInlineAllocator<4>> Path;
+	Path.Add(Location);
+	Path.Append(MantlePath.GetData() + ClosestSegment, MantlePath.Num() - ClosestSegment);
+	MantlePath = MoveTemp(Path);
+	MantleDistance = 0.f;
+	return true;
+}
+
+void UTfppCharacterMovementComponent::ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel,
+	UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode,
+	TOptional<FRotator> OptionalRotation)
+{
+	Super::ClientAdjustPosition_Implementation(TimeStamp, NewLoc, NewVel, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition,
+		ServerMovementMode, OptionalRotation);
+
+	// The moves replayed after the correction go on mantling, from the corrected location. Without a path to go on
+	// with, the client didn't start the mantle or was corrected off it, it falls until the server ends the mantle
+	if (IsMantling() && !RebuildMantlePath(UpdatedComponent->GetComponentLocation()))
+	{
+		SetMovementMode(MOVE_Falling);
+	}
+}
+
+void UTfppCharacterMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+
+	const EMobilities PreviousMobility = PreviousMovementMode == MOVE_Custom && PreviousCustomMode < TfppTypes::NumMobilities
+		? static_cast<EMobilities>(PreviousCustomMode)
+		: EMobilities::MobilityType0;
+	const EMobilities Mobility = GetCurrentMobility();
+	if (Mobility == PreviousMobility)
+	{
+		return;
+	}
+
+	if (PreviousMobility == MantleMobility)
+	{
+		MantlePath.Reset();
+	}
+
+	// The new mobility may not allow the current pace
+	if (!FTfppTransitionTable::Get().CanUsePace(Mobility, CurrentStance, CurrentPace))
+	{
+		ChangePace(CurrentPace, false);
+	}
+}
+
 bool UTfppCharacterMovementComponent::IsPaceAllowedOnDirectionAngle(EMovementPaces MovementPace) const
 {
-	// Retrieve the forward direction of the controller and velocity direction
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppIsPaceAllowedOnDirectionAngle);
+
+	// Without restrictions there is nothing to measure, and unpossessed pawns have no control rotation to measure against
+	const FFloatRange* AllowedRange = PacesAngleRestriction.Find(MovementPace);
+	if (!AllowedRange || !PawnOwner || !PawnOwner->Controller)
+	{
+		return true;
+	}
+
+	// Retrieve the forward direction of the controller and the direction the character moves in. From a standstill
+	// the velocity has no direction yet, so the input acceleration tells where the character is going
 	FVector ControllerForward = PawnOwner->Controller->GetControlRotation().Vector().GetSafeNormal2D();
-	FVector SafeVelocity = PawnOwner->GetVelocity().GetSafeNormal2D();
+	FVector SafeVelocity = Velocity.SizeSquared2D() > FMath::Square(MinDirectionSpeed)
+		? Velocity.GetSafeNormal2D()
+		: GetCurrentAcceleration().GetSafeNormal2D();
+	if (SafeVelocity.IsNearlyZero())
+	{
+		// Standing still with no input, any pace can be started
+		return true;
+	}
 
 	// Calculate the angle between forward direction and velocity
 	float DotProduct = FVector::DotProduct(ControllerForward, SafeVelocity);
 	float AngleDegrees = FMath::RadiansToDegrees(FMath::Acos(DotProduct));
-	
-	// Check if there are restrictions defined for the current pace
-	if (PacesAngleRestriction.Contains(MovementPace))
-	{
-		// Retrieve the allowed angle range for the current pace
-		FFloatRange AllowedRange = PacesAngleRestriction[MovementPace];
-        
-		// Check if the angle falls within the allowed range
-		if (AngleDegrees >= AllowedRange.GetLowerBoundValue() && AngleDegrees <= AllowedRange.GetUpperBoundValue())
-		{
-			return true; // Angle is within restriction
-		}
-		return false; // Angle is outside restriction
-	}
-	// If no restrictions are defined for the current pace, allow it by default
-	return true;
 
+	// Check if the angle falls within the allowed range
+	if (AngleDegrees >= AllowedRange->GetLowerBoundValue() && AngleDegrees <= AllowedRange->GetUpperBoundValue())
+	{
+		return true; // Angle is within restriction
+	}
+	TfppTelemetry::AddSprintGateRejection();
+	return false; // Angle is outside restriction
 }
 
 
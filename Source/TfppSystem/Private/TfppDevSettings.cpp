@@ -15,7 +15,27 @@ UTfppDevSettings::UTfppDevSettings()
 	Paces = {"Jog","Sprint"};
 	Mobilities = {};
 	Stances = {"Crouch"};
+	StanceClearances = {{ECharacterStances::StanceType0, 176.f}, {ECharacterStances::StanceType1, 80.f}};
 	LogVerbosity = ETfppLogVerbosity::Warning;
+	PerPawnMemoryBudget = 0;
+	bEnableTelemetry = false;
+	TelemetryRegionName = TEXT("TfppTelemetry_{Pid}");
+	AnimationBundleUpdateInterval = 0.25f;
+	AnimationBundleUnloadCooldown = 10.f;
+	bUseAnimationBudget = false;
+	AnimationBudgetMs = 2.f;
+	AnimationBudgetSignificanceDistance = 5000.f;
+	FootstepPoolSize = 16;
+	bUseFixedSimulationRate = false;
+	FixedSimulationRate = 60.f;
+	MaxSimulationStepsPerFrame = 4;
+	bExtrapolateFixedSimulation = false;
+	bUseDedicatedServerProfile = false;
+	DedicatedServerAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	bValidateSpeed = false;
+	SpeedValidationInterval = 1.f;
+	SpeedTolerance = 1.15f;
+	SpeedViolationAction = ETfppSpeedViolationAction::Flag;
 }
 
 ELogVerbosity::Type ToUnrealVerbosity(ETfppLogVerbosity InVerbosity)
@@ -44,7 +64,8 @@ void UTfppDevSettings::PostInitProperties()
 	UEnum* MobilityEnum = StaticEnum<EMobilities>();
 	UpdateEnums(MobilityEnum, Mobilities);
 #endif
-	
+
+	TransitionTable.Build(StanceRules, MobilityRules);
 }
 
 #if WITH_EDITOR
@@ -62,6 +83,7 @@ void UTfppDevSettings::PostEditChangeProperty(FPropertyChangedEvent& PropertyCha
 	UpdateEnums(PacesEnum, Paces);
 	UEnum* MobilityEnum = StaticEnum<EMobilities>();
 	UpdateEnums(MobilityEnum, Mobilities);
+	TransitionTable.Build(StanceRules, MobilityRules);
 
 	FName PropertyName = (PropertyChangedEvent.Property != nullptr)
 	? PropertyChangedEvent.Property->GetFName()
@@ -0,0 +1,136 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppFootPlacementComponent.h"
+#include "TfppStats.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+
+UTfppFootPlacementComponent::UTfppFootPlacementComponent()
+{
+	// Driven by UTfppFootPlacementSubsystem
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UTfppFootPlacementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FootPlacements.SetNum(FootBones.Num());
+
+	// Nobody sees the feet on a dedicated server
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
+	if (UTfppFootPlacementSubsystem* Subsystem = GetWorld()->GetSubsystem<UTfppFootPlacementSubsystem>())
+	{
+		Subsystem->RegisterComponent(this);
+	}
+}
+
+void UTfppFootPlacementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTfppFootPlacementSubsystem* Subsystem = GetWorld()->GetSubsystem<UTfppFootPlacementSubsystem>())
+	{
+		Subsystem->UnregisterComponent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTfppFootPlacementSubsystem::RegisterComponent(UTfppFootPlacementComponent* Component)
+{
+	Components.AddUnique(Component);
+}
+
+void UTfppFootPlacementSubsystem::UnregisterComponent(UTfppFootPlacementComponent* Component)
+{
+	Components.RemoveSwap(Component);
+}
+
+void UTfppFootPlacementSubsystem::Tick(float DeltaTime)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppFootPlacement);
+
+	for (UTfppFootPlacementComponent* Component : Components)
+	{
+		GatherResults(*Component);
+		IssueTraces(*Component);
+	}
+}
+
+void UTfppFootPlacementSubsystem::GatherResults(UTfppFootPlacementComponent& Component) const
+{
+	if (Component.PendingTraces.IsEmpty())
+	{
+		return;
+	}
+
+	const ACharacter* Character = Cast<ACharacter>(Component.GetOwner());
+	const float CapsuleBottom = Character
+		? Character->GetActorLocation().Z - Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight()
+		: Component.GetOwner()->GetActorLocation().Z;
+
+	for (int32 Foot = 0; Foot < Component.PendingTraces.Num(); ++Foot)
+	{
+		FTraceDatum Datum;
+		if (!GetWorld()->QueryTraceData(Component.PendingTraces[Foot], Datum))
+		{
+			continue;
+		}
+
+		FTfppFootPlacement& Placement = Component.FootPlacements[Foot];
+		const FHitResult* Hit = FHitResult::GetFirstBlockingHit(Datum.OutHits);
+		Placement.bHasGround = Hit != nullptr;
+		if (Hit)
+		{
+			Placement.GroundLocation = Hit->ImpactPoint;
+			Placement.GroundNormal = Hit->ImpactNormal;
+			Placement.Offset = Hit->ImpactPoint.Z - CapsuleBottom;
+		}
+	}
+	Component.PendingTraces.Reset();
+}
+
+void UTfppFootPlacementSubsystem::IssueTraces(UTfppFootPlacementComponent& Component) const
+{
+	const AActor* Owner = Component.GetOwner();
+	const FVector Location = Owner->GetActorLocation();
+	if (FVector::DistSquared(Location, Component.TracedLocation) <= FMath::Square(Component.StationaryTolerance))
+	{
+		// Standing still, the cached placements are still valid
+		return;
+	}
+
+	const ACharacter* Character = Cast<ACharacter>(Owner);
+	const USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+	if (!Mesh)
+	{
+		return;
+	}
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(TfppFootPlacement), false, Owner);
+	for (const FName& FootBone : Component.FootBones)
+	{
+		const FVector FootLocation = Mesh->GetSocketLocation(FootBone);
+		const FVector Start = FootLocation + FVector(0.f, 0.f, Component.TraceUpDistance);
+		const FVector End = FootLocation - FVector(0.f, 0.f, Component.TraceDownDistance);
+		Component.PendingTraces.Add(GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, Component.TraceChannel, Params));
+	}
+	Component.TracedLocation = Location;
+	INC_DWORD_STAT_BY(STAT_TfppFootTraces, Component.FootBones.Num());
+}
+
+TStatId UTfppFootPlacementSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTfppFootPlacementSubsystem, STATGROUP_Tickables);
+}
+
+bool UTfppFootPlacementSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
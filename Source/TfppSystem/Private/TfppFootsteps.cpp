@@ -0,0 +1,255 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppFootsteps.h"
+#include "TfppCharacter.h"
+#include "TfppCharacterMovementComponent.h"
+#include "TfppDevSettings.h"
+#include "TfppStats.h"
+#include "AudioDevice.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Sound/SoundAttenuation.h"
+#include "Sound/SoundBase.h"
+
+UTfppFootstepComponent::UTfppFootstepComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UTfppFootstepComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Nobody listens on a dedicated server
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
+	const ATfppCharacter* Character = Cast<ATfppCharacter>(GetOwner());
+	Movement = Character ? Character->GetTfppCharacterMovement() : nullptr;
+	if (!Movement)
+	{
+		return;
+	}
+
+	if (UTfppFootstepSubsystem* Subsystem = GetWorld()->GetSubsystem<UTfppFootstepSubsystem>())
+	{
+		Subsystem->RegisterComponent(this);
+	}
+}
+
+void UTfppFootstepComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTfppFootstepSubsystem* Subsystem = GetWorld()->GetSubsystem<UTfppFootstepSubsystem>())
+	{
+		Subsystem->UnregisterComponent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UTfppFootstepComponent::Advance(float DeltaTime, FTfppFootstepEvent& OutEvent)
+{
+	const bool bLanded = bWasFalling && !Movement->IsFalling();
+	bWasFalling = Movement->IsFalling();
+	if (bWasFalling)
+	{
+		FallSpeed = -Movement->Velocity.Z;
+		return false;
+	}
+	if (!Movement->IsMovingOnGround())
+	{
+		return false;
+	}
+
+	OutEvent.Location = Movement->GetActorFeetLocation();
+	OutEvent.Attenuation = Attenuation;
+
+	const FTfppFootstepPace* Pace = Paces.Find(Movement->GetCurrentPace());
+	if (bLanded)
+	{
+		// The next footstep comes a full step after the landing
+		DistanceToStep = Pace ? GetStepLength(*Pace) : 0.f;
+		if (!LandingSound || FallSpeed < MinLandingSpeed)
+		{
+			return false;
+		}
+		OutEvent.Sound = LandingSound;
+		OutEvent.Volume = LandingVolume * FMath::Min(FallSpeed, FMath::Max(MaxLandingSpeed, MinLandingSpeed)) / FMath::Max(MinLandingSpeed, 1.f);
+		OutEvent.AudibleDistance = AudibleDistance * OutEvent.Volume;
+		return true;
+	}
+
+	if (!Pace || !Pace->Sound)
+	{
+		return false;
+	}
+
+	DistanceToStep -= Movement->Velocity.Size2D() * DeltaTime;
+	if (DistanceToStep > 0.f)
+	{
+		return false;
+	}
+
+	// A single footstep per frame, hitches don't make the character stomp
+	const FTfppFootstepStance* Stance = Stances.Find(Movement->GetCurrentStance());
+	DistanceToStep = FMath::Max(DistanceToStep + GetStepLength(*Pace), 0.f);
+
+	OutEvent.Sound = Pace->Sound;
+	OutEvent.Volume = Pace->Volume * (Stance ? Stance->VolumeMultiplier : 1.f);
+	OutEvent.AudibleDistance = AudibleDistance * OutEvent.Volume;
+	return true;
+}
+
+float UTfppFootstepComponent::GetStepLength(const FTfppFootstepPace& Pace) const
+{
+	const FTfppFootstepStance* Stance = Stances.Find(Movement->GetCurrentStance());
+	return Pace.StepLength * (Stance ? Stance->StepLengthMultiplier : 1.f);
+}
+
+void UTfppFootstepSubsystem::RegisterComponent(UTfppFootstepComponent* Component)
+{
+	Components.AddUnique(Component);
+}
+
+void UTfppFootstepSubsystem::UnregisterComponent(UTfppFootstepComponent* Component)
+{
+	Components.RemoveSwap(Component);
+}
+
+void UTfppFootstepSubsystem::Deinitialize()
+{
+	for (UAudioComponent* AudioComponent : Pool)
+	{
+		if (AudioComponent)
+		{
+			AudioComponent->Stop();
+			AudioComponent->DestroyComponent();
+		}
+	}
+	Pool.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTfppFootstepSubsystem::Tick(float DeltaTime)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppFootsteps);
+
+	if (Components.IsEmpty())
+	{
+		return;
+	}
+
+	Listeners.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FVector Location;
+			FVector FrontDirection;
+			FVector RightDirection;
+			PlayerController->GetAudioListenerPosition(Location, FrontDirection, RightDirection);
+			Listeners.Add(Location);
+		}
+	}
+
+	Events.Reset();
+	for (UTfppFootstepComponent* Component : Components)
+	{
+		FTfppFootstepEvent Event;
+		if (Component->Advance(DeltaTime, Event))
+		{
+			Events.Add(Event);
+		}
+	}
+
+	// A full pool is a different problem than quiet footsteps, the two are counted apart
+	int32 NumEmitted = 0;
+	int32 NumCulled = 0;
+	int32 NumDropped = 0;
+	for (const FTfppFootstepEvent& Event : Events)
+	{
+		if (!IsAudible(Event))
+		{
+			++NumCulled;
+		}
+		else if (Play(Event))
+		{
+			++NumEmitted;
+		}
+		else
+		{
+			++NumDropped;
+		}
+	}
+
+	TfppStats::AddFootstepEvents(NumEmitted, NumCulled, NumDropped);
+}
+
+bool UTfppFootstepSubsystem::IsAudible(const FTfppFootstepEvent& Event) const
+{
+	const double AudibleDistanceSq = FMath::Square(Event.AudibleDistance);
+	for (const FVector& Listener : Listeners)
+	{
+		if (FVector::DistSquared(Listener, Event.Location) <= AudibleDistanceSq)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UTfppFootstepSubsystem::Play(const FTfppFootstepEvent& Event)
+{
+	UAudioComponent* AudioComponent = nullptr;
+	for (UAudioComponent* Pooled : Pool)
+	{
+		if (Pooled && !Pooled->IsPlaying())
+		{
+			AudioComponent = Pooled;
+			break;
+		}
+	}
+
+	if (!AudioComponent)
+	{
+		if (Pool.Num() >= UTfppDevSettings::Get()->FootstepPoolSize)
+		{
+			return false;
+		}
+
+		FAudioDevice::FCreateComponentParams Params(GetWorld());
+		Params.SetLocation(Event.Location);
+		AudioComponent = FAudioDevice::CreateComponent(Event.Sound, Params);
+		if (!AudioComponent)
+		{
+			// No audio device, nothing will ever play
+			return false;
+		}
+		AudioComponent->bAutoDestroy = false;
+		AudioComponent->bStopWhenOwnerDestroyed = false;
+		AudioComponent->bAllowSpatialization = true;
+		Pool.Add(AudioComponent);
+	}
+
+	AudioComponent->SetWorldLocation(Event.Location);
+	AudioComponent->SetSound(Event.Sound);
+	AudioComponent->AttenuationSettings = Event.Attenuation;
+	AudioComponent->SetVolumeMultiplier(Event.Volume);
+	AudioComponent->Play();
+	return true;
+}
+
+TStatId UTfppFootstepSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTfppFootstepSubsystem, STATGROUP_Tickables);
+}
+
+bool UTfppFootstepSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
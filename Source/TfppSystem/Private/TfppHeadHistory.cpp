@@ -0,0 +1,244 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppHeadHistory.h"
+#include "TfppCharacter.h"
+#include "TfppStats.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+
+void FTfppHeadPoseHistory::Init(int32 Capacity)
+{
+	Samples.SetNumUninitialized(FMath::Max(Capacity, 2));
+	Oldest = 0;
+	NumSamples = 0;
+}
+
+void FTfppHeadPoseHistory::Reset()
+{
+	Samples.Empty();
+	Oldest = 0;
+	NumSamples = 0;
+}
+
+void FTfppHeadPoseHistory::Record(double Time, const FVector& CameraLocation, const FRotator& CameraRotation, const FRotator& ViewRotation)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppHeadHistoryRecord);
+
+	if (Samples.Num() == 0)
+	{
+		return;
+	}
+
+	const uint32 TimeMs = static_cast<uint32>(FMath::Max(Time, 0.0) * 1000.0);
+	if (NumSamples > 0 && TimeMs <= GetSample(NumSamples - 1).TimeMs)
+	{
+		return;
+	}
+
+	int32 Slot;
+	if (NumSamples < Samples.Num())
+	{
+		Slot = (Oldest + NumSamples) % Samples.Num();
+		++NumSamples;
+	}
+	else
+	{
+		Slot = Oldest;
+		Oldest = (Oldest + 1) % Samples.Num();
+	}
+
+	FTfppHeadPoseSample& Sample = Samples[Slot];
+	Sample.TimeMs = TimeMs;
+	Sample.Location[0] = QuantizeLocation(CameraLocation.X);
+	Sample.Location[1] = QuantizeLocation(CameraLocation.Y);
+	Sample.Location[2] = QuantizeLocation(CameraLocation.Z);
+	Sample.CameraRotation[0] = FRotator::CompressAxisToShort(CameraRotation.Pitch);
+	Sample.CameraRotation[1] = FRotator::CompressAxisToShort(CameraRotation.Yaw);
+	Sample.CameraRotation[2] = FRotator::CompressAxisToShort(CameraRotation.Roll);
+	Sample.ViewRotation[0] = FRotator::CompressAxisToShort(ViewRotation.Pitch);
+	Sample.ViewRotation[1] = FRotator::CompressAxisToShort(ViewRotation.Yaw);
+}
+
+bool FTfppHeadPoseHistory::Rewind(double Time, FTfppHeadPose& OutPose) const
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppHeadHistoryRewind);
+
+	if (NumSamples == 0)
+	{
+		return false;
+	}
+
+	const double TimeMs = Time * 1000.0;
+	if (TimeMs <= GetSample(0).TimeMs)
+	{
+		OutPose = Decode(GetSample(0));
+		return true;
+	}
+	if (TimeMs >= GetSample(NumSamples - 1).TimeMs)
+	{
+		OutPose = Decode(GetSample(NumSamples - 1));
+		return true;
+	}
+
+	// Find the first sample after the requested time, the one before it is then at or before that time
+	int32 Low = 1;
+	int32 High = NumSamples - 1;
+	while (Low < High)
+	{
+		const int32 Middle = (Low + High) / 2;
+		if (GetSample(Middle).TimeMs <= TimeMs)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+
+	const FTfppHeadPoseSample& Before = GetSample(Low - 1);
+	const FTfppHeadPoseSample& After = GetSample(Low);
+	const float Alpha = static_cast<float>((TimeMs - Before.TimeMs) / (After.TimeMs - Before.TimeMs));
+
+	const FTfppHeadPose From = Decode(Before);
+	const FTfppHeadPose To = Decode(After);
+	OutPose.CameraLocation = FMath::Lerp(From.CameraLocation, To.CameraLocation, Alpha);
+	OutPose.CameraRotation = FQuat::Slerp(From.CameraRotation.Quaternion(), To.CameraRotation.Quaternion(), Alpha).Rotator();
+	OutPose.ViewRotation = FQuat::Slerp(From.ViewRotation.Quaternion(), To.ViewRotation.Quaternion(), Alpha).Rotator();
+	return true;
+}
+
+double FTfppHeadPoseHistory::GetOldestTime() const
+{
+	return NumSamples > 0 ? GetSample(0).TimeMs / 1000.0 : 0.0;
+}
+
+int32 FTfppHeadPoseHistory::QuantizeLocation(double Value)
+{
+	return static_cast<int32>(FMath::Clamp(FMath::RoundToDouble(Value * LocationScale), double(MIN_int32), double(MAX_int32)));
+}
+
+FTfppHeadPose FTfppHeadPoseHistory::Decode(const FTfppHeadPoseSample& Sample)
+{
+	FTfppHeadPose Pose;
+	Pose.CameraLocation = FVector(Sample.Location[0], Sample.Location[1], Sample.Location[2]) / LocationScale;
+	Pose.CameraRotation = FRotator(FRotator::DecompressAxisFromShort(Sample.CameraRotation[0]),
+		FRotator::DecompressAxisFromShort(Sample.CameraRotation[1]), FRotator::DecompressAxisFromShort(Sample.CameraRotation[2]));
+	Pose.ViewRotation = FRotator(FRotator::DecompressAxisFromShort(Sample.ViewRotation[0]),
+		FRotator::DecompressAxisFromShort(Sample.ViewRotation[1]), 0.f);
+	return Pose;
+}
+
+UTfppHeadHistoryComponent::UTfppHeadHistoryComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// The head has to be animated already
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void UTfppHeadHistoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	const ENetMode NetMode = GetNetMode();
+	Camera = GetOwner()->FindComponentByClass<UCameraComponent>();
+	if (!Camera || (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer))
+	{
+		// Only servers validate shots
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	History.Init(HistoryCapacity);
+	INC_MEMORY_STAT_BY(STAT_TfppHeadHistoryMemory, History.GetAllocatedSize());
+}
+
+void UTfppHeadHistoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_MEMORY_STAT_BY(STAT_TfppHeadHistoryMemory, History.GetAllocatedSize());
+	History.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTfppHeadHistoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	FRotator ViewRotation = Camera->GetComponentRotation();
+	if (ATfppCharacter* Character = Cast<ATfppCharacter>(GetOwner()))
+	{
+		const FRotator Adjusted = Character->GetAdjustedViewRotation();
+		ViewRotation = FRotator(Adjusted.Pitch, Character->GetActorRotation().Yaw + Adjusted.Yaw, 0.f);
+	}
+
+	History.Record(GetWorld()->GetTimeSeconds(), Camera->GetComponentLocation(), Camera->GetComponentRotation(), ViewRotation);
+}
+
+bool UTfppHeadHistoryComponent::RewindHeadPose(double ServerTime, FTfppHeadPose& OutPose) const
+{
+	return History.Rewind(ServerTime, OutPose);
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice TfppHeadHistoryBenchCommand(
+	TEXT("Tfpp.HeadHistoryBench"),
+	TEXT("Times recording and rewinding head pose histories. Arguments: [Pawns=256] [Frames=600] [RewindsPerPawn=4]."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+		{
+			const int32 NumPawns = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 256;
+			const int32 NumFrames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 600;
+			const int32 NumRewinds = Args.Num() > 2 ? FMath::Max(FCString::Atoi(*Args[2]), 0) : 4;
+			const int32 Capacity = GetDefault<UTfppHeadHistoryComponent>()->HistoryCapacity;
+			constexpr double FrameTime = 1.0 / 60.0;
+
+			TArray<FTfppHeadPoseHistory> Histories;
+			Histories.SetNum(NumPawns);
+			for (FTfppHeadPoseHistory& History : Histories)
+			{
+				History.Init(Capacity);
+			}
+
+			FRandomStream Random(NumPawns);
+			FTfppHeadPose Pose;
+			double RecordSeconds = 0.0;
+			double RewindSeconds = 0.0;
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				const double Time = Frame * FrameTime;
+
+				const double RecordStart = FPlatformTime::Seconds();
+				for (int32 Index = 0; Index < NumPawns; ++Index)
+				{
+					const FVector Location(Index * 100.0, Frame * 5.0, 160.0 + FMath::Sin(Time * 8.0) * 3.0);
+					const FRotator Rotation(FMath::Sin(Time) * 30.0, Time * 45.0, 0.0);
+					Histories[Index].Record(Time, Location, Rotation, Rotation);
+				}
+				RecordSeconds += FPlatformTime::Seconds() - RecordStart;
+
+				const double RewindStart = FPlatformTime::Seconds();
+				for (FTfppHeadPoseHistory& History : Histories)
+				{
+					for (int32 Rewind = 0; Rewind < NumRewinds; ++Rewind)
+					{
+						History.Rewind(Random.FRandRange(History.GetOldestTime(), Time), Pose);
+					}
+				}
+				RewindSeconds += FPlatformTime::Seconds() - RewindStart;
+			}
+
+			SIZE_T TotalBytes = 0;
+			for (const FTfppHeadPoseHistory& History : Histories)
+			{
+				TotalBytes += History.GetAllocatedSize();
+			}
+
+			Ar.Logf(TEXT("%d pawns, %d samples each: %llu bytes total, %llu bytes per pawn."), NumPawns, Capacity,
+				static_cast<uint64>(TotalBytes), static_cast<uint64>(TotalBytes / NumPawns));
+			Ar.Logf(TEXT("Record: %.3f ms per frame for every pawn."), RecordSeconds * 1000.0 / NumFrames);
+			Ar.Logf(TEXT("Rewind: %.3f ms per frame for %d rewinds, %.1f ns each."), RewindSeconds * 1000.0 / NumFrames,
+				NumPawns * NumRewinds, NumRewinds > 0 ? RewindSeconds * 1e9 / (double(NumFrames) * NumPawns * NumRewinds) : 0.0);
+		}));
@@ -0,0 +1,297 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppHeadMotion.h"
+#include "TfppCharacter.h"
+#include "TfppStats.h"
+#include "Algo/BinarySearch.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/World.h"
+
+void UTfppHeadMotionProfile::PostInitProperties()
+{
+	Super::PostInitProperties();
+	Bake();
+}
+
+void UTfppHeadMotionProfile::PostLoad()
+{
+	Super::PostLoad();
+	Bake();
+}
+
+#if WITH_EDITOR
+void UTfppHeadMotionProfile::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	Bake();
+}
+#endif
+
+void UTfppHeadMotionProfile::Bake()
+{
+	const int32 SamplesPerTable = TableResolution + 1;
+	BakedEntries.Reset(Entries.Num());
+	BakedSamples.Reset(Entries.Num() * SamplesPerTable * 2);
+
+	for (const FTfppHeadMotionCurves& Curves : Entries)
+	{
+		FBakedEntry& Baked = BakedEntries.AddDefaulted_GetRef();
+		Baked.FirstSample = BakedSamples.Num();
+		Baked.InvStrideLength = 1.f / FMath::Max(Curves.StrideLength, 1.f);
+		Baked.InvReferenceSpeed = 1.f / FMath::Max(Curves.ReferenceSpeed, 1.f);
+		Baked.InvBreathingPeriod = 1.f / FMath::Max(Curves.BreathingPeriod, 0.1f);
+
+		// The last sample is taken at the same phase as the first, so interpolation never has to wrap around
+		for (int32 Sample = 0; Sample < SamplesPerTable; ++Sample)
+		{
+			const float Phase = static_cast<float>(Sample % TableResolution) / TableResolution;
+			BakedSamples.Emplace(Curves.Bob.GetRichCurveConst()->Eval(Phase), Curves.Sway.GetRichCurveConst()->Eval(Phase),
+				Curves.Roll.GetRichCurveConst()->Eval(Phase), 0.f);
+		}
+		for (int32 Sample = 0; Sample < SamplesPerTable; ++Sample)
+		{
+			const float Phase = static_cast<float>(Sample % TableResolution) / TableResolution;
+			BakedSamples.Emplace(0.f, 0.f, 0.f, Curves.Breathing.GetRichCurveConst()->Eval(Phase));
+		}
+	}
+
+	// Exact matches first, then the first entry of each pace fills the stances left without one
+	FMemory::Memset(Lookup, INDEX_NONE, sizeof(Lookup));
+	const int32 NumEntries = FMath::Min(Entries.Num(), static_cast<int32>(MAX_int8));
+	for (int32 EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex)
+	{
+		int8& Slot = Lookup[static_cast<uint8>(Entries[EntryIndex].Pace)][static_cast<uint8>(Entries[EntryIndex].Stance)];
+		if (Slot == INDEX_NONE)
+		{
+			Slot = static_cast<int8>(EntryIndex);
+		}
+	}
+	for (int32 EntryIndex = NumEntries - 1; EntryIndex >= 0; --EntryIndex)
+	{
+		int8* PaceSlots = Lookup[static_cast<uint8>(Entries[EntryIndex].Pace)];
+		for (int32 Stance = 0; Stance < TfppTypes::NumStances; ++Stance)
+		{
+			if (PaceSlots[Stance] == INDEX_NONE)
+			{
+				PaceSlots[Stance] = static_cast<int8>(EntryIndex);
+			}
+		}
+	}
+}
+
+void UTfppHeadMotionProfile::Advance(FTfppHeadMotionState& State, float Speed, float DeltaTime) const
+{
+	if (!BakedEntries.IsValidIndex(State.Entry))
+	{
+		State.StrideScale = 0.f;
+		return;
+	}
+
+	const FBakedEntry& Baked = BakedEntries[State.Entry];
+	State.StridePhase = FMath::Frac(State.StridePhase + Speed * DeltaTime * Baked.InvStrideLength);
+	State.BreathingPhase = FMath::Frac(State.BreathingPhase + DeltaTime * Baked.InvBreathingPeriod);
+	State.StrideScale = FMath::Min(Speed * Baked.InvReferenceSpeed, 1.f);
+}
+
+void UTfppHeadMotionProfile::Evaluate(TConstArrayView<FTfppHeadMotionState> States, TArrayView<FVector4f> OutMotion) const
+{
+	check(States.Num() == OutMotion.Num());
+
+	const int32 SamplesPerTable = TableResolution + 1;
+	const float Resolution = static_cast<float>(TableResolution);
+
+	const auto SampleTable = [this, Resolution](int32 FirstSample, float Phase)
+	{
+		const float Position = Phase * Resolution;
+		const int32 Index = FMath::Min(FMath::FloorToInt32(Position), TableResolution - 1);
+		const VectorRegister4Float A = VectorLoad(&BakedSamples[FirstSample + Index].X);
+		const VectorRegister4Float B = VectorLoad(&BakedSamples[FirstSample + Index + 1].X);
+		return VectorMultiplyAdd(VectorSubtract(B, A), VectorSetFloat1(Position - Index), A);
+	};
+
+	const auto EvaluateEntry = [&](int32 Entry, const FTfppHeadMotionState& State)
+	{
+		if (!BakedEntries.IsValidIndex(Entry))
+		{
+			return GlobalVectorConstants::FloatZero;
+		}
+		const int32 FirstSample = BakedEntries[Entry].FirstSample;
+		const VectorRegister4Float Stride = SampleTable(FirstSample, State.StridePhase);
+		const VectorRegister4Float Breathing = SampleTable(FirstSample + SamplesPerTable, State.BreathingPhase);
+		return VectorMultiplyAdd(Stride, VectorSetFloat1(State.StrideScale), Breathing);
+	};
+
+	for (int32 Index = 0; Index < States.Num(); ++Index)
+	{
+		const FTfppHeadMotionState& State = States[Index];
+		VectorRegister4Float Result = EvaluateEntry(State.Entry, State);
+		if (State.BlendAlpha < 1.f)
+		{
+			const VectorRegister4Float Previous = EvaluateEntry(State.PreviousEntry, State);
+			Result = VectorMultiplyAdd(VectorSubtract(Result, Previous), VectorSetFloat1(State.BlendAlpha), Previous);
+		}
+		VectorStore(Result, &OutMotion[Index].X);
+	}
+}
+
+UTfppHeadMotionComponent::UTfppHeadMotionComponent()
+{
+	// Driven by UTfppHeadMotionSubsystem
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UTfppHeadMotionComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Nobody looks through the camera on a dedicated server
+	if (IsNetMode(NM_DedicatedServer) || !Profile)
+	{
+		return;
+	}
+
+	Camera = GetOwner()->FindComponentByClass<UCameraComponent>();
+	if (const ATfppCharacter* Character = Cast<ATfppCharacter>(GetOwner()))
+	{
+		if (UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement())
+		{
+			Movement->OnPaceChanged.AddDynamic(this, &UTfppHeadMotionComponent::HandlePaceChanged);
+			Movement->OnStanceChanged.AddDynamic(this, &UTfppHeadMotionComponent::HandleStanceChanged);
+		}
+	}
+
+	SelectEntry();
+	State.BlendAlpha = 1.f;
+
+	if (UTfppHeadMotionSubsystem* Subsystem = GetWorld()->GetSubsystem<UTfppHeadMotionSubsystem>())
+	{
+		Subsystem->RegisterComponent(this);
+	}
+}
+
+void UTfppHeadMotionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTfppHeadMotionSubsystem* Subsystem = GetWorld()->GetSubsystem<UTfppHeadMotionSubsystem>())
+	{
+		Subsystem->UnregisterComponent(this);
+	}
+
+	if (const ATfppCharacter* Character = Cast<ATfppCharacter>(GetOwner()))
+	{
+		if (UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement())
+		{
+			Movement->OnPaceChanged.RemoveDynamic(this, &UTfppHeadMotionComponent::HandlePaceChanged);
+			Movement->OnStanceChanged.RemoveDynamic(this, &UTfppHeadMotionComponent::HandleStanceChanged);
+		}
+	}
+
+	if (Camera)
+	{
+		// Leave the offsets of other systems on the camera
+		Camera->AddAdditiveOffset(AppliedOffset.Inverse(), 0.f);
+		AppliedOffset = FTransform::Identity;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTfppHeadMotionComponent::HandlePaceChanged(EMovementPaces OldPace, EMovementPaces NewPace)
+{
+	SelectEntry();
+}
+
+void UTfppHeadMotionComponent::HandleStanceChanged(ECharacterStances OldStance, ECharacterStances NewStance)
+{
+	SelectEntry();
+}
+
+void UTfppHeadMotionComponent::SelectEntry()
+{
+	const ATfppCharacter* Character = Cast<ATfppCharacter>(GetOwner());
+	const UTfppCharacterMovementComponent* Movement = Character ? Character->GetTfppCharacterMovement() : nullptr;
+	const int32 NewEntry = Profile && Movement ? Profile->FindEntry(Movement->GetCurrentPace(), Movement->GetCurrentStance()) : INDEX_NONE;
+	if (NewEntry == State.Entry)
+	{
+		return;
+	}
+
+	State.PreviousEntry = State.Entry;
+	State.Entry = NewEntry;
+	State.BlendAlpha = BlendTime > 0.f ? 0.f : 1.f;
+}
+
+void UTfppHeadMotionComponent::ApplyMotion(const FVector4f& Motion)
+{
+	HeadMotionOffset = FVector(0.f, Motion.Y, Motion.X) * Intensity;
+	HeadMotionRotation = FRotator(Motion.W, 0.f, Motion.Z) * Intensity;
+
+	if (Camera)
+	{
+		// Replace the offset of the last update without touching the offsets of other systems. The camera composes
+		// offsets in order, so this is exact as long as nothing adds one after this component every frame
+		const FTransform NewOffset(HeadMotionRotation, HeadMotionOffset);
+		Camera->AddAdditiveOffset(AppliedOffset.Inverse() * NewOffset, 0.f);
+		AppliedOffset = NewOffset;
+	}
+}
+
+void UTfppHeadMotionSubsystem::RegisterComponent(UTfppHeadMotionComponent* Component)
+{
+	if (Components.Contains(Component))
+	{
+		return;
+	}
+
+	// Keeps the components of a profile next to each other so they are evaluated in one batch
+	const int32 Index = Algo::UpperBoundBy(Components, Component->Profile.Get(),
+		[](const UTfppHeadMotionComponent* Registered) { return Registered->Profile.Get(); });
+	Components.Insert(Component, Index);
+}
+
+void UTfppHeadMotionSubsystem::UnregisterComponent(UTfppHeadMotionComponent* Component)
+{
+	// Not swapped, it would break the grouping by profile
+	Components.Remove(Component);
+}
+
+void UTfppHeadMotionSubsystem::Tick(float DeltaTime)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppHeadMotion);
+
+	for (int32 Begin = 0; Begin < Components.Num();)
+	{
+		const UTfppHeadMotionProfile* Profile = Components[Begin]->Profile;
+		int32 End = Begin;
+
+		States.Reset();
+		for (; End < Components.Num() && Components[End]->Profile == Profile; ++End)
+		{
+			UTfppHeadMotionComponent* Component = Components[End];
+			FTfppHeadMotionState& State = Component->State;
+			State.BlendAlpha = Component->BlendTime > 0.f ? FMath::Min(State.BlendAlpha + DeltaTime / Component->BlendTime, 1.f) : 1.f;
+			Profile->Advance(State, Component->GetOwner()->GetVelocity().Size2D(), DeltaTime);
+			States.Add(State);
+		}
+
+		Motion.Reset();
+		Motion.AddUninitialized(States.Num());
+		Profile->Evaluate(States, Motion);
+
+		for (int32 Index = Begin; Index < End; ++Index)
+		{
+			Components[Index]->ApplyMotion(Motion[Index - Begin]);
+		}
+		Begin = End;
+	}
+}
+
+TStatId UTfppHeadMotionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTfppHeadMotionSubsystem, STATGROUP_Tickables);
+}
+
+bool UTfppHeadMotionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,166 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppMemory.h"
+#include "TfppCharacter.h"
+#include "TfppCameraCollisionComponent.h"
+#include "TfppCharacterMovementComponent.h"
+#include "TfppDevSettings.h"
+#include "TfppFootPlacementComponent.h"
+#include "TfppFootsteps.h"
+#include "TfppHeadHistory.h"
+#include "TfppHeadMotion.h"
+#include "TfppSoak.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+
+FTfppPawnMemoryReport& FTfppPawnMemoryReport::operator+=(const FTfppPawnMemoryReport& Other)
+{
+	CharacterObject += Other.CharacterObject;
+	MovementComponentObject += Other.MovementComponentObject;
+	PaceMaxSpeed += Other.PaceMaxSpeed;
+	StanceSpeedMultiplier += Other.StanceSpeedMultiplier;
+	PacesAngleRestriction += Other.PacesAngleRestriction;
+	OnPaceChanged += Other.OnPaceChanged;
+	OnStanceChanged += Other.OnStanceChanged;
+	SurfaceSpeedModifiers += Other.SurfaceSpeedModifiers;
+	MantlePath += Other.MantlePath;
+	OtherComponents += Other.OtherComponents;
+	return *this;
+}
+
+namespace TfppMemory
+{
+	// Blueprint and game subclasses of the TFPP components are measured like the components they extend
+	static bool IsTfppComponent(const UActorComponent& Component)
+	{
+		static const UClass* const ComponentClasses[] = { UTfppCameraCollisionComponent::StaticClass(),
+			UTfppFootPlacementComponent::StaticClass(), UTfppFootstepComponent::StaticClass(), UTfppHeadHistoryComponent::StaticClass(),
+			UTfppHeadMotionComponent::StaticClass(), UTfppSoakBotComponent::StaticClass() };
+		for (const UClass* ComponentClass : ComponentClasses)
+		{
+			if (Component.IsA(ComponentClass))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	FTfppPawnMemoryReport MeasurePawn(const ATfppCharacter& Character)
+	{
+		FTfppPawnMemoryReport Report;
+		Report.CharacterObject = Character.GetClass()->GetStructureSize();
+
+		if (const UTfppCharacterMovementComponent* Movement = Character.GetTfppCharacterMovement())
+		{
+			Report.MovementComponentObject = Movement->GetClass()->GetStructureSize();
+			Report.PaceMaxSpeed = Movement->PaceMaxSpeed.GetAllocatedSize();
+			Report.StanceSpeedMultiplier = Movement->StanceSpeedMultiplier.GetAllocatedSize();
+			Report.PacesAngleRestriction = Movement->PacesAngleRestriction.GetAllocatedSize();
+			Report.OnPaceChanged = Movement->OnPaceChanged.GetAllocatedSize();
+			Report.OnStanceChanged = Movement->OnStanceChanged.GetAllocatedSize();
+			Report.SurfaceSpeedModifiers = Movement->SurfaceSpeedModifiers.GetAllocatedSize();
+			for (const TPair<TObjectPtr<UPhysicalMaterial>, FTfppSurfaceSpeedModifier>& Pair : Movement->SurfaceSpeedModifiers)
+			{
+				Report.SurfaceSpeedModifiers += Pair.Value.PaceMultipliers.GetAllocatedSize() + Pair.Value.StanceMultipliers.GetAllocatedSize();
+			}
+			Report.MantlePath = Movement->GetMantlePathAllocatedSize();
+		}
+
+		TInlineComponentArray<UActorComponent*> Components(&Character);
+		for (const UActorComponent* Component : Components)
+		{
+			if (!IsTfppComponent(*Component))
+			{
+				continue;
+			}
+
+			Report.OtherComponents += Component->GetClass()->GetStructureSize();
+			if (const UTfppFootPlacementComponent* FootPlacement = Cast<UTfppFootPlacementComponent>(Component))
+			{
+				Report.OtherComponents += FootPlacement->GetAllocatedSize();
+			}
+			else if (const UTfppHeadHistoryComponent* HeadHistory = Cast<UTfppHeadHistoryComponent>(Component))
+			{
+				Report.OtherComponents += HeadHistory->GetAllocatedSize();
+			}
+			else if (const UTfppFootstepComponent* Footsteps = Cast<UTfppFootstepComponent>(Component))
+			{
+				Report.OtherComponents += Footsteps->GetAllocatedSize();
+			}
+			else if (const UTfppSoakBotComponent* SoakBot = Cast<UTfppSoakBotComponent>(Component))
+			{
+				Report.OtherComponents += SoakBot->GetAllocatedSize();
+			}
+		}
+
+		return Report;
+	}
+
+	bool MeasureWorld(const UWorld* World, FTfppPawnMemoryReport& OutAggregate, int32& OutNumPawns, int32& OutNumOverBudget)
+	{
+		OutAggregate = FTfppPawnMemoryReport();
+		OutNumPawns = 0;
+		OutNumOverBudget = 0;
+
+		const int64 Budget = UTfppDevSettings::Get()->PerPawnMemoryBudget;
+		for (TActorIterator<ATfppCharacter> It(World); It; ++It)
+		{
+			const FTfppPawnMemoryReport Report = MeasurePawn(**It);
+			OutAggregate += Report;
+			++OutNumPawns;
+			if (Budget > 0 && static_cast<int64>(Report.GetTotal()) > Budget)
+			{
+				++OutNumOverBudget;
+			}
+		}
+
+		return OutNumOverBudget == 0;
+	}
+
+	static void PrintReport(const TCHAR* Label, const FTfppPawnMemoryReport& Report, FOutputDevice& Ar)
+	{
+		Ar.Logf(TEXT("%s: %llu bytes (character %llu, movement %llu, PaceMaxSpeed %llu, StanceSpeedMultiplier %llu, ")
+			TEXT("PacesAngleRestriction %llu, OnPaceChanged %llu, OnStanceChanged %llu, SurfaceSpeedModifiers %llu, ")
+			TEXT("MantlePath %llu, other components %llu)"),
+			Label, static_cast<uint64>(Report.GetTotal()), static_cast<uint64>(Report.CharacterObject),
+			static_cast<uint64>(Report.MovementComponentObject), static_cast<uint64>(Report.PaceMaxSpeed),
+			static_cast<uint64>(Report.StanceSpeedMultiplier), static_cast<uint64>(Report.PacesAngleRestriction),
+			static_cast<uint64>(Report.OnPaceChanged), static_cast<uint64>(Report.OnStanceChanged),
+			static_cast<uint64>(Report.SurfaceSpeedModifiers), static_cast<uint64>(Report.MantlePath),
+			static_cast<uint64>(Report.OtherComponents));
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice MemReportCommand(
+		TEXT("Tfpp.MemReport"),
+		TEXT("Reports the memory owned by every TFPP pawn and the aggregate. Pass -summary to skip the per pawn lines."),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+			[](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+			{
+				const bool bSummaryOnly = Args.Contains(TEXT("-summary"));
+				const int64 Budget = UTfppDevSettings::Get()->PerPawnMemoryBudget;
+
+				if (!bSummaryOnly)
+				{
+					for (TActorIterator<ATfppCharacter> It(World); It; ++It)
+					{
+						const FTfppPawnMemoryReport Report = MeasurePawn(**It);
+						PrintReport(*It->GetName(), Report, Ar);
+					}
+				}
+
+				FTfppPawnMemoryReport Aggregate;
+				int32 NumPawns = 0;
+				int32 NumOverBudget = 0;
+				MeasureWorld(World, Aggregate, NumPawns, NumOverBudget);
+				PrintReport(*FString::Printf(TEXT("Total for %d pawns"), NumPawns), Aggregate, Ar);
+
+				if (Budget > 0)
+				{
+					Ar.Logf(NumOverBudget > 0 ? ELogVerbosity::Error : ELogVerbosity::Log,
+						TEXT("%d of %d pawns exceed the per pawn budget of %lld bytes."), NumOverBudget, NumPawns, Budget);
+				}
+			}));
+}
@@ -0,0 +1,383 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppNavigation.h"
+#include "TfppCharacter.h"
+#include "TfppCharacterMovementComponent.h"
+#include "TfppDevSettings.h"
+#include "TfppLog.h"
+#include "TfppStats.h"
+#include "AI/NavigationModifier.h"
+#include "AI/NavigationSystemBase.h"
+#include "AI/Navigation/NavigationRelevantData.h"
+#include "Components/BrushComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "NavAreas/NavArea_Null.h"
+#include "NavigationData.h"
+#include "NavMesh/RecastNavMesh.h"
+
+TSubclassOf<UNavArea> UTfppNavArea_Stance::GetAreaClass(ECharacterStances Stance)
+{
+	switch (Stance)
+	{
+	case ECharacterStances::StanceType1: return UTfppNavArea_Stance1::StaticClass();
+	case ECharacterStances::StanceType2: return UTfppNavArea_Stance2::StaticClass();
+	case ECharacterStances::StanceType3: return UTfppNavArea_Stance3::StaticClass();
+	case ECharacterStances::StanceType4: return UTfppNavArea_Stance4::StaticClass();
+	case ECharacterStances::StanceType5: return UTfppNavArea_Stance5::StaticClass();
+	case ECharacterStances::StanceType6: return UTfppNavArea_Stance6::StaticClass();
+	case ECharacterStances::StanceType7: return UTfppNavArea_Stance7::StaticClass();
+	case ECharacterStances::StanceType8: return UTfppNavArea_Stance8::StaticClass();
+	case ECharacterStances::StanceType9: return UTfppNavArea_Stance9::StaticClass();
+	default: return nullptr;
+	}
+}
+
+void UTfppNavArea_Stance::SetRequiredStance(ECharacterStances Stance)
+{
+	RequiredStance = Stance;
+	SetAreaFlag(static_cast<uint8>(Stance));
+
+	// From blue to purple as the stances get lower
+	const float Alpha = static_cast<float>(static_cast<int32>(Stance)) / (TfppTypes::NumStances - 1);
+	DrawColor = FLinearColor::LerpUsingHSV(FLinearColor(0.1f, 0.5f, 1.f), FLinearColor(0.6f, 0.1f, 0.9f), Alpha).ToFColor(true);
+}
+
+ATfppStanceNavVolume::ATfppStanceNavVolume()
+{
+	// Only the bounds of the volume matter, pawns and traces go through it
+	GetBrushComponent()->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+}
+
+void ATfppStanceNavVolume::GetNavigationData(FNavigationRelevantData& Data) const
+{
+	for (const FTfppStanceNavBox& Box : Boxes)
+	{
+		const TSubclassOf<UNavArea> AreaClass = Box.bBlocked ? TSubclassOf<UNavArea>(UNavArea_Null::StaticClass()) : UTfppNavArea_Stance::GetAreaClass(Box.Stance);
+		if (AreaClass)
+		{
+			Data.Modifiers.Add(FAreaNavModifier(Box.Box, FTransform::Identity, AreaClass));
+		}
+	}
+}
+
+FBox ATfppStanceNavVolume::GetNavigationBounds() const
+{
+	return BakedBounds;
+}
+
+bool ATfppStanceNavVolume::IsNavigationRelevant() const
+{
+	return !Boxes.IsEmpty();
+}
+
+void ATfppStanceNavVolume::Bake()
+{
+	TArray<FTfppStanceNavBox> NewBoxes;
+	BakeBoxes(NewBoxes);
+
+	Modify();
+	Boxes = MoveTemp(NewBoxes);
+	BakedBounds = FBox(ForceInit);
+	for (const FTfppStanceNavBox& Box : Boxes)
+	{
+		BakedBounds += Box.Box;
+	}
+	FNavigationSystem::UpdateActorData(*this);
+
+	DEV_LOG_ARGS(Log, "%s baked %d stance navigation boxes.", *GetName(), Boxes.Num());
+}
+
+void ATfppStanceNavVolume::BakeBoxes(TArray<FTfppStanceNavBox>& OutBoxes) const
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppStanceNavBake);
+
+	OutBoxes.Reset();
+	const UWorld* World = GetWorld();
+	ECharacterStances TallestStance;
+	if (!World || !UTfppNavigationSubsystem::FindTallestStance(TNumericLimits<uint16>::Max(), TallestStance))
+	{
+		return;
+	}
+	const float StandingClearance = UTfppDevSettings::Get()->StanceClearances.FindChecked(TallestStance);
+
+	const FBox Bounds = GetComponentsBoundingBox(true);
+	const FVector Size = Bounds.GetSize();
+	const int32 NumX = FMath::FloorToInt32(Size.X / SampleSpacing) + 1;
+	const int32 NumY = FMath::FloorToInt32(Size.Y / SampleSpacing) + 1;
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(TfppStanceNavBake), false, this);
+
+	// A floor a pawn can't stand on, what fits under its ceiling is in Kind: a stance, or Blocked if none does
+	struct FLowFloor
+	{
+		float Z;
+		float Clearance;
+		int32 Kind;
+	};
+	constexpr int32 Blocked = TfppTypes::NumStances;
+
+	struct FRun
+	{
+		int32 XStart;
+		int32 XEnd;
+		int32 YStart;
+		int32 YEnd;
+		float MinZ;
+		float MaxZ;
+		float LastZ;
+		float MinClearance;
+		int32 Kind;
+	};
+
+	auto EmitBox = [&](const FRun& Run)
+	{
+		FTfppStanceNavBox& Box = OutBoxes.AddDefaulted_GetRef();
+		Box.bBlocked = Run.Kind == Blocked;
+		Box.Stance = Box.bBlocked ? TallestStance : static_cast<ECharacterStances>(Run.Kind);
+
+		// Only the boxes pawns walk into need the margin, blocked ones would eat into the floor around them
+		const double Margin = SampleSpacing * 0.5 + (Box.bBlocked ? 0.0 : Padding);
+		const double Height = FMath::Min(MaxStepHeight, Run.MinClearance * 0.5f);
+		Box.Box = FBox(
+			FVector(Bounds.Min.X + Run.XStart * SampleSpacing - Margin, Bounds.Min.Y + Run.YStart * SampleSpacing - Margin, Run.MinZ - MaxStepHeight),
+			FVector(Bounds.Min.X + Run.XEnd * SampleSpacing + Margin, Bounds.Min.Y + Run.YEnd * SampleSpacing + Margin, Run.MaxZ + Height));
+	};
+
+	// Runs of the previous row still open, extended by the runs of the next row that match them exactly
+	TArray<FRun> OpenRuns;
+	TArray<FRun> RowRuns;
+	TArray<FRun> NextOpenRuns;
+	TArray<FLowFloor, TInlineAllocator<4>> Floors;
+
+	for (int32 Y = 0; Y < NumY; ++Y)
+	{
+		RowRuns.Reset();
+		for (int32 X = 0; X < NumX; ++X)
+		{
+			const FVector Sample(Bounds.Min.X + X * SampleSpacing, Bounds.Min.Y + Y * SampleSpacing, 0.0);
+
+			// Walk down the floors on top of each other, each ray starting just under the floor found by the last one
+			Floors.Reset();
+			double TraceTop = Bounds.Max.Z;
+			for (int32 Attempt = 0; Attempt < MaxLayers * 2 && Floors.Num() < MaxLayers && TraceTop > Bounds.Min.Z; ++Attempt)
+			{
+				FHitResult Floor;
+				if (!World->LineTraceSingleByChannel(Floor, FVector(Sample.X, Sample.Y, TraceTop), FVector(Sample.X, Sample.Y, Bounds.Min.Z), TraceChannel, Params))
+				{
+					break;
+				}
+				TraceTop = Floor.ImpactPoint.Z - FloorThickness;
+
+				// Started inside the geometry, or too steep to stand on
+				if (Floor.bStartPenetrating || Floor.Distance <= 0.f || Floor.ImpactNormal.Z < WalkableFloorZ)
+				{
+					continue;
+				}
+
+				FHitResult Ceiling;
+				const FVector FloorPoint = Floor.ImpactPoint;
+				if (!World->LineTraceSingleByChannel(Ceiling, FloorPoint + FVector(0.0, 0.0, 1.0), FVector(FloorPoint.X, FloorPoint.Y, Bounds.Max.Z), TraceChannel, Params))
+				{
+					continue;
+				}
+
+				const float Clearance = Ceiling.ImpactPoint.Z - FloorPoint.Z;
+				if (Clearance >= StandingClearance)
+				{
+					continue;
+				}
+
+				ECharacterStances Stance;
+				const bool bFits = UTfppNavigationSubsystem::FindStanceForClearance(Clearance, TNumericLimits<uint16>::Max(), Stance);
+				Floors.Add({static_cast<float>(FloorPoint.Z), Clearance, bFits ? static_cast<int32>(Stance) : Blocked});
+			}
+
+			// Extend the runs of the row that ended on the previous sample, or start new ones
+			for (const FLowFloor& Floor : Floors)
+			{
+				FRun* Run = RowRuns.FindByPredicate([&Floor, X, this](const FRun& Candidate)
+				{
+					return Candidate.XEnd == X - 1 && Candidate.Kind == Floor.Kind && FMath::Abs(Candidate.LastZ - Floor.Z) <= MaxStepHeight;
+				});
+				if (Run)
+				{
+					Run->XEnd = X;
+					Run->MinZ = FMath::Min(Run->MinZ, Floor.Z);
+					Run->MaxZ = FMath::Max(Run->MaxZ, Floor.Z);
+					Run->LastZ = Floor.Z;
+					Run->MinClearance = FMath::Min(Run->MinClearance, Floor.Clearance);
+				}
+				else
+				{
+					RowRuns.Add({X, X, Y, Y, Floor.Z, Floor.Z, Floor.Z, Floor.Clearance, Floor.Kind});
+				}
+			}
+		}
+
+		// Runs covering the same columns as an open run of the previous row, at the same height, grow it into a box
+		NextOpenRuns.Reset();
+		for (const FRun& RowRun : RowRuns)
+		{
+			const int32 OpenIndex = OpenRuns.IndexOfByPredicate([&RowRun, this](const FRun& Open)
+			{
+				return Open.XStart == RowRun.XStart && Open.XEnd == RowRun.XEnd && Open.Kind == RowRun.Kind
+					&& FMath::Abs(Open.MinZ - RowRun.MinZ) <= MaxStepHeight && FMath::Abs(Open.MaxZ - RowRun.MaxZ) <= MaxStepHeight;
+			});
+			if (OpenIndex == INDEX_NONE)
+			{
+				NextOpenRuns.Add(RowRun);
+				continue;
+			}
+
+			FRun Grown = OpenRuns[OpenIndex];
+			OpenRuns.RemoveAtSwap(OpenIndex);
+			Grown.YEnd = Y;
+			Grown.MinZ = FMath::Min(Grown.MinZ, RowRun.MinZ);
+			Grown.MaxZ = FMath::Max(Grown.MaxZ, RowRun.MaxZ);
+			Grown.MinClearance = FMath::Min(Grown.MinClearance, RowRun.MinClearance);
+			NextOpenRuns.Add(Grown);
+		}
+
+		for (const FRun& Closed : OpenRuns)
+		{
+			EmitBox(Closed);
+		}
+		Swap(OpenRuns, NextOpenRuns);
+	}
+
+	for (const FRun& Closed : OpenRuns)
+	{
+		EmitBox(Closed);
+	}
+}
+
+bool UTfppNavigationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+FSharedConstNavQueryFilter UTfppNavigationSubsystem::GetQueryFilter(const ANavigationData& NavData, uint16 StanceMask)
+{
+	TMap<uint16, FSharedConstNavQueryFilter>& Filters = QueryFilters.FindOrAdd(&NavData);
+	if (const FSharedConstNavQueryFilter* Filter = Filters.Find(StanceMask))
+	{
+		return *Filter;
+	}
+
+	const FSharedConstNavQueryFilter DefaultFilter = NavData.GetDefaultQueryFilter();
+	if (!DefaultFilter.IsValid())
+	{
+		return DefaultFilter;
+	}
+
+	// Keep out of the areas of the stances lower than any stance of the set
+	uint16 ExcludeFlags = DefaultFilter->GetExcludeFlags();
+	for (const TPair<ECharacterStances, float>& StanceClearance : UTfppDevSettings::Get()->StanceClearances)
+	{
+		ECharacterStances Stance;
+		if (UTfppNavArea_Stance::GetAreaClass(StanceClearance.Key) && !FindStanceForClearance(StanceClearance.Value, StanceMask, Stance))
+		{
+			ExcludeFlags |= UTfppNavArea_Stance::GetStanceFlag(StanceClearance.Key);
+		}
+	}
+
+	const FSharedNavQueryFilter Filter = DefaultFilter->GetCopy();
+	Filter->SetExcludeFlags(ExcludeFlags);
+	Filters.Add(StanceMask, Filter);
+	return Filter;
+}
+
+uint16 UTfppNavigationSubsystem::GetStanceMask(const UTfppCharacterMovementComponent& Movement)
+{
+	uint16 Mask = UTfppNavArea_Stance::GetStanceFlag(Movement.StandingStance) | UTfppNavArea_Stance::GetStanceFlag(Movement.CrouchingStance);
+	for (const TPair<ECharacterStances, float>& StanceMultiplier : Movement.StanceSpeedMultiplier)
+	{
+		Mask |= UTfppNavArea_Stance::GetStanceFlag(StanceMultiplier.Key);
+	}
+	return Mask;
+}
+
+bool UTfppNavigationSubsystem::FindStanceForClearance(float Clearance, uint16 StanceMask, ECharacterStances& OutStance)
+{
+	float BestClearance = -1.f;
+	for (const TPair<ECharacterStances, float>& StanceClearance : UTfppDevSettings::Get()->StanceClearances)
+	{
+		if ((StanceMask & UTfppNavArea_Stance::GetStanceFlag(StanceClearance.Key)) && StanceClearance.Value <= Clearance
+			&& StanceClearance.Value > BestClearance)
+		{
+			BestClearance = StanceClearance.Value;
+			OutStance = StanceClearance.Key;
+		}
+	}
+	return BestClearance >= 0.f;
+}
+
+bool UTfppNavigationSubsystem::FindTallestStance(uint16 StanceMask, ECharacterStances& OutStance)
+{
+	return FindStanceForClearance(TNumericLimits<float>::Max(), StanceMask, OutStance);
+}
+
+void UTfppPathFollowingComponent::SetMoveSegment(int32 SegmentStartIndex)
+{
+	Super::SetMoveSegment(SegmentStartIndex);
+
+	const AController* Controller = Cast<AController>(GetOwner());
+	ATfppCharacter* Character = Controller ? Cast<ATfppCharacter>(Controller->GetPawn()) : nullptr;
+	if (Character && Path.IsValid() && Path->GetPathPoints().IsValidIndex(SegmentStartIndex))
+	{
+		// The area flags of the polygon the segment starts on are packed in the flags of the path point
+		UpdateStance(Character, FNavMeshNodeFlags(Path->GetPathPoints()[SegmentStartIndex].Flags).AreaFlags);
+	}
+}
+
+void UTfppPathFollowingComponent::UpdateStance(ATfppCharacter* Character, uint16 AreaFlags)
+{
+	// Bit 0 is the default walkable flag, the stance areas only set one of the others
+	ECharacterStances AreaStance = ECharacterStances::StanceType0;
+	for (int32 StanceIndex = 1; StanceIndex < TfppTypes::NumStances; ++StanceIndex)
+	{
+		if (AreaFlags & UTfppNavArea_Stance::GetStanceFlag(static_cast<ECharacterStances>(StanceIndex)))
+		{
+			AreaStance = static_cast<ECharacterStances>(StanceIndex);
+			break;
+		}
+	}
+
+	if (AreaStance == ECharacterStances::StanceType0)
+	{
+		if (bStanceFromArea)
+		{
+			bStanceFromArea = false;
+			Character->SetStance(StanceBeforeArea);
+			INC_DWORD_STAT(STAT_TfppNavStanceSwitches);
+		}
+		return;
+	}
+
+	const TMap<ECharacterStances, float>& StanceClearances = UTfppDevSettings::Get()->StanceClearances;
+	const float* AreaClearance = StanceClearances.Find(AreaStance);
+	ECharacterStances Stance;
+	if (!AreaClearance || !UTfppNavigationSubsystem::FindStanceForClearance(*AreaClearance,
+		UTfppNavigationSubsystem::GetStanceMask(*Character->GetTfppCharacterMovement()), Stance))
+	{
+		return;
+	}
+
+	// A stance the pawn picked itself is kept as long as it fits
+	const ECharacterStances CurrentStance = Character->GetCurrentStance();
+	const float* CurrentClearance = StanceClearances.Find(CurrentStance);
+	if (CurrentStance == Stance || (!bStanceFromArea && CurrentClearance && *CurrentClearance <= *AreaClearance))
+	{
+		return;
+	}
+
+	if (!bStanceFromArea)
+	{
+		bStanceFromArea = true;
+		StanceBeforeArea = CurrentStance;
+	}
+	Character->SetStance(Stance);
+	INC_DWORD_STAT(STAT_TfppNavStanceSwitches);
+}
@@ -0,0 +1,486 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppPoseSearch.h"
+#include "TfppLog.h"
+#include "TfppStats.h"
+#include "Animation/AnimSequence.h"
+#include "UObject/ObjectSaveContext.h"
+#include <algorithm>
+
+namespace TfppPoseSearch
+{
+	// Power iterations used to extract each principal component. The covariance matrices are tiny, so this is plenty.
+	constexpr int32 NumPowerIterations = 64;
+
+	/**
+	 * Extracts the top eigenvectors of a symmetric matrix with power iteration and deflation.
+	 * Covariance is consumed in the process.
+	 */
+	static void ExtractPrincipalComponents(TArray<float>& Covariance, int32 Dimensions, int32 NumComponents, TArray<float>& OutComponents)
+	{
+		OutComponents.SetNumZeroed(NumComponents * Dimensions);
+		TArray<float> Vector;
+		TArray<float> Next;
+		Vector.SetNumUninitialized(Dimensions);
+		Next.SetNumUninitialized(Dimensions);
+
+		for (int32 Component = 0; Component < NumComponents; ++Component)
+		{
+			// Start from a vector that isn't orthogonal to any axis
+			for (int32 Index = 0; Index < Dimensions; ++Index)
+			{
+				Vector[Index] = 1.f / FMath::Sqrt(static_cast<float>(Dimensions)) + (Index == Component ? 0.5f : 0.f);
+			}
+
+			float EigenValue = 0.f;
+			for (int32 Iteration = 0; Iteration < NumPowerIterations; ++Iteration)
+			{
+				float LengthSq = 0.f;
+				for (int32 Row = 0; Row < Dimensions; ++Row)
+				{
+					float Sum = 0.f;
+					for (int32 Column = 0; Column < Dimensions; ++Column)
+					{
+						Sum += Covariance[Row * Dimensions + Column] * Vector[Column];
+					}
+					Next[Row] = Sum;
+					LengthSq += Sum * Sum;
+				}
+
+				if (LengthSq <= UE_SMALL_NUMBER)
+				{
+					// Nothing left to explain, the remaining components stay zero
+					EigenValue = 0.f;
+					break;
+				}
+
+				EigenValue = FMath::Sqrt(LengthSq);
+				for (int32 Index = 0; Index < Dimensions; ++Index)
+				{
+					Vector[Index] = Next[Index] / EigenValue;
+				}
+			}
+
+			if (EigenValue <= 0.f)
+			{
+				break;
+			}
+
+			for (int32 Index = 0; Index < Dimensions; ++Index)
+			{
+				OutComponents[Component * Dimensions + Index] = Vector[Index];
+			}
+
+			// Deflate so the next iteration converges to the following component
+			for (int32 Row = 0; Row < Dimensions; ++Row)
+			{
+				for (int32 Column = 0; Column < Dimensions; ++Column)
+				{
+					Covariance[Row * Dimensions + Column] -= EigenValue * Vector[Row] * Vector[Column];
+				}
+			}
+		}
+	}
+}
+
+void FTfppPoseSearchIndex::Build(TConstArrayView<float> Features, int32 InNumFeatures, int32 InNumReducedFeatures, int32 LeafSize)
+{
+	check(InNumFeatures > 0 && Features.Num() % InNumFeatures == 0);
+
+	NumFeatures = InNumFeatures;
+	NumReducedFeatures = FMath::Clamp(InNumReducedFeatures, 1, InNumFeatures);
+	Mean.Reset();
+	InvDeviation.Reset();
+	Projection.Reset();
+	ReducedPoints.Reset();
+	PoseIndices.Reset();
+	Nodes.Reset();
+
+	const int32 NumPoses = Features.Num() / NumFeatures;
+	if (NumPoses == 0)
+	{
+		return;
+	}
+
+	// Mean and standard deviation of the features
+	Mean.SetNumZeroed(NumFeatures);
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			Mean[Feature] += Features[Pose * NumFeatures + Feature];
+		}
+	}
+	for (float& Value : Mean)
+	{
+		Value /= NumPoses;
+	}
+
+	InvDeviation.SetNumZeroed(NumFeatures);
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			InvDeviation[Feature] += FMath::Square(Features[Pose * NumFeatures + Feature] - Mean[Feature]);
+		}
+	}
+	for (float& Value : InvDeviation)
+	{
+		// Constant features can't tell poses apart, they are left as they are
+		const float Deviation = FMath::Sqrt(Value / NumPoses);
+		Value = Deviation > UE_KINDA_SMALL_NUMBER ? 1.f / Deviation : 1.f;
+	}
+
+	// Covariance of the standardized features
+	TArray<float> Standardized;
+	Standardized.SetNumUninitialized(Features.Num());
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			const int32 Index = Pose * NumFeatures + Feature;
+			Standardized[Index] = (Features[Index] - Mean[Feature]) * InvDeviation[Feature];
+		}
+	}
+
+	TArray<float> Covariance;
+	Covariance.SetNumZeroed(NumFeatures * NumFeatures);
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		const float* Point = &Standardized[Pose * NumFeatures];
+		for (int32 Row = 0; Row < NumFeatures; ++Row)
+		{
+			for (int32 Column = 0; Column < NumFeatures; ++Column)
+			{
+				Covariance[Row * NumFeatures + Column] += Point[Row] * Point[Column];
+			}
+		}
+	}
+	for (float& Value : Covariance)
+	{
+		Value /= NumPoses;
+	}
+
+	TfppPoseSearch::ExtractPrincipalComponents(Covariance, NumFeatures, NumReducedFeatures, Projection);
+
+	// Project every pose
+	TArray<float> Points;
+	Points.SetNumUninitialized(NumPoses * NumReducedFeatures);
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		Reduce(&Features[Pose * NumFeatures], &Points[Pose * NumReducedFeatures]);
+	}
+
+	TArray<int32> Order;
+	Order.SetNumUninitialized(NumPoses);
+	for (int32 Pose = 0; Pose < NumPoses; ++Pose)
+	{
+		Order[Pose] = Pose;
+	}
+
+	Nodes.Reserve(2 * FMath::DivideAndRoundUp(NumPoses, FMath::Max(LeafSize, 1)));
+	BuildNode(Order, Points, 0, NumPoses, FMath::Max(LeafSize, 1));
+
+	// Store the points in tree order so every leaf is contiguous
+	ReducedPoints.SetNumUninitialized(NumPoses * NumReducedFeatures);
+	for (int32 Slot = 0; Slot < NumPoses; ++Slot)
+	{
+		FMemory::Memcpy(&ReducedPoints[Slot * NumReducedFeatures], &Points[Order[Slot] * NumReducedFeatures], NumReducedFeatures * sizeof(float));
+	}
+	PoseIndices = MoveTemp(Order);
+}
+
+void FTfppPoseSearchIndex::Reduce(const float* Features, float* OutReduced) const
+{
+	TArray<float, TInlineAllocator<16>> Standardized;
+	Standardized.SetNumUninitialized(NumFeatures);
+	for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+	{
+		Standardized[Feature] = (Features[Feature] - Mean[Feature]) * InvDeviation[Feature];
+	}
+
+	for (int32 Component = 0; Component < NumReducedFeatures; ++Component)
+	{
+		float Sum = 0.f;
+		for (int32 Feature = 0; Feature < NumFeatures; ++Feature)
+		{
+			Sum += Projection[Component * NumFeatures + Feature] * Standardized[Feature];
+		}
+		OutReduced[Component] = Sum;
+	}
+}
+
+int32 FTfppPoseSearchIndex::BuildNode(TArray<int32>& Order, const TArray<float>& Points, int32 Begin, int32 End, int32 LeafSize)
+{
+	const int32 NodeIndex = Nodes.AddDefaulted();
+	Nodes[NodeIndex].Begin = Begin;
+	Nodes[NodeIndex].End = End;
+
+	if (End - Begin <= LeafSize)
+	{
+		return NodeIndex;
+	}
+
+	// Split on the reduced feature with the widest spread
+	int32 SplitDimension = 0;
+	float WidestSpread = -1.f;
+	for (int32 Dimension = 0; Dimension < NumReducedFeatures; ++Dimension)
+	{
+		float Min = MAX_flt;
+		float Max = -MAX_flt;
+		for (int32 Slot = Begin; Slot < End; ++Slot)
+		{
+			const float Value = Points[Order[Slot] * NumReducedFeatures + Dimension];
+			Min = FMath::Min(Min, Value);
+			Max = FMath::Max(Max, Value);
+		}
+		if (Max - Min > WidestSpread)
+		{
+			WidestSpread = Max - Min;
+			SplitDimension = Dimension;
+		}
+	}
+
+	const int32 Middle = Begin + (End - Begin) / 2;
+	std::nth_element(Order.GetData() + Begin, Order.GetData() + Middle, Order.GetData() + End,
+		[&Points, SplitDimension, this](int32 A, int32 B)
+		{
+			return Points[A * NumReducedFeatures + SplitDimension] < Points[B * NumReducedFeatures + SplitDimension];
+		});
+	const float SplitValue = Points[Order[Middle] * NumReducedFeatures + SplitDimension];
+
+	const int32 Left = BuildNode(Order, Points, Begin, Middle, LeafSize);
+	const int32 Right = BuildNode(Order, Points, Middle, End, LeafSize);
+
+	// Nodes may have been reallocated by the recursion
+	FTfppPoseSearchNode& Node = Nodes[NodeIndex];
+	Node.SplitDimension = SplitDimension;
+	Node.SplitValue = SplitValue;
+	Node.Left = Left;
+	Node.Right = Right;
+	return NodeIndex;
+}
+
+int32 FTfppPoseSearchIndex::Search(TConstArrayView<float> Query, float* OutDistanceSq) const
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppPoseSearch);
+
+	if (IsEmpty() || !ensure(Query.Num() == NumFeatures))
+	{
+		return INDEX_NONE;
+	}
+
+	TArray<float, TInlineAllocator<8>> ReducedQuery;
+	ReducedQuery.SetNumUninitialized(NumReducedFeatures);
+	Reduce(Query.GetData(), ReducedQuery.GetData());
+
+	struct FPendingNode
+	{
+		int32 Node;
+		float MinDistanceSq;
+	};
+	TArray<FPendingNode, TInlineAllocator<64>> Stack;
+	Stack.Add({0, 0.f});
+
+	int32 BestSlot = INDEX_NONE;
+	float BestDistanceSq = MAX_flt;
+
+	while (!Stack.IsEmpty())
+	{
+		const FPendingNode Pending = Stack.Pop();
+		if (Pending.MinDistanceSq >= BestDistanceSq)
+		{
+			continue;
+		}
+
+		const FTfppPoseSearchNode& Node = Nodes[Pending.Node];
+		if (Node.SplitDimension == INDEX_NONE)
+		{
+			for (int32 Slot = Node.Begin; Slot < Node.End; ++Slot)
+			{
+				const float* Point = &ReducedPoints[Slot * NumReducedFeatures];
+				float DistanceSq = 0.f;
+				for (int32 Component = 0; Component < NumReducedFeatures; ++Component)
+				{
+					const float Delta = Point[Component] - ReducedQuery[Component];
+					DistanceSq += Delta * Delta;
+				}
+				if (DistanceSq < BestDistanceSq)
+				{
+					BestDistanceSq = DistanceSq;
+					BestSlot = Slot;
+				}
+			}
+			continue;
+		}
+
+		const float Delta = ReducedQuery[Node.SplitDimension] - Node.SplitValue;
+		const int32 Near = Delta < 0.f ? Node.Left : Node.Right;
+		const int32 Far = Delta < 0.f ? Node.Right : Node.Left;
+
+		// Far side is pushed first so the near side is visited first
+		Stack.Add({Far, FMath::Max(Pending.MinDistanceSq, Delta * Delta)});
+		Stack.Add({Near, Pending.MinDistanceSq});
+	}
+
+	if (OutDistanceSq)
+	{
+		*OutDistanceSq = BestDistanceSq;
+	}
+	return BestSlot != INDEX_NONE ? PoseIndices[BestSlot] : INDEX_NONE;
+}
+
+int32 FTfppPoseSearchIndex::SearchBruteForce(TConstArrayView<float> Query, float* OutDistanceSq) const
+{
+	if (IsEmpty() || !ensure(Query.Num() == NumFeatures))
+	{
+		return INDEX_NONE;
+	}
+
+	TArray<float, TInlineAllocator<8>> ReducedQuery;
+	ReducedQuery.SetNumUninitialized(NumReducedFeatures);
+	Reduce(Query.GetData(), ReducedQuery.GetData());
+
+	int32 BestSlot = INDEX_NONE;
+	float BestDistanceSq = MAX_flt;
+	for (int32 Slot = 0; Slot < PoseIndices.Num(); ++Slot)
+	{
+		float DistanceSq = 0.f;
+		for (int32 Component = 0; Component < NumReducedFeatures; ++Component)
+		{
+			DistanceSq += FMath::Square(ReducedPoints[Slot * NumReducedFeatures + Component] - ReducedQuery[Component]);
+		}
+		if (DistanceSq < BestDistanceSq)
+		{
+			BestDistanceSq = DistanceSq;
+			BestSlot = Slot;
+		}
+	}
+
+	if (OutDistanceSq)
+	{
+		*OutDistanceSq = BestDistanceSq;
+	}
+	return PoseIndices[BestSlot];
+}
+
+void UTfppLocomotionDatabase::PostInitProperties()
+{
+	Super::PostInitProperties();
+	RebuildSetLookup();
+}
+
+void UTfppLocomotionDatabase::PostLoad()
+{
+	Super::PostLoad();
+	RebuildSetLookup();
+}
+
+#if WITH_EDITOR
+void UTfppLocomotionDatabase::PreSave(FObjectPreSaveContext SaveContext)
+{
+	BuildIndices();
+	Super::PreSave(SaveContext);
+}
+
+void UTfppLocomotionDatabase::BuildIndices()
+{
+	for (FTfppLocomotionSet& Set : LocomotionSets)
+	{
+		Set.Entries.Reset();
+		TArray<float> Features;
+
+		for (int32 ClipIndex = 0; ClipIndex < Set.Clips.Num(); ++ClipIndex)
+		{
+			const UAnimSequence* Clip = Set.Clips[ClipIndex];
+			if (!Clip)
+			{
+				continue;
+			}
+
+			const float Length = Clip->GetPlayLength();
+			const float LastHorizon = TrajectoryHorizons[NumTrajectorySamples - 1];
+			const float LastTime = FMath::Max(SampleInterval, Length - LastHorizon);
+
+			for (float Time = SampleInterval; Time <= LastTime; Time += SampleInterval)
+			{
+				const FVector Velocity = Clip->ExtractRootMotionFromRange(Time - SampleInterval, Time).GetTranslation() / SampleInterval;
+				Features.Add(Velocity.X);
+				Features.Add(Velocity.Y);
+				for (int32 Sample = 0; Sample < NumTrajectorySamples; ++Sample)
+				{
+					const float FutureTime = FMath::Min(Time + TrajectoryHorizons[Sample], Length);
+					const FVector Position = Clip->ExtractRootMotionFromRange(Time, FutureTime).GetTranslation();
+					Features.Add(Position.X);
+					Features.Add(Position.Y);
+				}
+				FTfppPoseSearchEntry& Entry = Set.Entries.AddDefaulted_GetRef();
+				Entry.ClipIndex = ClipIndex;
+				Entry.Time = Time;
+			}
+		}
+
+		Set.Index.Build(Features, NumFeatures, NumReducedFeatures);
+		DEV_LOG_ARGS(Log, "Indexed %d poses for %s / %s.", Set.Entries.Num(),
+			*UEnum::GetValueAsString(Set.Pace), *UEnum::GetValueAsString(Set.Stance));
+	}
+
+	RebuildSetLookup();
+}
+#endif
+
+void UTfppLocomotionDatabase::MakeQuery(const FVector& CurrentVelocity, const FVector& DesiredVelocity, TArrayView<float> OutFeatures) const
+{
+	check(OutFeatures.Num() == NumFeatures);
+
+	OutFeatures[0] = CurrentVelocity.X;
+	OutFeatures[1] = CurrentVelocity.Y;
+
+	// Velocity converges exponentially from the current to the desired one, this is its integral at each horizon
+	const FVector VelocityOffset = CurrentVelocity - DesiredVelocity;
+	for (int32 Sample = 0; Sample < NumTrajectorySamples; ++Sample)
+	{
+		const float Horizon = TrajectoryHorizons[Sample];
+		const float Decay = 1.f - FMath::Exp(-Horizon / TrajectoryResponseTime);
+		const FVector Position = DesiredVelocity * Horizon + VelocityOffset * (TrajectoryResponseTime * Decay);
+		OutFeatures[2 + Sample * 2] = Position.X;
+		OutFeatures[3 + Sample * 2] = Position.Y;
+	}
+}
+
+bool UTfppLocomotionDatabase::Search(EMovementPaces Pace, ECharacterStances Stance, TConstArrayView<float> Query, FTfppPoseSearchResult& OutResult) const
+{
+	const int32 SetIndex = SetLookup[static_cast<uint8>(Pace)][static_cast<uint8>(Stance)];
+	if (SetIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FTfppLocomotionSet& Set = LocomotionSets[SetIndex];
+	float DistanceSq = 0.f;
+	const int32 Pose = Set.Index.Search(Query, &DistanceSq);
+	if (!Set.Entries.IsValidIndex(Pose))
+	{
+		return false;
+	}
+
+	const FTfppPoseSearchEntry& Entry = Set.Entries[Pose];
+	OutResult.Clip = Set.Clips[Entry.ClipIndex];
+	OutResult.Time = Entry.Time;
+	OutResult.Cost = DistanceSq;
+	return OutResult.Clip != nullptr;
+}
+
+void UTfppLocomotionDatabase::RebuildSetLookup()
+{
+	FMemory::Memset(SetLookup, INDEX_NONE, sizeof(SetLookup));
+	for (int32 SetIndex = 0; SetIndex < LocomotionSets.Num(); ++SetIndex)
+	{
+		const FTfppLocomotionSet& Set = LocomotionSets[SetIndex];
+		if (!Set.Index.IsEmpty())
+		{
+			SetLookup[static_cast<uint8>(Set.Pace)][static_cast<uint8>(Set.Stance)] = static_cast<int8>(SetIndex);
+		}
+	}
+}
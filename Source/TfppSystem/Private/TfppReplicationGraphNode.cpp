@@ -0,0 +1,170 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppReplicationGraphNode.h"
+#include "TfppCharacter.h"
+#include "TfppStats.h"
+
+UTfppReplicationGraphNode_FirstPersonView::UTfppReplicationGraphNode_FirstPersonView()
+{
+	bRequiresPrepareForReplicationCall = true;
+}
+
+void UTfppReplicationGraphNode_FirstPersonView::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	Characters.AddUnique(ActorInfo.Actor);
+}
+
+bool UTfppReplicationGraphNode_FirstPersonView::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	// The grid is rebuilt from Characters before every gather, so it doesn't need to be touched here
+	return Characters.RemoveSwap(ActorInfo.Actor) > 0;
+}
+
+void UTfppReplicationGraphNode_FirstPersonView::NotifyResetAllNetworkActors()
+{
+	Characters.Reset();
+	Grid.Reset();
+}
+
+void UTfppReplicationGraphNode_FirstPersonView::PrepareForReplication()
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppReplicationGather);
+
+	// Empty the cells but keep their allocations, most characters stay in the same cell from a frame to the next
+	for (TPair<FIntPoint, TArray<AActor*>>& Cell : Grid)
+	{
+		Cell.Value.Reset();
+	}
+
+	for (AActor* Character : Characters)
+	{
+		if (IsValid(Character))
+		{
+			Grid.FindOrAdd(GetCell(Character->GetActorLocation())).Add(Character);
+		}
+	}
+}
+
+void UTfppReplicationGraphNode_FirstPersonView::GetViewerView(const FNetViewer& Viewer, FVector& OutLocation, FVector& OutDirection)
+{
+	OutLocation = Viewer.ViewLocation;
+	OutDirection = Viewer.ViewDir;
+
+	// The adjusted view rotation is what the head camera actually looks at, the control rotation can be past the
+	// pitch and yaw ranges of the character
+	if (ATfppCharacter* Character = Cast<ATfppCharacter>(Viewer.ViewTarget))
+	{
+		const FRotator Adjusted = Character->GetAdjustedViewRotation();
+		OutDirection = FRotator(Adjusted.Pitch, Character->GetActorRotation().Yaw + Adjusted.Yaw, 0.f).Vector();
+	}
+}
+
+void UTfppReplicationGraphNode_FirstPersonView::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppReplicationGather);
+
+	const float CullDistanceSquared = FMath::Square(CullDistance);
+	const float AlwaysInViewDistanceSquared = FMath::Square(AlwaysInViewDistance);
+	const float ViewConeCos = FMath::Cos(FMath::DegreesToRadians(ViewConeHalfAngle));
+	const int32 CellRadius = FMath::CeilToInt(CullDistance / CellSize);
+	const bool bSplitScreen = Params.Viewers.Num() > 1;
+
+	Candidates.Reset();
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		FVector ViewLocation;
+		FVector ViewDirection;
+		GetViewerView(Viewer, ViewLocation, ViewDirection);
+
+		const FIntPoint Center = GetCell(ViewLocation);
+		for (int32 X = Center.X - CellRadius; X <= Center.X + CellRadius; ++X)
+		{
+			for (int32 Y = Center.Y - CellRadius; Y <= Center.Y + CellRadius; ++Y)
+			{
+				const TArray<AActor*>* Cell = Grid.Find(FIntPoint(X, Y));
+				if (!Cell)
+				{
+					continue;
+				}
+
+				for (AActor* Character : *Cell)
+				{
+					if (Character == Viewer.ViewTarget || Character == Viewer.InViewer)
+					{
+						// Owned pawns are replicated through the connection's own nodes
+						continue;
+					}
+
+					const FVector ToCharacter = Character->GetActorLocation() - ViewLocation;
+					const float DistanceSquared = ToCharacter.SizeSquared();
+					if (DistanceSquared > CullDistanceSquared)
+					{
+						continue;
+					}
+
+					const float Distance = FMath::Sqrt(DistanceSquared);
+					const float ViewDot = Distance > UE_KINDA_SMALL_NUMBER ? FVector::DotProduct(ToCharacter / Distance, ViewDirection) : 1.f;
+					const bool bInView = DistanceSquared <= AlwaysInViewDistanceSquared || ViewDot >= ViewConeCos;
+
+					// Closer and more centered characters score higher, both terms are in [0, 1]
+					const float Score = (1.f - Distance / FMath::Max(CullDistance, 1.f)) + (ViewDot + 1.f) * 0.5f;
+
+					// With split screen a character can be found by several viewers, keep its best result
+					FCandidate* Existing = bSplitScreen
+						? Candidates.FindByPredicate([Character](const FCandidate& Candidate) { return Candidate.Actor == Character; })
+						: nullptr;
+					if (Existing)
+					{
+						Existing->Score = FMath::Max(Existing->Score, Score);
+						Existing->bInView |= bInView;
+					}
+					else
+					{
+						Candidates.Add({Character, Score, bInView});
+					}
+				}
+			}
+		}
+	}
+
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B)
+	{
+		return A.bInView != B.bInView ? A.bInView : A.Score > B.Score;
+	});
+
+	GatheredActors.Reset(Candidates.Num());
+	int32 NumInView = 0;
+	int32 NumOutOfView = 0;
+	int32 NumThrottled = 0;
+	for (const FCandidate& Candidate : Candidates)
+	{
+		if (Candidate.bInView && NumInView < MaxInViewPawnsPerConnection)
+		{
+			GatheredActors.Add(Candidate.Actor);
+			++NumInView;
+			continue;
+		}
+
+		// Spread the throttled characters over the interval instead of sending them all on the same frame
+		const uint32 Phase = PointerHash(Candidate.Actor) % static_cast<uint32>(OutOfViewUpdateInterval);
+		if ((Params.ReplicationFrameNum + Phase) % static_cast<uint32>(OutOfViewUpdateInterval) == 0)
+		{
+			GatheredActors.Add(Candidate.Actor);
+			++NumOutOfView;
+		}
+		else
+		{
+			++NumThrottled;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_TfppReplicatedInView, NumInView);
+	INC_DWORD_STAT_BY(STAT_TfppReplicatedOutOfView, NumOutOfView);
+	INC_DWORD_STAT_BY(STAT_TfppReplicationThrottled, NumThrottled);
+
+	if (GatheredActors.Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(GatheredActors);
+	}
+}
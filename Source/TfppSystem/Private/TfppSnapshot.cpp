@@ -0,0 +1,173 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppSnapshot.h"
+#include "TfppCharacter.h"
+#include "TfppCharacterMovementComponent.h"
+#include "TfppStats.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	// Bumped whenever the layout of a snapshot changes.
+	constexpr uint8 SnapshotVersion = 1;
+
+	// Version and snapshot count.
+	constexpr int32 SnapshotHeaderSize = sizeof(uint8) + sizeof(int32);
+}
+
+FArchive& operator<<(FArchive& Ar, FTfppCharacterSnapshot& Snapshot)
+{
+	Ar << Snapshot.Location.X << Snapshot.Location.Y << Snapshot.Location.Z;
+	Ar << Snapshot.Velocity.X << Snapshot.Velocity.Y << Snapshot.Velocity.Z;
+	Ar << Snapshot.ActorYaw << Snapshot.ControlPitch << Snapshot.ControlYaw << Snapshot.ViewPitch << Snapshot.ViewYaw;
+	Ar << Snapshot.MovementMode << Snapshot.CustomMovementMode << Snapshot.Pace << Snapshot.Stance << Snapshot.Flags;
+	return Ar;
+}
+
+FTfppCharacterSnapshot FTfppCharacterSnapshot::Capture(const ATfppCharacter& Character)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppSnapshotSave);
+
+	FTfppCharacterSnapshot Snapshot;
+	Snapshot.Location = Character.GetActorLocation();
+	Snapshot.ActorYaw = FRotator::CompressAxisToShort(Character.GetActorRotation().Yaw);
+	Snapshot.ViewPitch = FRotator::CompressAxisToShort(Character.AdjustedViewRotation.Pitch);
+	Snapshot.ViewYaw = FRotator::CompressAxisToShort(Character.AdjustedViewRotation.Yaw);
+
+	if (const AController* Controller = Character.GetController())
+	{
+		const FRotator ControlRotation = Controller->GetControlRotation();
+		Snapshot.ControlPitch = FRotator::CompressAxisToShort(ControlRotation.Pitch);
+		Snapshot.ControlYaw = FRotator::CompressAxisToShort(ControlRotation.Yaw);
+		Snapshot.Flags |= HasControlRotation;
+	}
+
+	if (const UTfppCharacterMovementComponent* Movement = Character.GetTfppCharacterMovement())
+	{
+		Snapshot.Velocity = FVector3f(Movement->Velocity);
+		Snapshot.MovementMode = Movement->MovementMode;
+		Snapshot.CustomMovementMode = Movement->CustomMovementMode;
+		Snapshot.Pace = static_cast<uint8>(Movement->GetCurrentPace());
+		Snapshot.Stance = static_cast<uint8>(Movement->GetCurrentStance());
+		if (Movement->bWantsToCrouch)
+		{
+			Snapshot.Flags |= Crouched;
+		}
+	}
+
+	return Snapshot;
+}
+
+void FTfppCharacterSnapshot::Apply(ATfppCharacter& Character) const
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppSnapshotRestore);
+
+	Character.SetActorLocationAndRotation(Location, FRotator(0.f, FRotator::DecompressAxisFromShort(ActorYaw), 0.f),
+		false, nullptr, ETeleportType::TeleportPhysics);
+	Character.AdjustedViewRotation = FRotator(FRotator::DecompressAxisFromShort(ViewPitch), FRotator::DecompressAxisFromShort(ViewYaw), 0.f);
+
+	if (AController* Controller = Character.GetController(); Controller && (Flags & HasControlRotation))
+	{
+		Controller->SetControlRotation(FRotator(FRotator::DecompressAxisFromShort(ControlPitch), FRotator::DecompressAxisFromShort(ControlYaw), 0.f));
+	}
+
+	if (UTfppCharacterMovementComponent* Movement = Character.GetTfppCharacterMovement())
+	{
+		Movement->Velocity = FVector(Velocity);
+		if (Movement->MovementMode != MovementMode || Movement->CustomMovementMode != CustomMovementMode)
+		{
+			Movement->SetMovementMode(static_cast<EMovementMode>(MovementMode), CustomMovementMode);
+		}
+		// The capsule is resized by the next movement update
+		Movement->bWantsToCrouch = (Flags & Crouched) != 0;
+		// Out of range bytes from a corrupt or foreign buffer keep the current values
+		const EMovementPaces RestoredPace = Pace < TfppTypes::NumPaces ? static_cast<EMovementPaces>(Pace) : Movement->GetCurrentPace();
+		const ECharacterStances RestoredStance = Stance < TfppTypes::NumStances ? static_cast<ECharacterStances>(Stance) : Movement->GetCurrentStance();
+		Movement->RestoreTfppState(RestoredPace, RestoredStance);
+	}
+}
+
+namespace TfppSnapshot
+{
+	void SaveCharacters(TConstArrayView<const ATfppCharacter*> Characters, TArray<uint8>& OutData)
+	{
+		OutData.Reset(SnapshotHeaderSize + Characters.Num() * FTfppCharacterSnapshot::SerializedSize);
+		FMemoryWriter Writer(OutData);
+
+		uint8 Version = SnapshotVersion;
+		int32 NumSnapshots = Characters.Num();
+		Writer << Version << NumSnapshots;
+
+		for (const ATfppCharacter* Character : Characters)
+		{
+			FTfppCharacterSnapshot Snapshot = Character ? FTfppCharacterSnapshot::Capture(*Character) : FTfppCharacterSnapshot();
+			Writer << Snapshot;
+		}
+	}
+
+	bool RestoreCharacters(TConstArrayView<ATfppCharacter*> Characters, TConstArrayView<uint8> Data)
+	{
+		if (Data.Num() < SnapshotHeaderSize)
+		{
+			return false;
+		}
+
+		FMemoryReaderView Reader(Data);
+
+		uint8 Version = 0;
+		int32 NumSnapshots = 0;
+		Reader << Version << NumSnapshots;
+		if (Version != SnapshotVersion || NumSnapshots != Characters.Num()
+			|| Data.Num() != SnapshotHeaderSize + NumSnapshots * FTfppCharacterSnapshot::SerializedSize)
+		{
+			return false;
+		}
+
+		for (ATfppCharacter* Character : Characters)
+		{
+			FTfppCharacterSnapshot Snapshot;
+			Reader << Snapshot;
+			if (Character)
+			{
+				Snapshot.Apply(*Character);
+			}
+		}
+		return true;
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice SnapshotBenchCommand(
+		TEXT("Tfpp.SnapshotBench"),
+		TEXT("Saves every TFPP pawn of the world into a snapshot and restores it, reporting the size and the time per pawn."),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+			[](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+			{
+				TArray<ATfppCharacter*> Characters;
+				for (TActorIterator<ATfppCharacter> It(World); It; ++It)
+				{
+					Characters.Add(*It);
+				}
+				if (Characters.Num() == 0)
+				{
+					Ar.Logf(TEXT("No TFPP pawn to snapshot."));
+					return;
+				}
+
+				TArray<uint8> Data;
+				const double SaveStart = FPlatformTime::Seconds();
+				SaveCharacters(TConstArrayView<const ATfppCharacter*>(Characters.GetData(), Characters.Num()), Data);
+				const double RestoreStart = FPlatformTime::Seconds();
+				const bool bRestored = RestoreCharacters(Characters, Data);
+				const double End = FPlatformTime::Seconds();
+
+				Ar.Logf(TEXT("%d pawns, %d bytes (%d per pawn). Save %.2f us per pawn, restore %.2f us per pawn%s."),
+					Characters.Num(), Data.Num(), FTfppCharacterSnapshot::SerializedSize,
+					(RestoreStart - SaveStart) * 1e6 / Characters.Num(), (End - RestoreStart) * 1e6 / Characters.Num(),
+					bRestored ? TEXT("") : TEXT(", restore FAILED"));
+			}));
+}
@@ -0,0 +1,372 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppSoak.h"
+#include "TfppCharacter.h"
+#include "TfppCharacterMovementComponent.h"
+#include "TfppLog.h"
+#include "TfppStats.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/OutputDevice.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+UTfppSoakBotComponent::UTfppSoakBotComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	SetIsReplicatedByDefault(true);
+}
+
+void UTfppSoakBotComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	int32 Seed = 0;
+	const ATfppCharacter* Character = GetOwner<ATfppCharacter>();
+	if (GetNetMode() != NM_Client || !Character || !FParse::Value(FCommandLine::Get(), TEXT("TfppSoakBot="), Seed))
+	{
+		return;
+	}
+
+	bIsBot = true;
+	Stream.Initialize(Seed);
+
+	const UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement();
+	Movement->PaceMaxSpeed.GetKeys(Paces);
+	Movement->StanceSpeedMultiplier.GetKeys(Stances);
+	Stances.AddUnique(Movement->StandingStance);
+	Stances.AddUnique(Movement->CrouchingStance);
+	Paces.Sort();
+	Stances.Sort();
+
+	SetComponentTickEnabled(true);
+	DEV_LOG_ARGS(Log, "%s is a soak bot with seed %d.", *Character->GetName(), Seed);
+}
+
+void UTfppSoakBotComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppSoakBots);
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// The character may be replicated before the client knows it possesses it
+	ATfppCharacter* Character = GetOwner<ATfppCharacter>();
+	AController* Controller = Character ? Character->GetController() : nullptr;
+	if (!bIsBot || !Controller || !Character->IsLocallyControlled())
+	{
+		return;
+	}
+
+	DecisionTime += DeltaTime;
+	while (DecisionTime >= DecisionInterval)
+	{
+		DecisionTime -= DecisionInterval;
+		Decide(Character);
+	}
+
+	FRotator ControlRotation = Controller->GetControlRotation();
+	ControlRotation.Yaw += TurnRate * DeltaTime;
+	Controller->SetControlRotation(ControlRotation);
+
+	if (!bIdle)
+	{
+		Character->AddMovementInput(FRotator(0.f, ControlRotation.Yaw + MoveAngle, 0.f).Vector());
+	}
+}
+
+void UTfppSoakBotComponent::Decide(ATfppCharacter* Character)
+{
+	const UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement();
+	const EMovementPaces OldPace = Character->GetCurrentPace();
+	const ECharacterStances OldStance = Character->GetCurrentStance();
+
+	// One roll per decision, so the stream is drawn the same way whatever the character ends up doing
+	const float Roll = Stream.FRand();
+	if (Roll < 0.04f && !Paces.IsEmpty())
+	{
+		Character->SetPace(Paces[Stream.RandHelper(Paces.Num())]);
+	}
+	else if (Roll < 0.07f)
+	{
+		Character->SetStance(OldStance == Movement->CrouchingStance ? Movement->StandingStance : Movement->CrouchingStance);
+	}
+	else if (Roll < 0.08f)
+	{
+		Character->SetStance(Stances[Stream.RandHelper(Stances.Num())]);
+	}
+	else if (Roll < 0.13f)
+	{
+		// Half of the moves stay within the forward cone sprinting is usually allowed in
+		MoveAngle = Stream.FRand() < 0.5f ? Stream.FRandRange(-45.f, 45.f) : Stream.FRandRange(-180.f, 180.f);
+	}
+	else if (Roll < 0.16f)
+	{
+		TurnRate = Stream.FRandRange(-90.f, 90.f);
+	}
+	else if (Roll < 0.18f)
+	{
+		bIdle = !bIdle;
+	}
+
+	// Send what the character ended up in, the transition rules may have refused the change
+	if (Character->GetCurrentPace() != OldPace || Character->GetCurrentStance() != OldStance)
+	{
+		ServerSetPaceAndStance(Character->GetCurrentPace(), Character->GetCurrentStance());
+	}
+}
+
+void UTfppSoakBotComponent::ServerSetPaceAndStance_Implementation(EMovementPaces NewPace, ECharacterStances NewStance)
+{
+	// The stance goes first, it decides which paces are allowed
+	if (ATfppCharacter* Character = GetOwner<ATfppCharacter>())
+	{
+		Character->SetStance(NewStance);
+		Character->SetPace(NewPace);
+
+		// The bot changed before its moves told the server, the corrections that follow come from the harness
+		Character->GetTfppCharacterMovement()->MarkOutOfBandStateChange();
+	}
+}
+
+bool UTfppSoakSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return Super::ShouldCreateSubsystem(Outer) && FParse::Param(FCommandLine::Get(), TEXT("TfppSoak"));
+}
+
+void UTfppSoakSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("TfppSoakBots="), NumBots);
+	FParse::Value(CommandLine, TEXT("TfppSoakWarmup="), Warmup);
+	FParse::Value(CommandLine, TEXT("TfppSoakDuration="), Duration);
+	bExitWhenDone = FParse::Param(CommandLine, TEXT("TfppSoakExit"));
+	if (!FParse::Value(CommandLine, TEXT("TfppSoakReport="), ReportPath))
+	{
+		ReportPath = FPaths::ProfilingDir() / TEXT("TfppSoak.csv");
+	}
+
+	NumBots = FMath::Max(NumBots, 1);
+	Warmup = FMath::Max(Warmup, 0.f);
+	Duration = FMath::Max(Duration, 1.f);
+}
+
+void UTfppSoakSubsystem::Tick(float DeltaTime)
+{
+	const UWorld* World = GetWorld();
+	const UNetDriver* NetDriver = World->GetNetDriver();
+	if (Phase == EPhase::Done || !NetDriver || World->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	AddBots();
+	PhaseTime += DeltaTime;
+
+	switch (Phase)
+	{
+	case EPhase::WaitingForBots:
+		if (NetDriver->ClientConnections.Num() >= NumBots)
+		{
+			DEV_LOG_ARGS(Log, "%d bots connected, warming up for %.0f s.", NetDriver->ClientConnections.Num(), Warmup);
+			Phase = EPhase::Warmup;
+			PhaseTime = 0.0;
+		}
+		break;
+
+	case EPhase::Warmup:
+		if (PhaseTime >= Warmup)
+		{
+			StartMeasuring();
+		}
+		break;
+
+	case EPhase::Measuring:
+		// The idle time is what the frame waited for the tick rate, it isn't spent by the game
+		FrameMs.Add(static_cast<float>((FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0));
+		if (PhaseTime >= NextConnectionSample)
+		{
+			SampleConnections();
+			NextConnectionSample += 1.0;
+		}
+		if (PhaseTime >= Duration)
+		{
+			FinishMeasuring();
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UTfppSoakSubsystem::AddBots()
+{
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		ATfppCharacter* Character = PlayerController ? Cast<ATfppCharacter>(PlayerController->GetPawn()) : nullptr;
+		if (Character && !PlayerController->IsLocalController() && !Character->FindComponentByClass<UTfppSoakBotComponent>())
+		{
+			UTfppSoakBotComponent* Bot = NewObject<UTfppSoakBotComponent>(Character);
+			Bot->RegisterComponent();
+			Character->AddInstanceComponent(Bot);
+		}
+	}
+}
+
+UTfppSoakSubsystem::FCorrections UTfppSoakSubsystem::CountCorrections() const
+{
+	FCorrections Corrections;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		const ATfppCharacter* Character = PlayerController ? Cast<ATfppCharacter>(PlayerController->GetPawn()) : nullptr;
+		if (Character && !PlayerController->IsLocalController())
+		{
+			const UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement();
+			const FCorrections Start = StartCorrections.FindRef(Movement);
+			Corrections.Total += Movement->GetNumServerCorrections() - Start.Total;
+			Corrections.OutOfBand += Movement->GetNumOutOfBandCorrections() - Start.OutOfBand;
+		}
+	}
+	return Corrections;
+}
+
+void UTfppSoakSubsystem::SampleConnections()
+{
+	for (const UNetConnection* Connection : GetWorld()->GetNetDriver()->ClientConnections)
+	{
+		if (Connection && Connection->GetConnectionState() == USOCK_Open)
+		{
+			InBytesPerSecond += Connection->InBytesPerSecond;
+			OutBytesPerSecond += Connection->OutBytesPerSecond;
+			MaxOutBytesPerSecond = FMath::Max(MaxOutBytesPerSecond, Connection->OutBytesPerSecond);
+			++NumConnectionSamples;
+		}
+	}
+}
+
+void UTfppSoakSubsystem::StartMeasuring()
+{
+	Phase = EPhase::Measuring;
+	PhaseTime = 0.0;
+	// The per second traffic of the connections is only up to date once a full second went by
+	NextConnectionSample = 1.0;
+	NumMeasuredBots = GetWorld()->GetNetDriver()->ClientConnections.Num();
+
+	StartCorrections.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (const ATfppCharacter* Character = PlayerController ? Cast<ATfppCharacter>(PlayerController->GetPawn()) : nullptr)
+		{
+			const UTfppCharacterMovementComponent* Movement = Character->GetTfppCharacterMovement();
+			StartCorrections.Add(Movement, { Movement->GetNumServerCorrections(), Movement->GetNumOutOfBandCorrections() });
+		}
+	}
+
+	DEV_LOG_ARGS(Log, "Measuring %d bots for %.0f s.", NumMeasuredBots, Duration);
+}
+
+void UTfppSoakSubsystem::FinishMeasuring()
+{
+	Phase = EPhase::Done;
+	const FCorrections Corrections = CountCorrections();
+	NumCorrections = Corrections.Total - Corrections.OutOfBand;
+	NumOutOfBandCorrections = Corrections.OutOfBand;
+
+	const FString Line = GetReportLine();
+	// Logged outside of the editor too, the results are what the soak is run for
+	UE_LOG(TfppLog, Display, TEXT("Soak: %s"), *GetReportHeader());
+	UE_LOG(TfppLog, Display, TEXT("Soak: %s"), *Line);
+
+	// One line per run, the header only goes at the top of a new report
+	const FString Report = IFileManager::Get().FileExists(*ReportPath) ? Line + LINE_TERMINATOR : GetReportHeader() + LINE_TERMINATOR + Line + LINE_TERMINATOR;
+	if (!FFileHelper::SaveStringToFile(Report, *ReportPath, FFileHelper::EEncodingOptions::ForceAnsi, &IFileManager::Get(), FILEWRITE_Append))
+	{
+		DEV_LOG_ARGS(Error, "Could not write the report to %s.", *ReportPath);
+	}
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false, TEXT("TfppSoak"));
+	}
+}
+
+FString UTfppSoakSubsystem::GetReportHeader() const
+{
+	return TEXT("Date,Map,Bots,Seconds,Frames,TickAvgMs,TickP50Ms,TickP95Ms,TickP99Ms,TickMaxMs,InBytesPerSecond,OutBytesPerSecond,MaxOutBytesPerSecond,Corrections,CorrectionsPerBotMinute,")
+		TEXT("OutOfBandCorrections,OutOfBandCorrectionsPerBotMinute");
+}
+
+FString UTfppSoakSubsystem::GetReportLine() const
+{
+	TArray<float> SortedMs = FrameMs;
+	SortedMs.Sort();
+	auto Percentile = [&SortedMs](float Ratio)
+	{
+		return SortedMs.IsEmpty() ? 0.f : SortedMs[FMath::Clamp(FMath::CeilToInt32(Ratio * SortedMs.Num()) - 1, 0, SortedMs.Num() - 1)];
+	};
+
+	double TotalMs = 0.0;
+	for (const float Ms : SortedMs)
+	{
+		TotalMs += Ms;
+	}
+
+	const float Minutes = static_cast<float>(FMath::Min(PhaseTime, static_cast<double>(Duration)) / 60.0);
+	const int32 Samples = FMath::Max(NumConnectionSamples, 1);
+	const float BotMinutes = NumMeasuredBots * Minutes;
+	return FString::Printf(TEXT("%s,%s,%d,%.0f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%lld,%lld,%d,%d,%.2f,%d,%.2f"),
+		*FDateTime::Now().ToString(), *GetWorld()->GetMapName(), NumMeasuredBots, Minutes * 60.f, SortedMs.Num(),
+		SortedMs.IsEmpty() ? 0.0 : TotalMs / SortedMs.Num(), Percentile(0.5f), Percentile(0.95f), Percentile(0.99f), Percentile(1.f),
+		InBytesPerSecond / Samples, OutBytesPerSecond / Samples, MaxOutBytesPerSecond,
+		NumCorrections, BotMinutes > 0.f ? NumCorrections / BotMinutes : 0.f,
+		NumOutOfBandCorrections, BotMinutes > 0.f ? NumOutOfBandCorrections / BotMinutes : 0.f);
+}
+
+void UTfppSoakSubsystem::DumpState(FOutputDevice& Ar) const
+{
+	static const TCHAR* PhaseNames[] = { TEXT("Waiting for bots"), TEXT("Warmup"), TEXT("Measuring"), TEXT("Done") };
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	Ar.Logf(TEXT("%s for %.1f s, %d of %d bots connected."), PhaseNames[static_cast<uint8>(Phase)], PhaseTime,
+		NetDriver ? NetDriver->ClientConnections.Num() : 0, NumBots);
+
+	if (Phase == EPhase::Measuring || Phase == EPhase::Done)
+	{
+		Ar.Logf(TEXT("%s"), *GetReportHeader());
+		Ar.Logf(TEXT("%s"), *GetReportLine());
+	}
+}
+
+TStatId UTfppSoakSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTfppSoakSubsystem, STATGROUP_Tickables);
+}
+
+bool UTfppSoakSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice TfppSoakCommand(
+	TEXT("Tfpp.Soak"),
+	TEXT("Shows the phase of the soak run started with -TfppSoak and the results measured so far."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+		{
+			if (const UTfppSoakSubsystem* Subsystem = World ? World->GetSubsystem<UTfppSoakSubsystem>() : nullptr)
+			{
+				Subsystem->DumpState(Ar);
+			}
+		}));
@@ -0,0 +1,136 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppSpeedValidation.h"
+#include "TfppCharacter.h"
+#include "TfppCharacterMovementComponent.h"
+#include "TfppDevSettings.h"
+#include "TfppLog.h"
+#include "TfppStats.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+
+void UTfppSpeedValidationSubsystem::RegisterMovement(UTfppCharacterMovementComponent* Movement)
+{
+	if (Movements.ContainsByPredicate([Movement](const FValidatedMovement& Validated) { return Validated.Movement == Movement; }))
+	{
+		return;
+	}
+
+	FValidatedMovement& Validated = Movements.AddDefaulted_GetRef();
+	Validated.Movement = Movement;
+	Movement->SpeedAccumulator.Reset();
+	Movement->LastValidatedLocation = Movement->UpdatedComponent ? Movement->UpdatedComponent->GetComponentLocation() : FVector::ZeroVector;
+	Movement->bValidatingSpeed = true;
+}
+
+void UTfppSpeedValidationSubsystem::UnregisterMovement(UTfppCharacterMovementComponent* Movement)
+{
+	Movements.RemoveAllSwap([Movement](const FValidatedMovement& Validated) { return Validated.Movement == Movement; });
+	Movement->bValidatingSpeed = false;
+}
+
+void UTfppSpeedValidationSubsystem::Tick(float DeltaTime)
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppSpeedValidation);
+
+	Movements.RemoveAllSwap([](const FValidatedMovement& Validated) { return !Validated.Movement.IsValid(); });
+	if (Movements.IsEmpty())
+	{
+		return;
+	}
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	// Spread the checks so every character is checked once per interval
+	const float Interval = FMath::Max(UTfppDevSettings::Get()->SpeedValidationInterval, 0.1f);
+	PendingChecks = FMath::Min(PendingChecks + Movements.Num() * DeltaTime / Interval, static_cast<float>(Movements.Num()));
+	const int32 NumChecks = FMath::FloorToInt32(PendingChecks);
+	PendingChecks -= NumChecks;
+
+	for (int32 Check = 0; Check < NumChecks; ++Check)
+	{
+		if (NextMovement >= Movements.Num())
+		{
+			NextMovement = 0;
+		}
+		Validate(Movements[NextMovement++]);
+	}
+
+	const double Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+	CheckSeconds += Seconds;
+	ValidatedSeconds += static_cast<double>(DeltaTime) * Movements.Num();
+	SET_FLOAT_STAT(STAT_TfppSpeedValidationUs, Seconds * 1e6 / Movements.Num());
+}
+
+void UTfppSpeedValidationSubsystem::Validate(FValidatedMovement& Validated)
+{
+	UTfppCharacterMovementComponent* Movement = Validated.Movement.Get();
+	ATfppCharacter* Character = Cast<ATfppCharacter>(Movement->GetCharacterOwner());
+	FTfppSpeedAccumulator& Accumulator = Movement->SpeedAccumulator;
+	const UTfppDevSettings* Settings = UTfppDevSettings::Get();
+
+	// Too little ground movement to judge, keep accumulating
+	if (Accumulator.Time < Settings->SpeedValidationInterval * 0.5f || !Character)
+	{
+		return;
+	}
+
+	++Validated.NumChecks;
+	Validated.LastRatio = Accumulator.Distance / FMath::Max(Accumulator.AllowedDistance, UE_KINDA_SMALL_NUMBER);
+	Accumulator.Reset();
+
+	if (Validated.LastRatio <= Settings->SpeedTolerance)
+	{
+		Movement->LastValidatedLocation = Movement->UpdatedComponent->GetComponentLocation();
+		return;
+	}
+
+	++Validated.NumViolations;
+	INC_DWORD_STAT(STAT_TfppSpeedViolations);
+	DEV_LOG_ARGS(Warning, "%s moved %.2f times faster than its paces allow.", *Character->GetName(), Validated.LastRatio);
+
+	if (Settings->SpeedViolationAction == ETfppSpeedViolationAction::Correct)
+	{
+		Movement->RevertToValidatedLocation();
+	}
+	OnSpeedViolation.Broadcast(Character, Validated.LastRatio);
+}
+
+void UTfppSpeedValidationSubsystem::DumpState(FOutputDevice& Ar) const
+{
+	int32 NumViolations = 0;
+	for (const FValidatedMovement& Validated : Movements)
+	{
+		if (const UTfppCharacterMovementComponent* Movement = Validated.Movement.Get())
+		{
+			Ar.Logf(TEXT("  %s: %d checks, %d violations, last ratio %.2f"), *GetNameSafe(Movement->GetCharacterOwner()),
+				Validated.NumChecks, Validated.NumViolations, Validated.LastRatio);
+			NumViolations += Validated.NumViolations;
+		}
+	}
+	Ar.Logf(TEXT("%d validated characters, %d violations, %.3f us of checks per connection and second."), Movements.Num(),
+		NumViolations, ValidatedSeconds > 0.0 ? CheckSeconds * 1e6 / ValidatedSeconds : 0.0);
+}
+
+TStatId UTfppSpeedValidationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTfppSpeedValidationSubsystem, STATGROUP_Tickables);
+}
+
+bool UTfppSpeedValidationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice TfppSpeedValidationCommand(
+	TEXT("Tfpp.SpeedValidation"),
+	TEXT("Lists the characters validated by the server with their violations and the cost of the validation per connection."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+		{
+			if (const UTfppSpeedValidationSubsystem* Subsystem = World ? World->GetSubsystem<UTfppSpeedValidationSubsystem>() : nullptr)
+			{
+				Subsystem->DumpState(Ar);
+			}
+		}));
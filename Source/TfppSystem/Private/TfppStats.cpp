@@ -0,0 +1,136 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppStats.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include <atomic>
+
+DEFINE_STAT(STAT_TfppCharacterTick);
+DEFINE_STAT(STAT_TfppCalculateViewRotation);
+DEFINE_STAT(STAT_TfppGetMovingDirection);
+DEFINE_STAT(STAT_TfppSetPace);
+DEFINE_STAT(STAT_TfppSetStance);
+DEFINE_STAT(STAT_TfppMovementSetPace);
+DEFINE_STAT(STAT_TfppMovementSetStance);
+DEFINE_STAT(STAT_TfppIsPaceAllowedOnDirectionAngle);
+DEFINE_STAT(STAT_TfppPoseSearch);
+DEFINE_STAT(STAT_TfppFootPlacement);
+DEFINE_STAT(STAT_TfppCameraCollision);
+DEFINE_STAT(STAT_TfppReplicationGather);
+DEFINE_STAT(STAT_TfppHeadHistoryRecord);
+DEFINE_STAT(STAT_TfppHeadHistoryRewind);
+DEFINE_STAT(STAT_TfppHeadMotion);
+DEFINE_STAT(STAT_TfppSnapshotSave);
+DEFINE_STAT(STAT_TfppSnapshotRestore);
+DEFINE_STAT(STAT_TfppTraversalBake);
+DEFINE_STAT(STAT_TfppTraversalLookup);
+DEFINE_STAT(STAT_TfppSpeedValidation);
+DEFINE_STAT(STAT_TfppFootsteps);
+DEFINE_STAT(STAT_TfppSoakBots);
+DEFINE_STAT(STAT_TfppStanceNavBake);
+
+DEFINE_STAT(STAT_TfppActivePawns);
+DEFINE_STAT(STAT_TfppPaceTransitions);
+DEFINE_STAT(STAT_TfppStanceTransitions);
+DEFINE_STAT(STAT_TfppFootTraces);
+DEFINE_STAT(STAT_TfppSurfaceResolves);
+DEFINE_STAT(STAT_TfppSimulationSteps);
+DEFINE_STAT(STAT_TfppCameraSweeps);
+DEFINE_STAT(STAT_TfppMantles);
+DEFINE_STAT(STAT_TfppSpeedViolations);
+DEFINE_STAT(STAT_TfppServerCorrections);
+DEFINE_STAT(STAT_TfppNavStanceSwitches);
+DEFINE_STAT(STAT_TfppFootstepsEmitted);
+DEFINE_STAT(STAT_TfppFootstepsCulled);
+DEFINE_STAT(STAT_TfppFootstepsDropped);
+DEFINE_STAT(STAT_TfppAnimBundlesResident);
+DEFINE_STAT(STAT_TfppAnimBundleStalls);
+DEFINE_STAT(STAT_TfppReplicatedInView);
+DEFINE_STAT(STAT_TfppReplicatedOutOfView);
+DEFINE_STAT(STAT_TfppReplicationThrottled);
+DEFINE_STAT(STAT_TfppAnimBudgetPawns);
+DEFINE_STAT(STAT_TfppAnimBudgetThrottled);
+DEFINE_STAT(STAT_TfppAnimBudgetConfiguredMs);
+DEFINE_STAT(STAT_TfppSpeedValidationUs);
+DEFINE_STAT(STAT_TfppAnimBundleMemory);
+DEFINE_STAT(STAT_TfppHeadHistoryMemory);
+DEFINE_STAT(STAT_TfppTraversalMemory);
+
+#if TFPP_WITH_PROFILING
+
+#if CSV_PROFILER
+CSV_DEFINE_CATEGORY_MODULE(TFPPSYSTEM_API, Tfpp, true);
+#endif
+
+TRACE_DECLARE_INT_COUNTER(TfppActivePawns, TEXT("Tfpp/ActivePawns"));
+TRACE_DECLARE_INT_COUNTER(TfppTransitionsPerFrame, TEXT("Tfpp/TransitionsPerFrame"));
+
+namespace TfppStats
+{
+	// Pawns only enter and leave play on the game thread, but transitions can come from any movement update.
+	static int32 ActivePawns = 0;
+	static std::atomic<int32> PaceTransitionsThisFrame(0);
+	static std::atomic<int32> StanceTransitionsThisFrame(0);
+
+	// Footsteps are only played on the game thread.
+	static int32 FootstepsEmittedThisFrame = 0;
+	static int32 FootstepsCulledThisFrame = 0;
+	static int32 FootstepsDroppedThisFrame = 0;
+
+	void AddActivePawn()
+	{
+		check(IsInGameThread());
+		++ActivePawns;
+		INC_DWORD_STAT(STAT_TfppActivePawns);
+		TRACE_COUNTER_SET(TfppActivePawns, ActivePawns);
+	}
+
+	void RemoveActivePawn()
+	{
+		check(IsInGameThread());
+		--ActivePawns;
+		DEC_DWORD_STAT(STAT_TfppActivePawns);
+		TRACE_COUNTER_SET(TfppActivePawns, ActivePawns);
+	}
+
+	void AddPaceTransition()
+	{
+		++PaceTransitionsThisFrame;
+		INC_DWORD_STAT(STAT_TfppPaceTransitions);
+	}
+
+	void AddStanceTransition()
+	{
+		++StanceTransitionsThisFrame;
+		INC_DWORD_STAT(STAT_TfppStanceTransitions);
+	}
+
+	void AddFootstepEvents(int32 Emitted, int32 Culled, int32 Dropped)
+	{
+		check(IsInGameThread());
+		FootstepsEmittedThisFrame += Emitted;
+		FootstepsCulledThisFrame += Culled;
+		FootstepsDroppedThisFrame += Dropped;
+		INC_DWORD_STAT_BY(STAT_TfppFootstepsEmitted, Emitted);
+		INC_DWORD_STAT_BY(STAT_TfppFootstepsCulled, Culled);
+		INC_DWORD_STAT_BY(STAT_TfppFootstepsDropped, Dropped);
+	}
+
+	void FlushFrameCounters()
+	{
+		const int32 PaceTransitions = PaceTransitionsThisFrame.exchange(0);
+		const int32 StanceTransitions = StanceTransitionsThisFrame.exchange(0);
+
+		TRACE_COUNTER_SET(TfppTransitionsPerFrame, PaceTransitions + StanceTransitions);
+		CSV_CUSTOM_STAT(Tfpp, ActivePawns, ActivePawns, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(Tfpp, PaceTransitions, PaceTransitions, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(Tfpp, StanceTransitions, StanceTransitions, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(Tfpp, FootstepsEmitted, FootstepsEmittedThisFrame, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(Tfpp, FootstepsCulled, FootstepsCulledThisFrame, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(Tfpp, FootstepsDropped, FootstepsDroppedThisFrame, ECsvCustomStatOp::Set);
+		FootstepsEmittedThisFrame = 0;
+		FootstepsCulledThisFrame = 0;
+		FootstepsDroppedThisFrame = 0;
+	}
+}
+
+#endif
@@ -1,18 +1,34 @@
 ﻿// Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "TfppSystem.h"
+#include "TfppStats.h"
+#include "TfppTelemetry.h"
+#include "Misc/CoreDelegates.h"
 
 #define LOCTEXT_NAMESPACE "FTfppSystemModule"
 
 void FTfppSystemModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+#if TFPP_WITH_PROFILING
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&TfppStats::FlushFrameCounters);
+#endif
+#if TFPP_WITH_TELEMETRY
+	TelemetryHandle = FCoreDelegates::OnEndFrame.AddStatic(&TfppTelemetry::Publish);
+#endif
 }
 
 void FTfppSystemModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+#if TFPP_WITH_PROFILING
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+#endif
+#if TFPP_WITH_TELEMETRY
+	FCoreDelegates::OnEndFrame.Remove(TelemetryHandle);
+	TfppTelemetry::Shutdown();
+#endif
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,156 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppTelemetry.h"
+
+#if TFPP_WITH_TELEMETRY
+
+#include "TfppDevSettings.h"
+#include "TfppLog.h"
+#include "TfppTelemetryLayout.h"
+#include "Engine/EngineBaseTypes.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include <atomic>
+
+static_assert(TfppTelemetryNumPaces == TfppTypes::NumPaces, "The telemetry layout has to match the number of paces.");
+static_assert(TfppTelemetryNumStances == TfppTypes::NumStances, "The telemetry layout has to match the number of stances.");
+
+namespace TfppTelemetry
+{
+	// Counters can be recorded from any movement update, the region is only touched on the game thread.
+	static std::atomic<int64> ActivePawns(0);
+	static std::atomic<uint64> PacesEntered[TfppTypes::NumPaces];
+	static std::atomic<uint64> StancesEntered[TfppTypes::NumStances];
+	static std::atomic<uint64> SprintGateRejections(0);
+	static std::atomic<uint64> PitchClampHits(0);
+	static std::atomic<uint64> StanceTransitionsThisFrame(0);
+
+	static uint64 StanceTransitionsPerFrame[TfppTelemetryNumHistogramBuckets] = {};
+	static FPlatformMemory::FSharedMemoryRegion* Region = nullptr;
+	static bool bRegionFailed = false;
+
+	void AddActivePawn()
+	{
+		ActivePawns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void RemoveActivePawn()
+	{
+		ActivePawns.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void AddPaceChange(EMovementPaces NewPace)
+	{
+		PacesEntered[static_cast<uint8>(NewPace)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void AddStanceChange(ECharacterStances NewStance)
+	{
+		StancesEntered[static_cast<uint8>(NewStance)].fetch_add(1, std::memory_order_relaxed);
+		StanceTransitionsThisFrame.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void AddSprintGateRejection()
+	{
+		SprintGateRejections.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void AddPitchClampHit()
+	{
+		PitchClampHits.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	static FString GetRegionName()
+	{
+		// Every process on a machine needs its own region, the name tells them apart by process id or port
+		FString Name = UTfppDevSettings::Get()->TelemetryRegionName;
+		Name.ReplaceInline(TEXT("{Pid}"), *LexToString(FPlatformProcess::GetCurrentProcessId()));
+		if (Name.Contains(TEXT("{Port}")))
+		{
+			int32 Port = FURL::UrlConfig.DefaultPort;
+			FParse::Value(FCommandLine::Get(), TEXT("Port="), Port);
+			Name.ReplaceInline(TEXT("{Port}"), *LexToString(Port));
+		}
+		return Name;
+	}
+
+	static FTfppTelemetryRegion* OpenRegion()
+	{
+		if (!Region && !bRegionFailed)
+		{
+			const FString Name = GetRegionName();
+			Region = FPlatformMemory::MapNamedSharedMemoryRegion(*Name, true,
+				FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write, sizeof(FTfppTelemetryRegion));
+			if (!Region)
+			{
+				// Don't try again every frame
+				bRegionFailed = true;
+				DEV_LOG_ARGS(Error, "Couldn't map the telemetry region %s.", *Name);
+				return nullptr;
+			}
+
+			// Logged outside of the editor too, readers need the name to find the region of a server
+			UE_LOG(TfppLog, Display, TEXT("Publishing telemetry to %s."), *Name);
+			FTfppTelemetryRegion* Mapped = static_cast<FTfppTelemetryRegion*>(Region->GetAddress());
+			FMemory::Memzero(Mapped, sizeof(FTfppTelemetryRegion));
+			Mapped->Header.Magic = TfppTelemetryMagic;
+			Mapped->Header.Version = TfppTelemetryVersion;
+			Mapped->Header.Size = sizeof(FTfppTelemetryRegion);
+		}
+		return Region ? static_cast<FTfppTelemetryRegion*>(Region->GetAddress()) : nullptr;
+	}
+
+	void Publish()
+	{
+		check(IsInGameThread());
+
+		// The histogram is built every frame so it stays meaningful when telemetry gets enabled later on
+		const uint64 StanceTransitions = StanceTransitionsThisFrame.exchange(0, std::memory_order_relaxed);
+		++StanceTransitionsPerFrame[TfppTelemetryHistogramBucket(StanceTransitions)];
+
+		if (!UTfppDevSettings::Get()->bEnableTelemetry)
+		{
+			return;
+		}
+
+		FTfppTelemetryRegion* Mapped = OpenRegion();
+		if (!Mapped)
+		{
+			return;
+		}
+
+		FTfppTelemetryPayload Payload;
+		Payload.Frame = GFrameCounter;
+		Payload.TimeSeconds = FPlatformTime::Seconds();
+		Payload.ActivePawns = static_cast<uint64>(FMath::Max<int64>(ActivePawns.load(std::memory_order_relaxed), 0));
+		for (int32 Index = 0; Index < TfppTypes::NumPaces; ++Index)
+		{
+			Payload.PacesEntered[Index] = PacesEntered[Index].load(std::memory_order_relaxed);
+		}
+		for (int32 Index = 0; Index < TfppTypes::NumStances; ++Index)
+		{
+			Payload.StancesEntered[Index] = StancesEntered[Index].load(std::memory_order_relaxed);
+		}
+		Payload.SprintGateRejections = SprintGateRejections.load(std::memory_order_relaxed);
+		Payload.PitchClampHits = PitchClampHits.load(std::memory_order_relaxed);
+		FMemory::Memcpy(Payload.StanceTransitionsPerFrame, StanceTransitionsPerFrame, sizeof(StanceTransitionsPerFrame));
+		Payload.Checksum = TfppTelemetryChecksum(Payload);
+
+		// Single writer seqlock, readers retry while the sequence is odd or changed during their copy
+		TfppTelemetryWrite(*Mapped, Payload);
+	}
+
+	void Shutdown()
+	{
+		if (Region)
+		{
+			FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+			Region = nullptr;
+		}
+		bRegionFailed = false;
+	}
+}
+
+#endif
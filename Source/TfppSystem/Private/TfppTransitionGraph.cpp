@@ -0,0 +1,64 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+
+#include "TfppTransitionGraph.h"
+#include "TfppDevSettings.h"
+
+namespace TfppTransitionGraph
+{
+	constexpr uint16 AllStances = (1u << TfppTypes::NumStances) - 1;
+	constexpr uint16 AllPaces = (1u << TfppTypes::NumPaces) - 1;
+}
+
+FTfppTransitionTable::FTfppTransitionTable()
+{
+	Build({}, {});
+}
+
+void FTfppTransitionTable::Build(const TMap<ECharacterStances, FTfppStanceTransitionRules>& StanceRules, const TMap<EMobilities, FTfppMobilityTransitionRules>& MobilityRules)
+{
+	using namespace TfppTransitionGraph;
+
+	for (int32 Stance = 0; Stance < TfppTypes::NumStances; ++Stance)
+	{
+		StancePaces[Stance] = AllPaces;
+		// A stance can always be kept, so it is always reachable from itself
+		StanceNextStances[Stance] = AllStances;
+	}
+	for (int32 Mobility = 0; Mobility < TfppTypes::NumMobilities; ++Mobility)
+	{
+		MobilityStances[Mobility] = AllStances;
+		MobilityPaces[Mobility] = AllPaces;
+	}
+
+	for (const TPair<ECharacterStances, FTfppStanceTransitionRules>& Rule : StanceRules)
+	{
+		StancePaces[Index(Rule.Key)] = static_cast<uint16>(Rule.Value.AllowedPaces) & AllPaces;
+		StanceNextStances[Index(Rule.Key)] = (static_cast<uint16>(Rule.Value.AllowedNextStances) | StanceBit(Rule.Key)) & AllStances;
+	}
+	for (const TPair<EMobilities, FTfppMobilityTransitionRules>& Rule : MobilityRules)
+	{
+		MobilityStances[Index(Rule.Key)] = static_cast<uint16>(Rule.Value.AllowedStances) & AllStances;
+		MobilityPaces[Index(Rule.Key)] = static_cast<uint16>(Rule.Value.AllowedPaces) & AllPaces;
+	}
+}
+
+const FTfppTransitionTable& FTfppTransitionTable::Get()
+{
+	return UTfppDevSettings::Get()->GetTransitionTable();
+}
+
+bool FTfppTransitionTable::GetBestAllowedPace(EMobilities Mobility, ECharacterStances Stance, EMovementPaces RequestedPace, EMovementPaces& OutPace) const
+{
+	const uint32 Allowed = GetAllowedPaces(Mobility, Stance);
+	if (Allowed == 0)
+	{
+		return false;
+	}
+
+	// Keep the requested pace and every slower one, then take the fastest of them
+	const uint32 NotFaster = Allowed & ((2u << Index(RequestedPace)) - 1);
+	const uint32 Best = NotFaster != 0 ? FMath::FloorLog2(NotFaster) : FMath::CountTrailingZeros(Allowed);
+	OutPace = static_cast<EMovementPaces>(Best);
+	return true;
+}
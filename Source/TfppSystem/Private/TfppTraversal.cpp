@@ -0,0 +1,466 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#include "TfppTraversal.h"
+#include "TfppLog.h"
+#include "TfppStats.h"
+#include "Components/BrushComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+
+void FTfppTraversalIndex::Build(TArray<FTfppTraversalEdge>&& InEdges, float InCellSize)
+{
+	CellSize = InCellSize;
+	Edges = MoveTemp(InEdges);
+	Cells.Reset();
+
+	auto GetEdgeCell = [this](const FTfppTraversalEdge& Edge)
+	{
+		return GetCell(FVector((Edge.Start + Edge.End) * 0.5f));
+	};
+
+	// The edges of a cell are read one after the other
+	Edges.Sort([&GetEdgeCell](const FTfppTraversalEdge& A, const FTfppTraversalEdge& B)
+	{
+		const FIntVector CellA = GetEdgeCell(A);
+		const FIntVector CellB = GetEdgeCell(B);
+		if (CellA.X != CellB.X)
+		{
+			return CellA.X < CellB.X;
+		}
+		if (CellA.Y != CellB.Y)
+		{
+			return CellA.Y < CellB.Y;
+		}
+		return CellA.Z < CellB.Z;
+	});
+	Edges.Shrink();
+
+	for (int32 EdgeIndex = 0; EdgeIndex < Edges.Num(); ++EdgeIndex)
+	{
+		FTfppTraversalCell& Cell = Cells.FindOrAdd(GetEdgeCell(Edges[EdgeIndex]));
+		if (Cell.Num == 0)
+		{
+			Cell.Begin = EdgeIndex;
+		}
+		++Cell.Num;
+	}
+}
+
+bool FTfppTraversalIndex::FindEdge(const FTfppTraversalQuery& Query, FTfppTraversalHit& OutHit) const
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppTraversalLookup);
+
+	if (Edges.IsEmpty())
+	{
+		return false;
+	}
+
+	// An edge is filed under its middle and is at most a cell long, every edge in reach has its middle within this radius
+	const double Radius = Query.Reach + CellSize * 0.5;
+	const FIntVector MinCell = GetCell(Query.Location + FVector(-Radius, -Radius, Query.MinHeight));
+	const FIntVector MaxCell = GetCell(Query.Location + FVector(Radius, Radius, Query.MaxHeight));
+
+	double BestDistanceSq = FMath::Square(Query.Reach);
+	bool bFound = false;
+	for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+			{
+				const FTfppTraversalCell* Cell = Cells.Find(FIntVector(X, Y, Z));
+				if (!Cell)
+				{
+					continue;
+				}
+
+				for (int32 EdgeIndex = Cell->Begin; EdgeIndex < Cell->Begin + Cell->Num; ++EdgeIndex)
+				{
+					const FTfppTraversalEdge& Edge = Edges[EdgeIndex];
+
+					// The pawn has to move towards the ledge
+					const FVector Normal(Edge.Normal.X, Edge.Normal.Y, 0.0);
+					if (FVector::DotProduct(Query.Direction, -Normal) < Query.MinFacing)
+					{
+						continue;
+					}
+
+					const FVector Start(Edge.Start);
+					const FVector End(Edge.End);
+					const FVector Point = FMath::ClosestPointOnSegment(FVector(Query.Location.X, Query.Location.Y, (Start.Z + End.Z) * 0.5), Start, End);
+					const double Height = Point.Z - Query.Location.Z;
+					if (Height < Query.MinHeight || Height > Query.MaxHeight)
+					{
+						continue;
+					}
+
+					// And stand on the side it is climbed from
+					const FVector Offset = Query.Location - Point;
+					if (FVector::DotProduct(Offset, Normal) <= 0.0)
+					{
+						continue;
+					}
+
+					const double DistanceSq = Offset.SizeSquared2D();
+					if (DistanceSq <= BestDistanceSq)
+					{
+						BestDistanceSq = DistanceSq;
+						OutHit.Edge = Edge;
+						OutHit.Point = Point;
+						bFound = true;
+					}
+				}
+			}
+		}
+	}
+	return bFound;
+}
+
+ATfppTraversalVolume::ATfppTraversalVolume()
+{
+	// Only the bounds of the volume matter, pawns and traces go through it
+	GetBrushComponent()->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+}
+
+void ATfppTraversalVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UTfppTraversalSubsystem* Traversal = GetWorld()->GetSubsystem<UTfppTraversalSubsystem>())
+	{
+		Traversal->RegisterVolume(this);
+	}
+}
+
+void ATfppTraversalVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTfppTraversalSubsystem* Traversal = GetWorld()->GetSubsystem<UTfppTraversalSubsystem>())
+	{
+		Traversal->UnregisterVolume(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ATfppTraversalVolume::Bake()
+{
+	BakeBounds(GetComponentsBoundingBox(true));
+}
+
+void ATfppTraversalVolume::BakeBounds(const FBox& Bounds)
+{
+	TArray<FTfppTraversalEdge> Edges;
+	BakeEdges(Bounds, Edges);
+
+	Modify();
+	Index.Build(MoveTemp(Edges), CellSize);
+	BakedBounds = Bounds;
+
+	DEV_LOG_ARGS(Log, "%s baked %d traversal edges in %d cells, %llu bytes.", *GetName(), Index.GetNumEdges(),
+		Index.GetNumCells(), static_cast<uint64>(Index.GetAllocatedSize()));
+}
+
+void ATfppTraversalVolume::BakeEdges(TArray<FTfppTraversalEdge>& OutEdges) const
+{
+	BakeEdges(GetComponentsBoundingBox(true), OutEdges);
+}
+
+void ATfppTraversalVolume::BakeEdges(const FBox& Bounds, TArray<FTfppTraversalEdge>& OutEdges) const
+{
+	TFPP_SCOPE_CYCLE_COUNTER(STAT_TfppTraversalBake);
+
+	OutEdges.Reset();
+	const UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	const FVector Size = Bounds.GetSize();
+	const int32 NumX = FMath::FloorToInt32(Size.X / SampleSpacing) + 1;
+	const int32 NumY = FMath::FloorToInt32(Size.Y / SampleSpacing) + 1;
+	constexpr float NoFloor = TNumericLimits<float>::Lowest();
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(TfppTraversalBake), false, this);
+
+	auto GetSampleLocation = [&Bounds, this](int32 X, int32 Y)
+	{
+		return FVector(Bounds.Min.X + X * SampleSpacing, Bounds.Min.Y + Y * SampleSpacing, 0.0);
+	};
+
+	// Highest walkable surface under every sample
+	TArray<float> Heights;
+	Heights.Init(NoFloor, NumX * NumY);
+	for (int32 Y = 0; Y < NumY; ++Y)
+	{
+		for (int32 X = 0; X < NumX; ++X)
+		{
+			const FVector Sample = GetSampleLocation(X, Y);
+			FHitResult Hit;
+			if (World->LineTraceSingleByChannel(Hit, FVector(Sample.X, Sample.Y, Bounds.Max.Z), FVector(Sample.X, Sample.Y, Bounds.Min.Z), TraceChannel, Params)
+				&& Hit.ImpactNormal.Z >= WalkableFloorZ)
+			{
+				Heights[Y * NumX + X] = Hit.ImpactPoint.Z;
+			}
+		}
+	}
+
+	auto GetHeight = [&Heights, NumX, NumY](int32 X, int32 Y)
+	{
+		return X >= 0 && X < NumX && Y >= 0 && Y < NumY ? Heights[Y * NumX + X] : NoFloor;
+	};
+
+	struct FLedge
+	{
+		FVector Point;
+		float Height;
+		float Depth;
+		float LandingDrop;
+	};
+
+	// Whether a sample is the top of a ledge climbed from its neighbour in the Step direction
+	auto FindLedge = [&](int32 X, int32 Y, const FIntPoint& Step, FLedge& OutLedge)
+	{
+		const float Top = GetHeight(X, Y);
+		const float Floor = GetHeight(X + Step.X, Y + Step.Y);
+		if (Top == NoFloor || Floor == NoFloor)
+		{
+			return false;
+		}
+		OutLedge.Height = Top - Floor;
+		if (OutLedge.Height < MinLedgeHeight || OutLedge.Height > MaxLedgeHeight)
+		{
+			return false;
+		}
+
+		// The wall is somewhere between the two samples, a trace just under the top finds it
+		const FVector Direction(Step.X, Step.Y, 0.0);
+		const FVector TopSample = GetSampleLocation(X, Y) + FVector(0.0, 0.0, Top);
+		OutLedge.Point = TopSample + Direction * (SampleSpacing * 0.5);
+		const FVector TraceStart = TopSample + Direction * SampleSpacing - FVector(0.0, 0.0, FMath::Min(5.f, OutLedge.Height * 0.5f));
+		FHitResult Hit;
+		if (World->LineTraceSingleByChannel(Hit, TraceStart, TraceStart - Direction * SampleSpacing, TraceChannel, Params))
+		{
+			OutLedge.Point = FVector(Hit.ImpactPoint.X, Hit.ImpactPoint.Y, Top);
+		}
+
+		// Walk over the top to know whether it drops again soon enough to vault over it
+		OutLedge.Depth = 0.f;
+		OutLedge.LandingDrop = 0.f;
+		for (int32 Offset = 1; Offset * SampleSpacing <= MaxVaultDepth; ++Offset)
+		{
+			const float Beyond = GetHeight(X - Step.X * Offset, Y - Step.Y * Offset);
+			if (Beyond == NoFloor || Beyond - Top >= MinLedgeHeight)
+			{
+				break;
+			}
+			if (Top - Beyond >= MinLedgeHeight)
+			{
+				OutLedge.Depth = Offset * SampleSpacing;
+				OutLedge.LandingDrop = Top - Beyond;
+				break;
+			}
+		}
+		return true;
+	};
+
+	// Neighbouring ledge samples facing the same way are merged into edges
+	static const FIntPoint Steps[] = {FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1)};
+	const int32 MaxRunLength = FMath::Max(FMath::FloorToInt32(CellSize / SampleSpacing), 1);
+	for (const FIntPoint& Step : Steps)
+	{
+		// Ledges facing along X run along Y and the other way around
+		const bool bRunsAlongY = Step.X != 0;
+		const FVector Along = bRunsAlongY ? FVector::RightVector : FVector::ForwardVector;
+		const int32 NumLines = bRunsAlongY ? NumX : NumY;
+		const int32 LineLength = bRunsAlongY ? NumY : NumX;
+
+		for (int32 Line = 0; Line < NumLines; ++Line)
+		{
+			FTfppTraversalEdge Edge;
+			FVector RunStart = FVector::ZeroVector;
+			FVector RunEnd = FVector::ZeroVector;
+			int32 RunLength = 0;
+
+			auto FlushRun = [&]()
+			{
+				if (RunLength > 0)
+				{
+					Edge.Start = FVector3f(RunStart - Along * (SampleSpacing * 0.5));
+					Edge.End = FVector3f(RunEnd + Along * (SampleSpacing * 0.5));
+					OutEdges.Add(Edge);
+					RunLength = 0;
+				}
+			};
+
+			for (int32 Position = 0; Position < LineLength; ++Position)
+			{
+				const int32 X = bRunsAlongY ? Line : Position;
+				const int32 Y = bRunsAlongY ? Position : Line;
+				FLedge Ledge;
+				const bool bLedge = FindLedge(X, Y, Step, Ledge);
+
+				// A run ends where the ledge ends, changes height, stops being vaultable or gets longer than a cell
+				if (RunLength > 0 && (!bLedge || FMath::Abs(Ledge.Point.Z - RunEnd.Z) > MinLedgeHeight * 0.5
+					|| (Ledge.Depth > 0.f) != Edge.IsVaultable() || RunLength >= MaxRunLength))
+				{
+					FlushRun();
+				}
+				if (!bLedge)
+				{
+					continue;
+				}
+
+				if (RunLength == 0)
+				{
+					RunStart = Ledge.Point;
+					Edge.Normal = FVector2f(Step.X, Step.Y);
+					Edge.Height = Ledge.Height;
+					Edge.Depth = Ledge.Depth;
+					Edge.LandingDrop = Ledge.LandingDrop;
+				}
+				else
+				{
+					Edge.Height = FMath::Min(Edge.Height, Ledge.Height);
+					Edge.Depth = FMath::Max(Edge.Depth, Ledge.Depth);
+					Edge.LandingDrop = FMath::Min(Edge.LandingDrop, Ledge.LandingDrop);
+				}
+				RunEnd = Ledge.Point;
+				++RunLength;
+			}
+			FlushRun();
+		}
+	}
+}
+
+bool UTfppTraversalSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTfppTraversalSubsystem::RegisterVolume(ATfppTraversalVolume* Volume)
+{
+	if (Volumes.Contains(Volume))
+	{
+		return;
+	}
+
+	Volumes.Add(Volume);
+	INC_MEMORY_STAT_BY(STAT_TfppTraversalMemory, Volume->GetIndex().GetAllocatedSize());
+	if (Volume->GetIndex().GetNumEdges() == 0)
+	{
+		DEV_LOG_ARGS(Warning, "%s has no traversal edges, it needs to be baked.", *Volume->GetName());
+	}
+}
+
+void UTfppTraversalSubsystem::UnregisterVolume(ATfppTraversalVolume* Volume)
+{
+	if (Volumes.RemoveSwap(Volume) > 0)
+	{
+		DEC_MEMORY_STAT_BY(STAT_TfppTraversalMemory, Volume->GetIndex().GetAllocatedSize());
+	}
+}
+
+bool UTfppTraversalSubsystem::FindEdge(const FTfppTraversalQuery& Query, FTfppTraversalHit& OutHit) const
+{
+	double BestDistanceSq = TNumericLimits<double>::Max();
+	bool bFound = false;
+	for (const TWeakObjectPtr<ATfppTraversalVolume>& Volume : Volumes)
+	{
+		if (!Volume.IsValid() || !Volume->GetBakedBounds().ExpandBy(FVector(Query.Reach, Query.Reach, Query.MaxHeight)).IsInside(Query.Location))
+		{
+			continue;
+		}
+
+		FTfppTraversalHit Hit;
+		if (Volume->GetIndex().FindEdge(Query, Hit))
+		{
+			const double DistanceSq = FVector::DistSquared2D(Query.Location, Hit.Point);
+			if (DistanceSq < BestDistanceSq)
+			{
+				BestDistanceSq = DistanceSq;
+				OutHit = Hit;
+				bFound = true;
+			}
+		}
+	}
+	return bFound;
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice TfppTraversalBenchCommand(
+	TEXT("Tfpp.TraversalBench"),
+	TEXT("Bakes the traversal volumes of the world again and times lookups against them. Arguments: [Lookups=100000]."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+		{
+			const int32 NumLookups = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 2) : 100000;
+			if (!World)
+			{
+				return;
+			}
+
+			for (TActorIterator<ATfppTraversalVolume> It(World); It; ++It)
+			{
+				const ATfppTraversalVolume* Volume = *It;
+
+				// Baked into a separate index, the one of the volume may be in use
+				const double BakeStart = FPlatformTime::Seconds();
+				TArray<FTfppTraversalEdge> Edges;
+				Volume->BakeEdges(Edges);
+				FTfppTraversalIndex Index;
+				Index.Build(MoveTemp(Edges), Volume->CellSize);
+				const double BakeSeconds = FPlatformTime::Seconds() - BakeStart;
+
+				Ar.Logf(TEXT("%s: %d edges in %d cells, %llu bytes, baked in %.1f ms."), *Volume->GetName(), Index.GetNumEdges(),
+					Index.GetNumCells(), static_cast<uint64>(Index.GetAllocatedSize()), BakeSeconds * 1000.0);
+				if (Index.GetNumEdges() == 0)
+				{
+					continue;
+				}
+
+				// Half the lookups stand in front of a ledge, the other half anywhere in the volume
+				FRandomStream Random(NumLookups);
+				const FBox Bounds = Volume->GetComponentsBoundingBox(true);
+				TArray<FTfppTraversalQuery> Queries;
+				Queries.SetNum(NumLookups);
+				for (int32 Lookup = 0; Lookup < NumLookups; ++Lookup)
+				{
+					FTfppTraversalQuery& Query = Queries[Lookup];
+					Query.Reach = 100.f;
+					Query.MinHeight = Volume->MinLedgeHeight;
+					Query.MaxHeight = Volume->MaxLedgeHeight;
+					Query.MinFacing = FMath::Cos(FMath::DegreesToRadians(45.f));
+
+					if (Lookup % 2 == 0)
+					{
+						const FTfppTraversalEdge& Edge = Index.GetEdges()[Random.RandHelper(Index.GetNumEdges())];
+						const FVector Normal(Edge.Normal.X, Edge.Normal.Y, 0.0);
+						const FVector Point = FMath::Lerp(FVector(Edge.Start), FVector(Edge.End), Random.FRand());
+						Query.Location = Point + Normal * 50.0 - FVector(0.0, 0.0, Edge.Height);
+						Query.Direction = -Normal;
+					}
+					else
+					{
+						Query.Location = FVector(Random.FRandRange(Bounds.Min.X, Bounds.Max.X), Random.FRandRange(Bounds.Min.Y, Bounds.Max.Y),
+							Random.FRandRange(Bounds.Min.Z, Bounds.Max.Z));
+						Query.Direction = Random.GetUnitVector().GetSafeNormal2D(UE_SMALL_NUMBER, FVector::ForwardVector);
+					}
+				}
+
+				int32 NumHits[2] = {0, 0};
+				FTfppTraversalHit Hit;
+				const double LookupStart = FPlatformTime::Seconds();
+				for (int32 Lookup = 0; Lookup < NumLookups; ++Lookup)
+				{
+					NumHits[Lookup % 2] += Index.FindEdge(Queries[Lookup], Hit) ? 1 : 0;
+				}
+				const double LookupSeconds = FPlatformTime::Seconds() - LookupStart;
+
+				Ar.Logf(TEXT("%d lookups in %.3f ms, %.1f ns each. %d of %d in front of a ledge and %d of %d anywhere found an edge."),
+					NumLookups, LookupSeconds * 1000.0, LookupSeconds * 1e9 / NumLookups,
+					NumHits[0], (NumLookups + 1) / 2, NumHits[1], NumLookups / 2);
+			}
+		}));
@@ -0,0 +1,31 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "TfppAIController.generated.h"
+
+/**
+ * AI controller for TFPP pawns, aware of the stance navigation areas.
+ *
+ * Paths are found with the query filter of the stances the pawn can take, so they stay out of the spaces none of
+ * them fits, and are followed by UTfppPathFollowingComponent, which switches stance at the area boundaries. Move
+ * requests with a filter class of their own keep it.
+ */
+UCLASS(ClassGroup=("True First Person Perspective | Controller"))
+class TFPPSYSTEM_API ATfppAIController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ATfppAIController(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual bool BuildPathfindingQuery(const FAIMoveRequest& MoveRequest, FPathFindingQuery& OutQuery) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+};
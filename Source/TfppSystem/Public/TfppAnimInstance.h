@@ -4,9 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "TfppFootPlacementComponent.h"
 #include "TfppAnimInstance.generated.h"
 
 class ATfppCharacter;
+class UAnimSequence;
+class UTfppAnimationSetDatabase;
+class UTfppLocomotionDatabase;
 
 /**
  * 
@@ -17,5 +21,67 @@ class TFPPSYSTEM_API UTfppAnimInstance : public UAnimInstance
 	GENERATED_BODY()
 
 public:
-	
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void NativeInitializeAnimation() override;
+	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
+	virtual void NativeUninitializeAnimation() override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/**
+	 * Pose database searched with the character's pace, stance and trajectory.
+	 * Leave empty to drive locomotion with a regular state machine instead.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Locomotion")
+	TObjectPtr<UTfppLocomotionDatabase> LocomotionDatabase;
+
+	/**
+	 * Per stance and per pace animations of this layer. Their bundles are streamed in when the stance or pace
+	 * becomes reachable and streamed out after a cooldown, see UTfppAnimationStreamingSubsystem.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Animation")
+	TObjectPtr<UTfppAnimationSetDatabase> AnimationSets;
+
+	/** Time between two searches of the locomotion database. The matched clip keeps playing in between. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Locomotion", meta = (ClampMin = "0.0"))
+	float LocomotionSearchInterval = 0.1f;
+
+	/** A new match in the clip being played is ignored unless it's further than this from the current time. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Locomotion", meta = (ClampMin = "0.0"))
+	float LocomotionSameClipTolerance = 0.2f;
+
+protected:
+	/**
+	 * True when the owning character runs the dedicated server profile, unless it records its head pose for lag
+	 * compensation with a UTfppHeadHistoryComponent.
+	 * Head and camera logic in the animation blueprint should be skipped while this is set, since nobody
+	 * looks through the camera on a dedicated server.
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|Server")
+	bool bSkipCosmeticUpdates = false;
+
+	// Clip selected by the locomotion database, meant to feed a sequence evaluator.
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|Locomotion")
+	TObjectPtr<UAnimSequence> LocomotionClip;
+
+	// Time in LocomotionClip to evaluate.
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|Locomotion")
+	float LocomotionClipTime = 0.f;
+
+	// Ground under each foot, copied from the owner's UTfppFootPlacementComponent if it has one.
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|FootPlacement")
+	TArray<FTfppFootPlacement> FootPlacements;
+
+private:
+	/** Searches the locomotion database and updates LocomotionClip and LocomotionClipTime. */
+	void UpdateLocomotionMatch(const ATfppCharacter& Character, float DeltaSeconds);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTfppFootPlacementComponent> FootPlacementComponent;
+
+	// Time left before the next locomotion search.
+	float LocomotionSearchCountdown = 0.f;
 };
@@ -0,0 +1,64 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TfppAnimationBudget.generated.h"
+
+class ATfppCharacter;
+class USkeletalMeshComponentBudgeted;
+
+/**
+ * Puts the meshes of TFPP characters under the animation budget allocator.
+ *
+ * TFPP characters use a budgeted skeletal mesh. When the animation budget is enabled in the TFPP settings, their
+ * meshes are registered with the allocator, which keeps the cost of animation under the configured budget by
+ * lowering the tick rate of the least significant meshes, interpolating them and finally skipping their evaluation.
+ * Significance goes down with the distance to the closest player view point.
+ *
+ * The mesh of a locally controlled character is never registered, the player looks through it. Possession changes
+ * are picked up on the next tick. Nothing is registered on dedicated servers, nor the meshes of pawns recording their
+ * head for lag compensation.
+ *
+ * Registered and throttled meshes and the configured budget are reported under stat Tfpp, the time the allocator
+ * actually spends under stat AnimationBudgetAllocator.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppAnimationBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	void RegisterCharacter(ATfppCharacter* Character);
+	void UnregisterCharacter(ATfppCharacter* Character);
+
+private:
+	struct FBudgetedCharacter
+	{
+		TWeakObjectPtr<ATfppCharacter> Character;
+		TWeakObjectPtr<USkeletalMeshComponentBudgeted> Mesh;
+		// Whether the mesh is currently registered with the allocator.
+		bool bRegistered = false;
+	};
+
+	/** Registers or unregisters a mesh with the allocator, returning whether it is registered now. */
+	bool SetRegistered(FBudgetedCharacter& Budgeted, bool bRegister) const;
+
+	TArray<FBudgetedCharacter> Characters;
+
+	// View points of every player, refreshed every tick.
+	TArray<FVector> ViewLocations;
+};
@@ -0,0 +1,134 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TfppTypes.h"
+#include "TfppAnimationSets.generated.h"
+
+class UAnimationAsset;
+class UTfppAnimInstance;
+
+/**
+ * Animations used by the TFPP anim layer for a single stance or pace.
+ */
+USTRUCT(BlueprintType)
+struct FTfppAnimationSet
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "TFPP|Animation")
+	TArray<TSoftObjectPtr<UAnimationAsset>> Animations;
+};
+
+/**
+ * Per stance and per pace animation sets, referenced softly and grouped into asset bundles.
+ *
+ * Every stance and every pace gets its own bundle, so a game with ten stances only keeps the ones a character can
+ * actually reach resident. Loading and unloading is driven by UTfppAnimationStreamingSubsystem.
+ * The primary asset type of this class has to be registered in the Asset Manager settings for the bundles to load.
+ */
+UCLASS(BlueprintType, ClassGroup=("True First Person Perspective | Animation"))
+class TFPPSYSTEM_API UTfppAnimationSetDatabase : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Animation")
+	TMap<ECharacterStances, FTfppAnimationSet> StanceAnimations;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Animation")
+	TMap<EMovementPaces, FTfppAnimationSet> PaceAnimations;
+
+	static FName GetStanceBundleName(ECharacterStances Stance);
+	static FName GetPaceBundleName(EMovementPaces Pace);
+
+	/**
+	 * Finds the animation set stored in a bundle.
+	 *
+	 * @param BundleName Name returned by GetStanceBundleName or GetPaceBundleName.
+	 * @return The set, or nullptr if this database has nothing for that bundle.
+	 */
+	const FTfppAnimationSet* FindAnimationSet(FName BundleName) const;
+
+#if WITH_EDITORONLY_DATA
+	virtual void UpdateAssetBundleData() override;
+#endif
+};
+
+/**
+ * Streams the animation bundles of every TFPP anim instance in the world.
+ *
+ * The bundles of the current stance and pace, of every stance reachable from the current one and of every pace
+ * allowed in it are kept loaded. Bundles nobody needs are unloaded once the cooldown from the TFPP settings
+ * has elapsed. Entering a stance or pace whose bundle was requested ahead of time but is still loading counts as
+ * a load stall, the first load of the bundles a character spawns with doesn't.
+ *
+ * Resident memory and stalls are reported under stat Tfpp and by the Tfpp.AnimBundles console command.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppAnimationStreamingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	void RegisterAnimInstance(UTfppAnimInstance* AnimInstance);
+	void UnregisterAnimInstance(UTfppAnimInstance* AnimInstance);
+
+	/** Writes the state of every bundle, the resident memory and the stalls to the output device. */
+	void DumpState(FOutputDevice& Ar) const;
+
+private:
+	struct FBundleState
+	{
+		double LastNeededTime = 0.0;
+		double RequestTime = 0.0;
+		int64 ResidentBytes = 0;
+		bool bRequested = false;
+		// Set when the bundle was requested before its stance or pace was entered.
+		bool bRequestedAhead = false;
+		bool bLoaded = false;
+		// When the current stance or pace started waiting on this bundle, negative when nothing is waiting.
+		double StallStartTime = -1.0;
+	};
+
+	struct FDatabaseState
+	{
+		FPrimaryAssetId AssetId;
+		TWeakObjectPtr<const UTfppAnimationSetDatabase> Database;
+		TMap<FName, FBundleState> Bundles;
+	};
+
+	/**
+	 * Marks a bundle as needed right now, requesting it if it isn't loaded.
+	 *
+	 * @param bInUse True if the bundle belongs to the current stance or pace, in which case waiting on it is a stall.
+	 */
+	void NeedBundle(FDatabaseState& State, FName BundleName, bool bInUse, double Now);
+
+	void ReleaseBundle(const FDatabaseState& State, FName BundleName, FBundleState& Bundle);
+	void OnBundleLoaded(FPrimaryAssetId AssetId, FName BundleName);
+
+	TArray<TWeakObjectPtr<UTfppAnimInstance>> AnimInstances;
+	TMap<FPrimaryAssetId, FDatabaseState> Databases;
+
+	// Time left before the next update of the needed bundles.
+	float UpdateCountdown = 0.f;
+
+	int64 ResidentBytes = 0;
+	int64 PeakResidentBytes = 0;
+	int32 NumStalls = 0;
+	double LongestStallSeconds = 0.0;
+};
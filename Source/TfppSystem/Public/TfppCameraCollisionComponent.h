@@ -0,0 +1,100 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "TfppCameraCollisionComponent.generated.h"
+
+class UCameraComponent;
+
+/**
+ * Keeps the head mounted TFPP camera out of walls.
+ *
+ * Every frame a small sphere is swept from a stable neck point to where the camera would be on the head. When it
+ * hits, the camera is pulled back along that segment and NearGeometryAlpha rises so the game can fade out whatever
+ * is too close to the lens.
+ *
+ * The sweep is skipped while the neck and the head move less than HeadMotionThreshold, reusing the last result.
+ * With bUseAsyncSweep the sweep runs as an async trace and its result is applied on the next frame.
+ * Only locally controlled pawns are processed, nobody else looks through their camera.
+ */
+UCLASS(ClassGroup=("True First Person Perspective | Components"), meta=(BlueprintSpawnableComponent))
+class TFPPSYSTEM_API UTfppCameraCollisionComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTfppCameraCollisionComponent();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Bone or socket of the character mesh the sweep starts from. It should move much less than the head. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|CameraCollision")
+	FName NeckSocketName = TEXT("neck_01");
+
+	/** Radius of the swept sphere, roughly the distance from the camera to its near clip plane. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|CameraCollision", meta = (ClampMin = "0.0"))
+	float ProbeRadius = 8.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|CameraCollision")
+	TEnumAsByte<ECollisionChannel> ProbeChannel = ECC_Camera;
+
+	/** The last sweep is reused while the neck and the camera moved less than this distance. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|CameraCollision", meta = (ClampMin = "0.0"))
+	float HeadMotionThreshold = 0.5f;
+
+	/** Runs the sweep as an async trace, applying its result one frame later. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|CameraCollision")
+	bool bUseAsyncSweep = true;
+
+	/** Pull back distance at which NearGeometryAlpha reaches 1. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|CameraCollision", meta = (ClampMin = "0.01"))
+	float FadeDistance = 10.f;
+
+	/**
+	 * How close geometry is to the camera, from 0 when the camera sits on the head to 1 when it had to be pulled
+	 * back by FadeDistance or more. Meant to drive a fade or to hide the head mesh.
+	 *
+	 * @return The near geometry alpha between 0 and 1.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|CameraCollision")
+	float GetNearGeometryAlpha() const
+	{
+		return NearGeometryAlpha;
+	}
+
+private:
+	/** Moves the camera to the given fraction of the neck to head segment. */
+	void ApplyFraction(float Fraction, const FVector& Neck, const FVector& DesiredCamera);
+
+	/** Calculates where the camera would be without collision. */
+	FVector GetDesiredCameraLocation() const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UCameraComponent> Camera;
+
+	// Relative location of the camera as placed in the editor.
+	FVector DefaultRelativeLocation = FVector::ZeroVector;
+
+	// Neck and camera locations used by the last sweep.
+	FVector LastNeck = FVector(UE_BIG_NUMBER);
+	FVector LastDesiredCamera = FVector(UE_BIG_NUMBER);
+
+	// Fraction of the neck to head segment the camera can safely use, 1 when nothing is in the way.
+	float SafeFraction = 1.f;
+
+	float NearGeometryAlpha = 0.f;
+
+	// Async sweep waiting to be read back.
+	FTraceHandle PendingSweep;
+};
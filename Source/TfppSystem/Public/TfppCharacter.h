@@ -31,7 +31,11 @@ public:
 	// Begin Overriden Parent Functions
 	// ----------------------------------------------------------------------------------------------------------------
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
+	virtual void PossessedBy(AController* NewController) override;
+	virtual void UnPossessed() override;
+	virtual void OnRep_Controller() override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// ----------------------------------------------------------------------------------------------------------------
 	// End Overriden Parent Functions
@@ -56,13 +60,23 @@ public:
 	 *
 	 * This function provides the character's calculated adjusted view rotation, which is typically used
 	 * to maintain a consistent and realistic perspective in the TFPP system.
+	 * When the dedicated server profile is active the rotation is not updated on tick, so it is calculated here
+	 * the first time it is requested in a frame.
 	 *
 	 * @return The adjusted view rotation as an `FRotator`.
 	 */
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|Rotation")
-	FRotator GetAdjustedViewRotation()
+	FRotator GetAdjustedViewRotation();
+
+	/**
+	 * Whether this character is running the stripped dedicated server simulation profile.
+	 *
+	 * @return True if cosmetic view and animation work is skipped for this character.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|Server")
+	bool IsUsingDedicatedServerProfile() const
 	{
-		return AdjustedViewRotation;
+		return bUseDedicatedServerProfile;
 	}
 
 	/**
@@ -243,6 +257,19 @@ protected:
 	TObjectPtr<UTfppCharacterMovementComponent> TfppCharacterMovement;
 
 private:
+	friend struct FTfppCharacterSnapshot;
+
+	/**
+	 * Strips everything a dedicated server doesn't need from this character: the view rotation is calculated on
+	 * demand instead of on tick, and the mesh only ticks what authoritative movement depends on.
+	 */
+	void ApplyDedicatedServerProfile();
+
+	// True once ApplyDedicatedServerProfile has run for this character.
+	bool bUseDedicatedServerProfile = false;
+
+	// Frame in which AdjustedViewRotation was last calculated on demand.
+	uint64 ViewRotationFrame = 0;
 
 
 };
@@ -4,12 +4,38 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "TfppFixedStep.h"
+#include "TfppSpeedValidation.h"
 #include "TfppTypes.h"
 #include "TfppCharacterMovementComponent.generated.h"
   
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnPaceChanged, EMovementPaces, OldPace, EMovementPaces, NewPace);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnStanceChanged, ECharacterStances, OldStance, ECharacterStances, NewStance);
 
+class UPhysicalMaterial;
+class UPrimitiveComponent;
+
+/**
+ * Speed multipliers applied on top of the pace speeds while walking on a surface.
+ * The resulting multiplier is the product of the base multiplier, the one of the pace and the one of the stance.
+ */
+USTRUCT(BlueprintType)
+struct FTfppSurfaceSpeedModifier
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Surfaces", meta = (ClampMin = "0.0"))
+	float Multiplier = 1.f;
+
+	/** Extra multipliers for some paces, paces without an entry use 1. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Surfaces")
+	TMap<EMovementPaces, float> PaceMultipliers;
+
+	/** Extra multipliers for some stances, stances without an entry use 1. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Surfaces")
+	TMap<ECharacterStances, float> StanceMultipliers;
+};
+
 /**
  * A specialized character movement component for the True First Person System.
  *
@@ -37,6 +63,18 @@ public:
 	// Begin Overriden Parent Functions
 	// ----------------------------------------------------------------------------------------------------------------
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void SendClientAdjustment() override;
+	virtual void ClientAdjustPosition_Implementation(float TimeStamp, FVector NewLoc, FVector NewVel, UPrimitiveComponent* NewBase,
+		FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode,
+		TOptional<FRotator> OptionalRotation = TOptional<FRotator>()) override;
 	// ----------------------------------------------------------------------------------------------------------------
 	// End Overriden Parent Functions
 	// ----------------------------------------------------------------------------------------------------------------
@@ -122,6 +160,64 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Paces")
 	TMap<EMovementPaces, FFloatRange> PacesAngleRestriction;
+
+	/**
+	 * Speed modifiers of the surfaces the character can walk on, keyed by physical material.
+	 * The material of the floor is looked up with a line trace against the floor primitive when the character steps
+	 * onto another primitive, and every few steps on landscapes and meshes with several materials, so walking on the
+	 * same surface costs next to nothing. The trace reads the material of the face under the character, floors
+	 * without one use the material of their simple collision.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Surfaces")
+	TMap<TObjectPtr<UPhysicalMaterial>, FTfppSurfaceSpeedModifier> SurfaceSpeedModifiers;
+
+	/**
+	 * Mobility used while mantling or vaulting, the custom movement mode with the same index.
+	 * Name it in the mobilities of the TFPP settings to give it transition rules.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Mantle")
+	EMobilities MantleMobility = EMobilities::MobilityType1;
+
+	/** Maximum horizontal distance between the character and a ledge it mantles. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Mantle", meta = (ClampMin = "0.0", Units = "cm"))
+	float MantleReach = 100.f;
+
+	/** Range of ledge heights above the feet of the character it can mantle. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Mantle", meta = (ClampMin = "0.0", Units = "cm"))
+	float MinMantleHeight = 40.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Mantle", meta = (ClampMin = "0.0", Units = "cm"))
+	float MaxMantleHeight = 200.f;
+
+	/** Maximum angle between the direction the character moves in and a ledge it mantles. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Mantle", meta = (ClampMin = "0.0", ClampMax = "90.0", Units = "Degrees"))
+	float MantleMaxAngle = 45.f;
+
+	/** Speed of the character along the mantle path. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Mantle", meta = (ClampMin = "1.0", Units = "CentimetersPerSecond"))
+	float MantleSpeed = 350.f;
+
+	/** Vaults over obstacles thin enough for it instead of climbing on top of them. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|Mantle")
+	bool bVaultWhenPossible = true;
+
+	/**
+	 * Mantles the closest ledge in front of the character on its next movement update, or vaults over it.
+	 * Ledges come from the traversal volumes of the level, the request is predicted like a jump.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "TFPP|Mobilities")
+	void Mantle();
+
+	/**
+	 * Whether the character is mantling or vaulting.
+	 *
+	 * @return True while the current mobility is MantleMobility.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|Mobilities")
+	bool IsMantling() const;
+
+	// Set by Mantle until the next movement update, saved with the moves like bWantsToCrouch.
+	uint8 bWantsToMantle : 1;
 	
 	/**
 	 * Updates the stance of the character movement component.
@@ -159,6 +255,34 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "TFPP|Paces")
 	FOnStanceChanged OnStanceChanged;
 
+	/**
+	 * Retrieves the current mobility of the character.
+	 * Custom movement modes map to the mobility with the same index, every other movement mode is the base mobility.
+	 *
+	 * @return The current mobility as an EMobilities enumeration value.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|Mobilities")
+	EMobilities GetCurrentMobility() const;
+
+	/**
+	 * Checks the transition rules from the TFPP settings to know if a stance can be entered from the current one.
+	 *
+	 * @param NewStance The stance to check.
+	 * @return True if the character may switch to NewStance in its current stance and mobility.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|Stances")
+	bool CanEnterStance(ECharacterStances NewStance) const;
+
+	/**
+	 * Finds the fastest pace allowed in the current stance and mobility that isn't faster than the requested one.
+	 * This is the pace SetPace ends up using when the requested pace isn't allowed.
+	 *
+	 * @param RequestedPace The pace the character would like to use.
+	 * @return The best allowed pace, or the current pace if no pace is allowed at all.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|Paces")
+	EMovementPaces GetBestAllowedPace(EMovementPaces RequestedPace) const;
+
 	/**
 	 * Initializes the Tfpp character movement component.
 	 *
@@ -167,6 +291,56 @@ public:
 	 */
 	void InitializeTfppComponent();
 
+	/**
+	 * Restores the pace and stance saved in a snapshot. When called before BeginPlay nothing is broadcast and
+	 * InitializeTfppComponent keeps them instead of going back to the defaults, afterwards OnPaceChanged and
+	 * OnStanceChanged are broadcast for whatever changed.
+	 *
+	 * @param Pace		The pace to restore, ignored if it has no max speed.
+	 * @param Stance	The stance to restore, ignored if it has no speed multiplier.
+	 */
+	void RestoreTfppState(EMovementPaces Pace, ECharacterStances Stance);
+
+	/**
+	 * Whether this component steps at the fixed simulation rate of the TFPP settings.
+	 * Only movement simulated locally does, remote characters are moved by the network.
+	 */
+	bool UsesFixedSimulationRate() const;
+
+	/**
+	 * Fastest speed the character may move at on the ground, whatever its pace: the fastest pace allowed in its
+	 * stance and mobility, with the crouch multiplier and the modifier of the current surface.
+	 */
+	float GetPaceSpeedLimit() const;
+
+	/**
+	 * Number of corrections the server sent to the client of this character, server only. Several moves found out of
+	 * sync before the next adjustment make a single correction.
+	 */
+	int32 GetNumServerCorrections() const
+	{
+		return NumServerCorrections;
+	}
+
+	/**
+	 * Tells the server the pace or stance of the character was changed outside of the moves, by a reliable RPC for
+	 * instance. The moves the client made in the new state before the server applied it get corrected, the
+	 * corrections sent within a round trip of the change are counted apart. Server only.
+	 */
+	void MarkOutOfBandStateChange();
+
+	/** Of the server corrections, those sent within a round trip of an out of band state change, server only. */
+	int32 GetNumOutOfBandCorrections() const
+	{
+		return NumOutOfBandCorrections;
+	}
+
+	/** Heap memory owned by the mantle path, reported by Tfpp.MemReport. */
+	SIZE_T GetMantlePathAllocatedSize() const
+	{
+		return MantlePath.GetAllocatedSize();
+	}
+
 private:
 	// This is the current Pace of the character
 	EMovementPaces CurrentPace;
@@ -183,8 +357,98 @@ private:
 	 */
 	void InitializeDefaultPacesSpeed();
 
+	/** Sets the walk speeds from the current pace, the crouch multiplier and the modifier of the current surface. */
+	void ApplyPaceSpeeds();
+
+	/** Multiplier the current surface applies to a pace in a stance, 1 without a surface modifier. */
+	float GetSurfaceMultiplier(EMovementPaces Pace, ECharacterStances Stance) const;
+
+	friend class UTfppSpeedValidationSubsystem;
+
+	/** Records the last ground move for the speed validation of the server. */
+	void RecordSpeed(float DeltaSeconds, const FVector& OldLocation);
+
+	/** Sends the character back to where it last passed the speed validation. */
+	void RevertToValidatedLocation();
+
+	// Set while registered with the speed validation subsystem.
+	bool bValidatingSpeed = false;
+
+	FTfppSpeedAccumulator SpeedAccumulator;
+
+	// Location of the character when it last passed the speed validation.
+	FVector LastValidatedLocation = FVector::ZeroVector;
+
+	int32 NumServerCorrections = 0;
+	int32 NumOutOfBandCorrections = 0;
+
+	// Game time of the last out of band state change, negative before the first one.
+	double OutOfBandChangeTime = -1.0;
+
+	// Added to the round trip of the connection, the client sends its moves at its own rate and may combine them.
+	static constexpr double OutOfBandCorrectionMargin = 0.1;
+
+	/**
+	 * Resolves the physical material of the floor when the character walked onto another floor primitive, or moved
+	 * on a floor with several materials. Speeds are only updated when the material changes.
+	 */
+	void UpdateSurface();
+
+	// Floor primitive and item the surface was last resolved for, and where it was traced.
+	TWeakObjectPtr<const UPrimitiveComponent> SurfaceFloor;
+	int32 SurfaceFloorItem = INDEX_NONE;
+	FVector SurfaceTraceLocation = FVector::ZeroVector;
+
+	// Distance after which the surface of a floor with several materials is traced again.
+	static constexpr float SurfaceRetraceDistance = 50.f;
+
+	// Half length of the surface trace, centered on the floor impact point.
+	static constexpr float SurfaceTraceHalfLength = 10.f;
+
+	// Physical material of the current surface, null when it has none.
+	TWeakObjectPtr<const UPhysicalMaterial> SurfaceMaterial;
+
 	//FTransform OnProcessRootMotionPostConvertToWorld(const FTransform& InRootMotion, UCharacterMovementComponent* MovementComponent, float DeltaTime);
 
+	/** Changes the pace, optionally refusing it when the character moves outside the angle allowed for it. */
+	void ChangePace(EMovementPaces NewPace, bool bCheckDirectionAngle);
+
+	// Below this horizontal speed the velocity is too small to give a direction and the acceleration is used instead.
+	static constexpr float MinDirectionSpeed = 10.f;
+
 	bool IsPaceAllowedOnDirectionAngle(EMovementPaces MovementPace) const;
+
+	/** Looks up the ledge in front of the character and starts mantling it if the character fits on the other end. */
+	bool StartMantle();
+
+	/** Moves the character along the mantle path. */
+	void PhysMantle(float DeltaTime);
+
+	/**
+	 * Restarts the mantle path from a location the server corrected the character to, keeping the points still ahead.
+	 *
+	 * @return False if the location is too far from the path to continue the mantle from it.
+	 */
+	bool RebuildMantlePath(const FVector& Location);
+
+	// Farthest a correction may put the character from its mantle path for the mantle to go on.
+	static constexpr float MantleCorrectionTolerance = 50.f;
+
+	// Points the character goes through while mantling, from where it started to where it lands.
+	TArray<FVector, TInlineAllocator<4>> MantlePath;
+
+	// Distance travelled along MantlePath.
+	float MantleDistance = 0.f;
+
+	/** Offsets the mesh so it is rendered between the last two fixed steps, or ahead of the last one. */
+	void UpdateFixedStepMeshOffset(float StepTime);
+
+	FTfppFixedStep FixedStep;
+
+	// Set when the pace and stance were restored from a snapshot before BeginPlay.
+	bool bRestoredFromSnapshot = false;
+
+	// Location of the updated component before the last fixed step.
+	FVector PreviousStepLocation = FVector::ZeroVector;
 	
 };
@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "Engine/DeveloperSettings.h"
 #include "Misc/Build.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "TfppTransitionGraph.h"
 #include "TfppDevSettings.generated.h"
 
 UENUM(BlueprintType)
@@ -18,6 +20,16 @@ enum class ETfppLogVerbosity : uint8
 	VeryVerbose UMETA(DisplayName = "Very Verbose")
 };
 
+/** What the server does with a character moving faster than its paces allow. */
+UENUM(BlueprintType)
+enum class ETfppSpeedViolationAction : uint8
+{
+	// Only logs the violation and broadcasts it
+	Flag UMETA(DisplayName = "Flag"),
+	// Also sends the character back to where it last passed the validation
+	Correct UMETA(DisplayName = "Correct")
+};
+
 /**
  * Different variables of the True First Person Perspective plugin are configured in this section.
  */
@@ -33,9 +45,31 @@ public:
 
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Debug|Log", meta = (EditCondition = "bShowDevelopmentLogMessages"))
 	ETfppLogVerbosity LogVerbosity;
+
+	/**
+	 * Maximum number of bytes a single TFPP pawn may own, as measured by Tfpp.MemReport. 0 disables the check.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Debug|Memory", meta = (ClampMin = "0", Units = "Bytes"))
+	int64 PerPawnMemoryBudget;
+
+	/**
+	 * Publishes pace, stance, sprint gate and pitch clamp counters to a named shared memory region at the end of
+	 * every frame, for tools running on the same machine. See TfppTelemetryLayout.h for the layout.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Debug|Telemetry")
+	bool bEnableTelemetry;
+
+	/**
+	 * Name of the shared memory region. {Pid} is replaced by the process id and {Port} by the listen port, so every
+	 * server process on a machine gets its own region.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Debug|Telemetry", meta = (EditCondition = "bEnableTelemetry"))
+	FString TelemetryRegionName;
 	
 	UTfppDevSettings();
 
+	virtual void PostInitProperties() override;
+
 	UPROPERTY(Config, EditAnywhere, Category = "Movement")
 	TArray<FName> Stances;
 
@@ -45,12 +79,126 @@ public:
 	UPROPERTY(Config, EditAnywhere, Category = "Movement")
 	TArray<FName> Mobilities;
 
+	/**
+	 * Which paces each stance allows and which stances can be entered from it.
+	 * Stances without an entry allow every pace and every stance.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Movement|Transitions")
+	TMap<ECharacterStances, FTfppStanceTransitionRules> StanceRules;
+
+	/**
+	 * Which stances and paces each mobility allows.
+	 * Mobilities without an entry allow every stance and every pace.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Movement|Transitions")
+	TMap<EMobilities, FTfppMobilityTransitionRules> MobilityRules;
+
+	/**
+	 * Height a pawn needs above the floor in each stance, the full height of its capsule. Stance navigation volumes
+	 * mark the floors under lower ceilings with the tallest stance that fits, stances without an entry are ignored.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Navigation", meta = (ForceUnits = "cm"))
+	TMap<ECharacterStances, float> StanceClearances;
+
+	/** Time between two updates of the stance and pace animation bundles each character needs. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Animation|Streaming", meta = (ClampMin = "0.0", Units = "s"))
+	float AnimationBundleUpdateInterval;
+
+	/** Time a stance or pace animation bundle stays loaded after no character can reach it anymore. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Animation|Streaming", meta = (ClampMin = "0.0", Units = "s"))
+	float AnimationBundleUnloadCooldown;
+
+	/**
+	 * Puts the meshes of TFPP characters that aren't locally controlled under the animation budget allocator,
+	 * which throttles the least significant ones to keep animation within AnimationBudgetMs.
+	 *
+	 * Enabling it takes over the allocator of the world: its parameters are replaced and it is enabled when the world
+	 * begins play, for every budgeted mesh of the world and not only for TFPP characters. Off by default.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Animation|Budget")
+	bool bUseAnimationBudget;
+
+	/** Game thread time animation may take every frame before meshes are throttled. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Animation|Budget", meta = (EditCondition = "bUseAnimationBudget", ClampMin = "0.1", Units = "ms"))
+	float AnimationBudgetMs;
+
+	/** Distance to the closest player view point at which a mesh becomes the least significant. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Animation|Budget", meta = (EditCondition = "bUseAnimationBudget", ClampMin = "1.0", Units = "cm"))
+	float AnimationBudgetSignificanceDistance;
+
+	/** Audio components the footsteps of every TFPP character share, footsteps beyond it are dropped. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Audio", meta = (ClampMin = "1", ClampMax = "128"))
+	int32 FootstepPoolSize;
+
+	/**
+	 * Steps the movement of locally simulated TFPP characters at FixedSimulationRate instead of once per rendered
+	 * frame. The mesh, and the camera attached to it, are interpolated between the last two steps, which delays what
+	 * is rendered by up to one step. The view rotation follows the control rotation, which changes once per frame, so
+	 * it isn't stepped. Remote characters are not affected.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Simulation")
+	bool bUseFixedSimulationRate;
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Simulation", meta = (EditCondition = "bUseFixedSimulationRate", ClampMin = "10.0", ClampMax = "240.0", Units = "Hz"))
+	float FixedSimulationRate;
+
+	/** Steps a single frame may run, time beyond them is dropped. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Simulation", meta = (EditCondition = "bUseFixedSimulationRate", ClampMin = "1", ClampMax = "16"))
+	int32 MaxSimulationStepsPerFrame;
+
+	/** Extrapolates the mesh from the last step with the current velocity instead of interpolating, removing the delay. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Simulation", meta = (EditCondition = "bUseFixedSimulationRate"))
+	bool bExtrapolateFixedSimulation;
+
+	/**
+	 * Retrieves the transition table compiled from StanceRules and MobilityRules.
+	 *
+	 * @return The compiled transition table.
+	 */
+	const FTfppTransitionTable& GetTransitionTable() const
+	{
+		return TransitionTable;
+	}
+
+	/**
+	 * When enabled, TFPP characters on a dedicated server skip all cosmetic view and animation work.
+	 * The adjusted view rotation is then only calculated when gameplay code asks for it.
+	 * Off by default, compare the server cost with and without it with Extras/TfppSoak before turning it on.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Server")
+	bool bUseDedicatedServerProfile;
+
+	/**
+	 * How TFPP meshes tick on a dedicated server when the server profile is enabled.
+	 * Bones keep being refreshed by default, as hits may be validated against the physics asset on the server.
+	 * OnlyTickMontagesWhenNotRendered saves the most when they aren't, montages still keep root motion authoritative.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Server", meta = (EditCondition = "bUseDedicatedServerProfile"))
+	EVisibilityBasedAnimTickOption DedicatedServerAnimTickOption;
+
+	/**
+	 * Validates on the server that the characters of remote players don't move on the ground faster than the
+	 * fastest pace allowed in their stance and mobility.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Server|Speed Validation")
+	bool bValidateSpeed;
+
+	/** Time between two checks of a character, the distance it moved is compared over that time. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Server|Speed Validation", meta = (EditCondition = "bValidateSpeed", ClampMin = "0.1", Units = "s"))
+	float SpeedValidationInterval;
+
+	/** Ratio between the distance moved and the allowed one above which a character is in violation. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Server|Speed Validation", meta = (EditCondition = "bValidateSpeed", ClampMin = "1.0"))
+	float SpeedTolerance;
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Server|Speed Validation", meta = (EditCondition = "bValidateSpeed"))
+	ETfppSpeedViolationAction SpeedViolationAction;
+
 	static UTfppDevSettings* Get()
 	{return CastChecked<UTfppDevSettings>(UTfppDevSettings::StaticClass()->GetDefaultObject());}
 
 #if WITH_EDITOR
 
-	virtual void PostInitProperties() override;
 	virtual bool CanEditChange(const FProperty* InProperty) const override;
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 protected:
@@ -61,5 +209,9 @@ private:
 	static UTfppDevSettings* DefaultSettings;
 	
 #endif
+
+private:
+	// Compiled from StanceRules and MobilityRules whenever they are loaded or edited.
+	FTfppTransitionTable TransitionTable;
 	
 };
@@ -0,0 +1,44 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Time accumulator of the fixed rate TFPP simulation.
+ *
+ * Frame time is accumulated and consumed in whole steps, what is left over is the fraction of a step rendered
+ * frames interpolate or extrapolate with. When a frame would need more than the maximum number of steps the extra
+ * time is dropped instead of being carried over, so a hitch doesn't turn into a spiral of ever longer frames.
+ */
+struct FTfppFixedStep
+{
+	/**
+	 * Accumulates the time of a frame.
+	 *
+	 * @param DeltaTime	Time of the frame.
+	 * @param StepTime	Duration of a simulation step.
+	 * @param MaxSteps	Maximum number of steps a single frame may run.
+	 * @return Number of steps to simulate this frame.
+	 */
+	int32 Advance(float DeltaTime, float StepTime, int32 MaxSteps)
+	{
+		Accumulator += DeltaTime;
+		const int32 NumSteps = FMath::FloorToInt32(Accumulator / StepTime);
+		Accumulator -= NumSteps * StepTime;
+		if (NumSteps > MaxSteps)
+		{
+			Accumulator = 0.f;
+			return MaxSteps;
+		}
+		return NumSteps;
+	}
+
+	/** Fraction of a step accumulated but not simulated yet, between 0 and 1. */
+	float GetAlpha(float StepTime) const
+	{
+		return FMath::Clamp(Accumulator / StepTime, 0.f, 1.f);
+	}
+
+	float Accumulator = 0.f;
+};
@@ -0,0 +1,142 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "TfppFootPlacementComponent.generated.h"
+
+/**
+ * Ground information found under a foot, ready to be consumed by the anim instance.
+ */
+USTRUCT(BlueprintType)
+struct FTfppFootPlacement
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|FootPlacement")
+	bool bHasGround = false;
+
+	// World location of the ground under the foot.
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|FootPlacement")
+	FVector GroundLocation = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|FootPlacement")
+	FVector GroundNormal = FVector::UpVector;
+
+	// Vertical distance between the ground under the foot and the bottom of the capsule.
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|FootPlacement")
+	float Offset = 0.f;
+};
+
+/**
+ * Finds the ground under the feet of a full body TFPP pawn.
+ *
+ * The component doesn't trace by itself. It registers with UTfppFootPlacementSubsystem, which issues the traces of
+ * every registered pawn as async traces at the end of the frame and hands the results back on the next one.
+ * While the pawn doesn't move the last results are reused and no trace is issued at all.
+ */
+UCLASS(ClassGroup=("True First Person Perspective | Components"), meta=(BlueprintSpawnableComponent))
+class TFPPSYSTEM_API UTfppFootPlacementComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTfppFootPlacementComponent();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Bones or sockets of the character mesh traced for ground, one placement is produced per entry. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|FootPlacement")
+	TArray<FName> FootBones = {TEXT("foot_l"), TEXT("foot_r")};
+
+	/** Distance above the foot where the trace starts. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|FootPlacement", meta = (ClampMin = "0.0"))
+	float TraceUpDistance = 50.f;
+
+	/** Distance below the foot where the trace ends. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|FootPlacement", meta = (ClampMin = "0.0"))
+	float TraceDownDistance = 75.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|FootPlacement")
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** The cached placements are kept while the pawn moved less than this since they were traced. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|FootPlacement", meta = (ClampMin = "0.0"))
+	float StationaryTolerance = 1.f;
+
+	/**
+	 * Retrieves the latest ground information for every foot, in the same order as FootBones.
+	 *
+	 * @return The placements found by the last completed batch of traces.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|FootPlacement")
+	const TArray<FTfppFootPlacement>& GetFootPlacements() const
+	{
+		return FootPlacements;
+	}
+
+	/** Heap memory owned by this component, reported by Tfpp.MemReport. */
+	SIZE_T GetAllocatedSize() const
+	{
+		return FootBones.GetAllocatedSize() + FootPlacements.GetAllocatedSize() + PendingTraces.GetAllocatedSize();
+	}
+
+private:
+	friend class UTfppFootPlacementSubsystem;
+
+	UPROPERTY(Transient)
+	TArray<FTfppFootPlacement> FootPlacements;
+
+	// Actor location when the cached placements were traced.
+	FVector TracedLocation = FVector(UE_BIG_NUMBER);
+
+	// Traces issued for this pawn that haven't been read back yet.
+	TArray<FTraceHandle> PendingTraces;
+};
+
+/**
+ * Batches the foot traces of every TFPP pawn in the world.
+ *
+ * Results of the previous frame are read back first, then the traces for pawns that moved are queued as async
+ * traces, so the game thread never waits on a trace.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppFootPlacementSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	void RegisterComponent(UTfppFootPlacementComponent* Component);
+	void UnregisterComponent(UTfppFootPlacementComponent* Component);
+
+private:
+	/** Reads back the traces issued last frame for a component. */
+	void GatherResults(UTfppFootPlacementComponent& Component) const;
+
+	/** Queues the traces of a component if it moved since its placements were last traced. */
+	void IssueTraces(UTfppFootPlacementComponent& Component) const;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UTfppFootPlacementComponent>> Components;
+};
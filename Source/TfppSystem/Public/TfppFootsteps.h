@@ -0,0 +1,191 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TfppTypes.h"
+#include "TfppFootsteps.generated.h"
+
+class UAudioComponent;
+class USoundAttenuation;
+class USoundBase;
+class UTfppCharacterMovementComponent;
+
+/** Footsteps of a pace. */
+USTRUCT(BlueprintType)
+struct FTfppFootstepPace
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps")
+	TObjectPtr<USoundBase> Sound;
+
+	/** Distance travelled between two footsteps. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "1.0", Units = "cm"))
+	float StepLength = 75.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "0.0"))
+	float Volume = 1.f;
+};
+
+/** How a stance changes the footsteps of every pace. */
+USTRUCT(BlueprintType)
+struct FTfppFootstepStance
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "0.01"))
+	float StepLengthMultiplier = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "0.0"))
+	float VolumeMultiplier = 1.f;
+};
+
+/** A footstep or landing waiting to be played by UTfppFootstepSubsystem. */
+struct FTfppFootstepEvent
+{
+	FVector Location = FVector::ZeroVector;
+	USoundBase* Sound = nullptr;
+	USoundAttenuation* Attenuation = nullptr;
+	float Volume = 1.f;
+
+	// Distance beyond which no listener can hear the event.
+	float AudibleDistance = 0.f;
+};
+
+/**
+ * Plays the footsteps and landings of a TFPP character from its pace, stance and velocity, without anim notifies.
+ *
+ * A footstep is emitted every StepLength of ground travelled, so cadence follows the speed and the pace, and the
+ * stance scales the step length and the volume. The component doesn't tick and never creates audio components,
+ * UTfppFootstepSubsystem gathers the events of every character once per frame and plays the audible ones.
+ */
+UCLASS(ClassGroup=("True First Person Perspective | Components"), meta=(BlueprintSpawnableComponent))
+class TFPPSYSTEM_API UTfppFootstepComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTfppFootstepComponent();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Footsteps of every pace, paces without an entry are silent. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps")
+	TMap<EMovementPaces, FTfppFootstepPace> Paces;
+
+	/** Stances without an entry leave the footsteps of the pace as they are. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps")
+	TMap<ECharacterStances, FTfppFootstepStance> Stances;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps")
+	TObjectPtr<USoundBase> LandingSound;
+
+	/** Landings slower than this are silent. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "0.0", Units = "cm/s"))
+	float MinLandingSpeed = 300.f;
+
+	/** Landings faster than this are as loud as a landing at this speed. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "0.0", Units = "cm/s"))
+	float MaxLandingSpeed = 900.f;
+
+	/** Landing volume at MinLandingSpeed, it grows with the speed of the landing up to MaxLandingSpeed. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "0.0"))
+	float LandingVolume = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps")
+	TObjectPtr<USoundAttenuation> Attenuation;
+
+	/**
+	 * Distance at which an event of volume 1 can't be heard anymore, louder events carry further.
+	 * Events out of reach of every listener are culled before any audio object is touched, keep it in line with
+	 * the attenuation.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Footsteps", meta = (ClampMin = "0.0", Units = "cm"))
+	float AudibleDistance = 2500.f;
+
+	/** Heap memory owned by this component, reported by Tfpp.MemReport. */
+	SIZE_T GetAllocatedSize() const
+	{
+		return Paces.GetAllocatedSize() + Stances.GetAllocatedSize();
+	}
+
+private:
+	friend class UTfppFootstepSubsystem;
+
+	/**
+	 * Advances the step cadence by a frame.
+	 *
+	 * @param OutEvent	Receives the footstep or landing of the frame, if any.
+	 * @return True if the character made a sound this frame.
+	 */
+	bool Advance(float DeltaTime, FTfppFootstepEvent& OutEvent);
+
+	/** Distance between two footsteps in the current pace and stance. */
+	float GetStepLength(const FTfppFootstepPace& Pace) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTfppCharacterMovementComponent> Movement;
+
+	// Ground distance left before the next footstep.
+	float DistanceToStep = 0.f;
+
+	// Vertical speed while falling, used for the landing.
+	float FallSpeed = 0.f;
+	bool bWasFalling = false;
+};
+
+/**
+ * Plays the footsteps of every TFPP character in the world.
+ *
+ * Events are gathered once per frame and culled against the distance to every local listener before any audio
+ * object is touched. Audible ones are played on a small pool of audio components that is reused from frame to frame,
+ * events that find no free component are dropped. Emitted, culled and dropped events are reported under stat Tfpp and
+ * in the Tfpp CSV category. Nothing is registered on dedicated servers.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppFootstepSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	void RegisterComponent(UTfppFootstepComponent* Component);
+	void UnregisterComponent(UTfppFootstepComponent* Component);
+
+private:
+	/** Whether a local listener is close enough to hear an event. */
+	bool IsAudible(const FTfppFootstepEvent& Event) const;
+
+	/** Plays an event on a free pooled audio component, returning false when the pool is exhausted. */
+	bool Play(const FTfppFootstepEvent& Event);
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UTfppFootstepComponent>> Components;
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UAudioComponent>> Pool;
+
+	// Reused between ticks to avoid allocating every frame.
+	TArray<FTfppFootstepEvent> Events;
+	TArray<FVector> Listeners;
+};
@@ -0,0 +1,169 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "TfppHeadHistory.generated.h"
+
+class UCameraComponent;
+
+/**
+ * Head camera pose of a TFPP pawn at a given server time, as returned by a rewind.
+ */
+USTRUCT(BlueprintType)
+struct FTfppHeadPose
+{
+	GENERATED_BODY()
+
+	// World location of the head camera, where first person shots start from.
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|LagCompensation")
+	FVector CameraLocation = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|LagCompensation")
+	FRotator CameraRotation = FRotator::ZeroRotator;
+
+	// World view rotation built from the adjusted view rotation, where first person shots go.
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|LagCompensation")
+	FRotator ViewRotation = FRotator::ZeroRotator;
+};
+
+/**
+ * Quantized head pose stored by FTfppHeadPoseHistory.
+ *
+ * The location is kept in millimeters, which covers more than the whole default world, rotations use the
+ * engine short compression (about 0.0055 degrees) and the time is in milliseconds since the world started.
+ */
+struct FTfppHeadPoseSample
+{
+	uint32 TimeMs;
+	int32 Location[3];
+	uint16 CameraRotation[3];
+	uint16 ViewRotation[2];
+};
+
+static_assert(sizeof(FTfppHeadPoseSample) == 28, "The per pawn cost documented in FTfppHeadPoseHistory assumes 28 byte samples.");
+
+/**
+ * Fixed capacity ring buffer of quantized head poses.
+ *
+ * Samples have to be recorded in increasing time order. Once the buffer is full the oldest sample is overwritten,
+ * so the memory used never changes after Init: 28 bytes per sample, 1792 bytes with the default 64 samples.
+ * Rewinding binary searches the two samples around the requested time and interpolates between them.
+ */
+class TFPPSYSTEM_API FTfppHeadPoseHistory
+{
+public:
+	/** Allocates room for Capacity samples and forgets every recorded one. */
+	void Init(int32 Capacity);
+
+	/** Forgets every recorded sample and frees the buffer, nothing is recorded until the next Init. */
+	void Reset();
+
+	/** Stores a pose, overwriting the oldest one when the buffer is full. Poses older than the newest one are ignored. */
+	void Record(double Time, const FVector& CameraLocation, const FRotator& CameraRotation, const FRotator& ViewRotation);
+
+	/**
+	 * Rebuilds the pose at a given time, interpolated between the two closest samples.
+	 * Times outside the recorded range return the oldest or the newest pose.
+	 *
+	 * @param Time		Time to rewind to, in the same clock the poses were recorded with.
+	 * @param OutPose	The rebuilt pose.
+	 * @return False if nothing has been recorded yet.
+	 */
+	bool Rewind(double Time, FTfppHeadPose& OutPose) const;
+
+	int32 Num() const
+	{
+		return NumSamples;
+	}
+
+	/** Time of the oldest sample still stored, or 0 when empty. */
+	double GetOldestTime() const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Samples.GetAllocatedSize();
+	}
+
+private:
+	const FTfppHeadPoseSample& GetSample(int32 Index) const
+	{
+		// Index 0 is the oldest sample
+		return Samples[(Oldest + Index) % Samples.Num()];
+	}
+
+	static int32 QuantizeLocation(double Value);
+	static FTfppHeadPose Decode(const FTfppHeadPoseSample& Sample);
+
+	// Quantization steps per world unit, the location is stored in millimeters.
+	static constexpr double LocationScale = 10.0;
+
+	TArray<FTfppHeadPoseSample> Samples;
+	int32 Oldest = 0;
+	int32 NumSamples = 0;
+};
+
+/**
+ * Records where the head camera of a TFPP pawn was and where it looked, for server side lag compensation.
+ *
+ * With the camera on the head socket shots start from the animated head rather than from the capsule eye height,
+ * so validating a shot needs the head pose of the time the client fired. The component records the pose every
+ * frame after animation, on listen and dedicated servers only, and rewinds it on demand.
+ *
+ * The mesh has to be animated on the server, with the clips the client plays, for the head to move as it did on the
+ * client. The dedicated server profile leaves the animation tick option of pawns owning this component untouched and
+ * doesn't skip the cosmetic updates of their anim instance for that reason.
+ */
+UCLASS(ClassGroup=("True First Person Perspective | Components"), meta=(BlueprintSpawnableComponent))
+class TFPPSYSTEM_API UTfppHeadHistoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTfppHeadHistoryComponent();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/**
+	 * Number of poses kept. It should cover the highest latency the server compensates for at the server frame
+	 * rate, 64 samples are a little over a second at 60 Hz. Every sample costs 28 bytes.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|LagCompensation", meta = (ClampMin = "2"))
+	int32 HistoryCapacity = 64;
+
+	/**
+	 * Retrieves the head pose of the pawn at a past server time.
+	 *
+	 * @param ServerTime	World time to rewind to, as returned by GetTimeSeconds on the server.
+	 * @param OutPose		The interpolated pose.
+	 * @return False if no pose has been recorded, which is always the case on clients.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "TFPP|LagCompensation")
+	bool RewindHeadPose(double ServerTime, FTfppHeadPose& OutPose) const;
+
+	const FTfppHeadPoseHistory& GetHistory() const
+	{
+		return History;
+	}
+
+	/** Heap memory owned by this component, reported by Tfpp.MemReport. */
+	SIZE_T GetAllocatedSize() const
+	{
+		return History.GetAllocatedSize();
+	}
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<UCameraComponent> Camera;
+
+	FTfppHeadPoseHistory History;
+};
@@ -0,0 +1,276 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Curves/CurveFloat.h"
+#include "Engine/DataAsset.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TfppTypes.h"
+#include "TfppHeadMotion.generated.h"
+
+class UCameraComponent;
+
+/**
+ * Head bob, sway and breathing of a single pace and stance.
+ *
+ * Stride curves cover one stride cycle with their time going from 0 to 1, the breathing curve covers one breath
+ * the same way. Curves are only read while baking, the runtime uses the baked tables.
+ */
+USTRUCT(BlueprintType)
+struct FTfppHeadMotionCurves
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion")
+	EMovementPaces Pace = EMovementPaces::PaceType0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion")
+	ECharacterStances Stance = ECharacterStances::StanceType0;
+
+	/** Vertical camera offset in cm over a stride cycle. */
+	UPROPERTY(EditAnywhere, Category = "Setup|HeadMotion")
+	FRuntimeFloatCurve Bob;
+
+	/** Lateral camera offset in cm over a stride cycle. */
+	UPROPERTY(EditAnywhere, Category = "Setup|HeadMotion")
+	FRuntimeFloatCurve Sway;
+
+	/** Camera roll in degrees over a stride cycle. */
+	UPROPERTY(EditAnywhere, Category = "Setup|HeadMotion")
+	FRuntimeFloatCurve Roll;
+
+	/** Distance travelled during one stride cycle. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion", meta = (ClampMin = "1.0", Units = "cm"))
+	float StrideLength = 150.f;
+
+	/** Speed at which the stride motion reaches its full amplitude, it fades out towards standing still. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion", meta = (ClampMin = "1.0", Units = "cm/s"))
+	float ReferenceSpeed = 300.f;
+
+	/** Camera pitch in degrees over one breath. */
+	UPROPERTY(EditAnywhere, Category = "Setup|HeadMotion")
+	FRuntimeFloatCurve Breathing;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion", meta = (ClampMin = "0.1", Units = "s"))
+	float BreathingPeriod = 4.f;
+};
+
+/**
+ * Runtime state of the head motion of a pawn, advanced and evaluated by UTfppHeadMotionSubsystem.
+ */
+struct FTfppHeadMotionState
+{
+	// Entry of the current pace and stance, and the one being blended out, INDEX_NONE when there is none.
+	int32 Entry = INDEX_NONE;
+	int32 PreviousEntry = INDEX_NONE;
+
+	// Position in the current stride cycle and breath, from 0 to 1.
+	float StridePhase = 0.f;
+	float BreathingPhase = 0.f;
+
+	// Weight of the current entry, it reaches 1 once the blend from the previous one is over.
+	float BlendAlpha = 1.f;
+
+	// Stride amplitude from the speed of the pawn, from 0 to 1.
+	float StrideScale = 0.f;
+};
+
+/**
+ * Procedural head motion of TFPP cameras, keyed by pace and stance.
+ *
+ * The curves of every entry are baked into small lookup tables when the asset is loaded. Evaluating a pawn is then
+ * two table reads and a SIMD interpolation per entry, with no curve evaluation, which keeps it cheap enough for every
+ * pawn of the world including AI driven ones watched by spectators.
+ */
+UCLASS(BlueprintType, ClassGroup=("True First Person Perspective | Animation"))
+class TFPPSYSTEM_API UTfppHeadMotionProfile : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/**
+	 * Motion of every pace and stance. A pace and stance without an entry uses the first entry of the same pace,
+	 * and has no motion at all if the pace has none.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion")
+	TArray<FTfppHeadMotionCurves> Entries;
+
+	/** Number of samples baked per stride cycle and per breath. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion", meta = (ClampMin = "4", ClampMax = "256"))
+	int32 TableResolution = 32;
+
+	/**
+	 * Finds the entry used for a pace and stance.
+	 *
+	 * @return Index into Entries, or INDEX_NONE if the pace has no motion.
+	 */
+	int32 FindEntry(EMovementPaces Pace, ECharacterStances Stance) const
+	{
+		return Lookup[static_cast<int32>(Pace)][static_cast<int32>(Stance)];
+	}
+
+	/**
+	 * Advances the phases of a state by a frame.
+	 *
+	 * @param Speed		Horizontal speed of the pawn.
+	 */
+	void Advance(FTfppHeadMotionState& State, float Speed, float DeltaTime) const;
+
+	/**
+	 * Evaluates a batch of states.
+	 *
+	 * @param States		States to evaluate, all advanced with this profile.
+	 * @param OutMotion		Receives, for every state, the vertical and lateral offsets in X and Y, the roll in Z
+	 *						and the pitch in W.
+	 */
+	void Evaluate(TConstArrayView<FTfppHeadMotionState> States, TArrayView<FVector4f> OutMotion) const;
+
+private:
+	struct FBakedEntry
+	{
+		// First sample of the entry in BakedSamples, stride samples come first and breathing samples after them.
+		int32 FirstSample = 0;
+		float InvStrideLength = 0.f;
+		float InvReferenceSpeed = 0.f;
+		float InvBreathingPeriod = 0.f;
+	};
+
+	/** Samples every curve into BakedSamples and rebuilds the pace and stance lookup. */
+	void Bake();
+
+	TArray<FBakedEntry> BakedEntries;
+
+	// TableResolution + 1 samples per stride cycle then per breath for every entry, the last sample repeats the first.
+	TArray<FVector4f> BakedSamples;
+
+	// Index into Entries for every pace and stance, INDEX_NONE when there is none.
+	int8 Lookup[TfppTypes::NumPaces][TfppTypes::NumStances];
+};
+
+/**
+ * Applies the head motion of a TFPP head motion profile to the camera of its pawn.
+ *
+ * The motion follows the pace and the stance of the pawn and blends over BlendTime when either changes.
+ * It is added to the camera as an additive offset, so it stacks with camera collision and the head animation.
+ * The component doesn't tick, UTfppHeadMotionSubsystem updates every pawn in one batch.
+ */
+UCLASS(ClassGroup=("True First Person Perspective | Components"), meta=(BlueprintSpawnableComponent))
+class TFPPSYSTEM_API UTfppHeadMotionComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTfppHeadMotionComponent();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion")
+	TObjectPtr<UTfppHeadMotionProfile> Profile;
+
+	/** Time it takes to blend to the motion of a new pace or stance. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|HeadMotion", meta = (ClampMin = "0.0", Units = "s"))
+	float BlendTime = 0.3f;
+
+	/** Global multiplier of the motion, 0 turns it off. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Setup|HeadMotion", meta = (ClampMin = "0.0"))
+	float Intensity = 1.f;
+
+	/**
+	 * Camera offset of the last update, in camera space.
+	 *
+	 * @return The offset, Z being the bob and Y the sway.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|HeadMotion")
+	FVector GetHeadMotionOffset() const
+	{
+		return HeadMotionOffset;
+	}
+
+	/** Camera rotation of the last update, made of the stride roll and the breathing pitch. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "TFPP|HeadMotion")
+	FRotator GetHeadMotionRotation() const
+	{
+		return HeadMotionRotation;
+	}
+
+private:
+	friend class UTfppHeadMotionSubsystem;
+
+	UFUNCTION()
+	void HandlePaceChanged(EMovementPaces OldPace, EMovementPaces NewPace);
+
+	UFUNCTION()
+	void HandleStanceChanged(ECharacterStances OldStance, ECharacterStances NewStance);
+
+	/** Starts blending to the entry of the current pace and stance. */
+	void SelectEntry();
+
+	/** Stores the evaluated motion and pushes it to the camera. */
+	void ApplyMotion(const FVector4f& Motion);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UCameraComponent> Camera;
+
+	FTfppHeadMotionState State;
+
+	FVector HeadMotionOffset = FVector::ZeroVector;
+	FRotator HeadMotionRotation = FRotator::ZeroRotator;
+
+	// Offset this component added to the camera, removed before adding the next one.
+	FTransform AppliedOffset = FTransform::Identity;
+};
+
+/**
+ * Updates the head motion of every TFPP pawn in the world.
+ *
+ * Pawns are kept grouped by profile so each profile evaluates all its pawns in a single batch.
+ * Nothing is registered on dedicated servers, there is no camera to move.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppHeadMotionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	void RegisterComponent(UTfppHeadMotionComponent* Component);
+	void UnregisterComponent(UTfppHeadMotionComponent* Component);
+
+private:
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UTfppHeadMotionComponent>> Components;
+
+	// Reused between ticks to avoid allocating every frame.
+	TArray<FTfppHeadMotionState> States;
+	TArray<FVector4f> Motion;
+};
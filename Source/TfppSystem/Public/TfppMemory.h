@@ -0,0 +1,57 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ATfppCharacter;
+class UWorld;
+
+/**
+ * Breakdown of the memory owned by a single TFPP pawn, in bytes.
+ *
+ * Object sizes are the reflected size of the instance class, allocations are the heap memory owned by the
+ * containers and delegate invocation lists of the TFPP classes. Memory owned by engine base classes is not
+ * counted beyond the object size, since it doesn't depend on this plugin.
+ */
+struct TFPPSYSTEM_API FTfppPawnMemoryReport
+{
+	SIZE_T CharacterObject = 0;
+	SIZE_T MovementComponentObject = 0;
+	SIZE_T PaceMaxSpeed = 0;
+	SIZE_T StanceSpeedMultiplier = 0;
+	SIZE_T PacesAngleRestriction = 0;
+	SIZE_T OnPaceChanged = 0;
+	SIZE_T OnStanceChanged = 0;
+	// Surface speed modifiers, with the pace and stance multipliers of every surface.
+	SIZE_T SurfaceSpeedModifiers = 0;
+	SIZE_T MantlePath = 0;
+	// Objects and allocations of the other TFPP components owned by the pawn, Blueprint and game subclasses included.
+	SIZE_T OtherComponents = 0;
+
+	SIZE_T GetTotal() const
+	{
+		return CharacterObject + MovementComponentObject + PaceMaxSpeed + StanceSpeedMultiplier
+			+ PacesAngleRestriction + OnPaceChanged + OnStanceChanged + SurfaceSpeedModifiers + MantlePath + OtherComponents;
+	}
+
+	FTfppPawnMemoryReport& operator+=(const FTfppPawnMemoryReport& Other);
+};
+
+namespace TfppMemory
+{
+	/** Measures the memory owned by a TFPP pawn. */
+	TFPPSYSTEM_API FTfppPawnMemoryReport MeasurePawn(const ATfppCharacter& Character);
+
+	/**
+	 * Measures every TFPP pawn in the world and checks them against the per pawn budget of the TFPP settings.
+	 * Meant to be called from automation tests as well as from the Tfpp.MemReport console command.
+	 *
+	 * @param World				World whose pawns are measured.
+	 * @param OutAggregate		Sum of the reports of every pawn.
+	 * @param OutNumPawns		Number of pawns measured.
+	 * @param OutNumOverBudget	Number of pawns over the budget.
+	 * @return True if no pawn exceeds the budget, or if no budget is configured.
+	 */
+	TFPPSYSTEM_API bool MeasureWorld(const UWorld* World, FTfppPawnMemoryReport& OutAggregate, int32& OutNumPawns, int32& OutNumOverBudget);
+}
@@ -0,0 +1,316 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavQueryFilter.h"
+#include "AI/Navigation/NavRelevantInterface.h"
+#include "GameFramework/Volume.h"
+#include "NavAreas/NavArea.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TfppTypes.h"
+#include "TfppNavigation.generated.h"
+
+class ANavigationData;
+class ATfppCharacter;
+class UTfppCharacterMovementComponent;
+
+/**
+ * Navigation area where a pawn only fits in a lower stance than standing.
+ *
+ * Every stance has its own area, and its own area flag: the bit of its index in ECharacterStances. Bit 0 is the
+ * default walkable flag, which is fine as Standing never needs an area. Excluding the flag of a stance in a query
+ * filter keeps the paths out of the spaces only that stance fits, at no cost for the path finding.
+ */
+UCLASS(Abstract)
+class TFPPSYSTEM_API UTfppNavArea_Stance : public UNavArea
+{
+	GENERATED_BODY()
+
+public:
+	ECharacterStances GetRequiredStance() const
+	{
+		return RequiredStance;
+	}
+
+	/** Area flag of a stance in the navigation data. */
+	static uint16 GetStanceFlag(ECharacterStances Stance)
+	{
+		return static_cast<uint16>(1 << static_cast<int32>(Stance));
+	}
+
+	/**
+	 * Retrieves the area of a stance.
+	 *
+	 * @param Stance	Any stance but Standing.
+	 * @return The area class, null for Standing.
+	 */
+	static TSubclassOf<UNavArea> GetAreaClass(ECharacterStances Stance);
+
+protected:
+	void SetRequiredStance(ECharacterStances Stance);
+
+private:
+	UPROPERTY(VisibleAnywhere, Category = "Setup|Navigation")
+	ECharacterStances RequiredStance = ECharacterStances::StanceType0;
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance1 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance1() { SetRequiredStance(ECharacterStances::StanceType1); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance2 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance2() { SetRequiredStance(ECharacterStances::StanceType2); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance3 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance3() { SetRequiredStance(ECharacterStances::StanceType3); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance4 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance4() { SetRequiredStance(ECharacterStances::StanceType4); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance5 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance5() { SetRequiredStance(ECharacterStances::StanceType5); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance6 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance6() { SetRequiredStance(ECharacterStances::StanceType6); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance7 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance7() { SetRequiredStance(ECharacterStances::StanceType7); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance8 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance8() { SetRequiredStance(ECharacterStances::StanceType8); }
+};
+
+UCLASS()
+class TFPPSYSTEM_API UTfppNavArea_Stance9 : public UTfppNavArea_Stance
+{
+	GENERATED_BODY()
+
+public:
+	UTfppNavArea_Stance9() { SetRequiredStance(ECharacterStances::StanceType9); }
+};
+
+/** Box of floor where the ceiling is too low to stand, baked by ATfppStanceNavVolume. */
+USTRUCT()
+struct FTfppStanceNavBox
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FBox Box = FBox(ForceInit);
+
+	UPROPERTY()
+	ECharacterStances Stance = ECharacterStances::StanceType0;
+
+	// No stance fits under the ceiling, the box is cut out of the navigation.
+	UPROPERTY()
+	bool bBlocked = false;
+};
+
+/**
+ * Volume marking the navigation under low ceilings with the stance a pawn needs to get through, from the stance
+ * clearances of the TFPP settings.
+ *
+ * The bake traces a grid of vertical rays over the volume for every walkable floor, up to MaxLayers on top of each
+ * other, and for the ceiling above each of them. Floors a stance fits under but not the tallest one are merged into
+ * boxes and marked with the area of the tallest stance that fits, floors no stance fits under are cut out. The nav
+ * mesh has to be generated for an agent no taller than the lowest stance, or the low spaces won't have navigation to
+ * mark. Bake again whenever the geometry changes.
+ */
+UCLASS()
+class TFPPSYSTEM_API ATfppStanceNavVolume : public AVolume, public INavRelevantInterface
+{
+	GENERATED_BODY()
+
+public:
+	ATfppStanceNavVolume();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void GetNavigationData(FNavigationRelevantData& Data) const override;
+	virtual FBox GetNavigationBounds() const override;
+	virtual bool IsNavigationRelevant() const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Distance between two rays of the bake. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Navigation", meta = (ClampMin = "5.0", Units = "cm"))
+	float SampleSpacing = 25.f;
+
+	/** Floors on top of each other a ray looks for. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Navigation", meta = (ClampMin = "1", ClampMax = "16"))
+	int32 MaxLayers = 4;
+
+	/** Distance below a floor the ray looking for the next one starts at. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Navigation", meta = (ClampMin = "1.0", Units = "cm"))
+	float FloorThickness = 10.f;
+
+	/** Floors further apart in height aren't merged into the same box. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Navigation", meta = (ClampMin = "1.0", Units = "cm"))
+	float MaxStepHeight = 45.f;
+
+	/**
+	 * Horizontal margin added around the boxes, so pawns switch stance before their capsule reaches the ceiling.
+	 * Usually the radius of the capsule.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Setup|Navigation", meta = (ClampMin = "0.0", Units = "cm"))
+	float Padding = 35.f;
+
+	/** Minimum Z of the normal of a surface for a pawn to stand on it. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Navigation", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float WalkableFloorZ = 0.71f;
+
+	UPROPERTY(EditAnywhere, Category = "Setup|Navigation")
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** Bakes the stance boxes of the geometry inside the volume and updates the navigation. */
+	UFUNCTION(CallInEditor, Category = "Setup|Navigation")
+	void Bake();
+
+	/**
+	 * Traces the geometry inside the volume for low ceilings without touching the baked data.
+	 *
+	 * @param OutBoxes	Boxes of floor needing another stance than the tallest one.
+	 */
+	void BakeBoxes(TArray<FTfppStanceNavBox>& OutBoxes) const;
+
+	const TArray<FTfppStanceNavBox>& GetBoxes() const
+	{
+		return Boxes;
+	}
+
+private:
+	UPROPERTY()
+	TArray<FTfppStanceNavBox> Boxes;
+
+	UPROPERTY()
+	FBox BakedBounds = FBox(ForceInit);
+};
+
+/**
+ * Navigation queries of TFPP pawns, filtered by the stances they can take.
+ *
+ * A set of stances is a mask with the bit of the index of every stance in it. Query filters are built once per
+ * navigation data and stance set, and only exclude area flags, so filtered path finding costs as much as unfiltered.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppNavigationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/**
+	 * Retrieves the query filter keeping paths out of the spaces none of the stances fits.
+	 *
+	 * @param NavData		Navigation data the filter is used with.
+	 * @param StanceMask	Stances the pawn can take.
+	 * @return The cached filter, shared by every query with the same navigation data and stances.
+	 */
+	FSharedConstNavQueryFilter GetQueryFilter(const ANavigationData& NavData, uint16 StanceMask);
+
+	/** Stances a TFPP pawn can take: standing, crouching and every stance it has a speed multiplier for. */
+	static uint16 GetStanceMask(const UTfppCharacterMovementComponent& Movement);
+
+	/**
+	 * Finds the tallest stance fitting under a ceiling.
+	 *
+	 * @param Clearance		Height between the floor and the ceiling.
+	 * @param StanceMask	Stances to choose from.
+	 * @param OutStance		The tallest stance of the mask whose clearance in the TFPP settings fits.
+	 * @return False if none fits.
+	 */
+	static bool FindStanceForClearance(float Clearance, uint16 StanceMask, ECharacterStances& OutStance);
+
+	/** Tallest stance of a mask, the one that needs no area. */
+	static bool FindTallestStance(uint16 StanceMask, ECharacterStances& OutStance);
+
+private:
+	TMap<TObjectKey<ANavigationData>, TMap<uint16, FSharedConstNavQueryFilter>> QueryFilters;
+};
+
+/**
+ * Path following switching the stance of a TFPP pawn at the boundaries of the stance areas.
+ *
+ * Entering a stance area switches to the tallest stance of the pawn fitting in it, leaving it goes back to the
+ * stance the pawn had before the first switch. Stances the pawn picked itself are left alone.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppPathFollowingComponent : public UPathFollowingComponent
+{
+	GENERATED_BODY()
+
+protected:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void SetMoveSegment(int32 SegmentStartIndex) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+private:
+	/** Applies the stance the area the segment crosses requires, or gives the pawn its own stance back. */
+	void UpdateStance(ATfppCharacter* Character, uint16 AreaFlags);
+
+	// Set while the stance of the pawn is the one a stance area required.
+	bool bStanceFromArea = false;
+	ECharacterStances StanceBeforeArea = ECharacterStances::StanceType0;
+};
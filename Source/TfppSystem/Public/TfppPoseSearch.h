@@ -0,0 +1,265 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "TfppTypes.h"
+#include "TfppPoseSearch.generated.h"
+
+class UAnimSequence;
+
+/**
+ * Node of the KD-tree used by FTfppPoseSearchIndex.
+ * Leaves reference a contiguous range of reduced points, inner nodes split their range at the median.
+ */
+USTRUCT()
+struct FTfppPoseSearchNode
+{
+	GENERATED_BODY()
+
+	// First reduced point covered by this node.
+	UPROPERTY()
+	int32 Begin = 0;
+
+	// One past the last reduced point covered by this node.
+	UPROPERTY()
+	int32 End = 0;
+
+	// Reduced feature the node splits on, INDEX_NONE for leaves.
+	UPROPERTY()
+	int32 SplitDimension = INDEX_NONE;
+
+	UPROPERTY()
+	float SplitValue = 0.f;
+
+	UPROPERTY()
+	int32 Left = INDEX_NONE;
+
+	UPROPERTY()
+	int32 Right = INDEX_NONE;
+};
+
+/**
+ * Nearest neighbour search structure over pose feature vectors.
+ *
+ * Features are standardized, so velocities in cm/s don't drown positions in cm, then reduced with PCA to a handful
+ * of dimensions and stored in a KD-tree whose leaves are laid out contiguously in memory, so a query touches a few
+ * cache lines instead of the whole database.
+ * It has no dependency on animation or rendering and can be built and searched from any thread.
+ */
+USTRUCT()
+struct TFPPSYSTEM_API FTfppPoseSearchIndex
+{
+	GENERATED_BODY()
+
+	/**
+	 * Builds the index.
+	 *
+	 * @param Features				Feature vectors, NumFeatures floats per pose, one pose after the other.
+	 * @param InNumFeatures			Size of a single feature vector.
+	 * @param InNumReducedFeatures	Number of principal components kept. Clamped to InNumFeatures.
+	 * @param LeafSize				Maximum number of poses stored in a leaf of the tree.
+	 */
+	void Build(TConstArrayView<float> Features, int32 InNumFeatures, int32 InNumReducedFeatures, int32 LeafSize = 8);
+
+	/**
+	 * Finds the pose closest to the query in the reduced feature space.
+	 *
+	 * @param Query				Feature vector with the same layout used to build the index.
+	 * @param OutDistanceSq		Optional squared distance of the best match.
+	 * @return Index of the best pose as it was passed to Build, or INDEX_NONE if the index is empty.
+	 */
+	int32 Search(TConstArrayView<float> Query, float* OutDistanceSq = nullptr) const;
+
+	/**
+	 * Same as Search but compares the query with every pose, to validate the tree.
+	 *
+	 * @param Query				Feature vector with the same layout used to build the index.
+	 * @param OutDistanceSq		Optional squared distance of the best match.
+	 * @return Index of the best pose as it was passed to Build, or INDEX_NONE if the index is empty.
+	 */
+	int32 SearchBruteForce(TConstArrayView<float> Query, float* OutDistanceSq = nullptr) const;
+
+	bool IsEmpty() const
+	{
+		return PoseIndices.IsEmpty();
+	}
+
+	int32 GetNumPoses() const
+	{
+		return PoseIndices.Num();
+	}
+
+private:
+	/** Standardizes a feature vector and projects it on the principal components. */
+	void Reduce(const float* Features, float* OutReduced) const;
+
+	int32 BuildNode(TArray<int32>& Order, const TArray<float>& Points, int32 Begin, int32 End, int32 LeafSize);
+
+	UPROPERTY()
+	int32 NumFeatures = 0;
+
+	UPROPERTY()
+	int32 NumReducedFeatures = 0;
+
+	// Mean of every feature, subtracted before projecting.
+	UPROPERTY()
+	TArray<float> Mean;
+
+	// Inverse of the standard deviation of every feature, applied before projecting.
+	UPROPERTY()
+	TArray<float> InvDeviation;
+
+	// Principal components, NumReducedFeatures rows of NumFeatures floats.
+	UPROPERTY()
+	TArray<float> Projection;
+
+	// Reduced features, NumReducedFeatures floats per pose, stored in tree order.
+	UPROPERTY()
+	TArray<float> ReducedPoints;
+
+	// Maps tree order back to the pose index passed to Build.
+	UPROPERTY()
+	TArray<int32> PoseIndices;
+
+	UPROPERTY()
+	TArray<FTfppPoseSearchNode> Nodes;
+};
+
+/**
+ * A pose stored in the locomotion database: which clip it comes from and where in it.
+ */
+USTRUCT(BlueprintType)
+struct FTfppPoseSearchEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "TFPP|Locomotion")
+	int32 ClipIndex = INDEX_NONE;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "TFPP|Locomotion")
+	float Time = 0.f;
+};
+
+/**
+ * Locomotion clips used while the character is in a given pace and stance, together with their search index.
+ */
+USTRUCT(BlueprintType)
+struct FTfppLocomotionSet
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "TFPP|Locomotion")
+	EMovementPaces Pace = EMovementPaces::PaceType0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "TFPP|Locomotion")
+	ECharacterStances Stance = ECharacterStances::StanceType0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "TFPP|Locomotion")
+	TArray<TObjectPtr<UAnimSequence>> Clips;
+
+	UPROPERTY(VisibleAnywhere, Category = "TFPP|Locomotion")
+	TArray<FTfppPoseSearchEntry> Entries;
+
+	UPROPERTY()
+	FTfppPoseSearchIndex Index;
+};
+
+/**
+ * Result of a locomotion database query.
+ */
+USTRUCT(BlueprintType)
+struct FTfppPoseSearchResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|Locomotion")
+	TObjectPtr<UAnimSequence> Clip = nullptr;
+
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|Locomotion")
+	float Time = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "TFPP|Locomotion")
+	float Cost = 0.f;
+};
+
+/**
+ * Motion matching style pose database for TFPP locomotion.
+ *
+ * Clips are grouped by pace and stance. Each group is sampled offline into trajectory features (current root
+ * velocity plus the root position at a few future times, in mesh space) which are indexed with
+ * FTfppPoseSearchIndex. At runtime the anim instance builds the same features from the character's velocity
+ * and acceleration and only searches the group matching its current pace and stance.
+ *
+ * The indices are rebuilt when the asset is saved in the editor, so nothing is sampled at runtime.
+ */
+UCLASS(BlueprintType, ClassGroup=("True First Person Perspective | Animation"))
+class TFPPSYSTEM_API UTfppLocomotionDatabase : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// Velocity plus one 2D position per trajectory horizon.
+	static constexpr int32 NumTrajectorySamples = 3;
+	static constexpr int32 NumFeatures = 2 + NumTrajectorySamples * 2;
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PreSave(FObjectPreSaveContext SaveContext) override;
+#endif
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Locomotion")
+	TArray<FTfppLocomotionSet> LocomotionSets;
+
+	/** Times in the future, in seconds, at which the root trajectory is sampled. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Features")
+	float TrajectoryHorizons[NumTrajectorySamples] = {0.2f, 0.4f, 0.6f};
+
+	/** Interval between two poses sampled from a clip. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Features", meta = (ClampMin = "0.01"))
+	float SampleInterval = 1.f / 30.f;
+
+	/** Number of principal components kept in the search index. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Features", meta = (ClampMin = "1", ClampMax = "8"))
+	int32 NumReducedFeatures = 4;
+
+	/** Time it takes the predicted trajectory to blend from the current to the desired velocity. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Setup|Features", meta = (ClampMin = "0.01"))
+	float TrajectoryResponseTime = 0.2f;
+
+	/**
+	 * Builds the query features from the current and desired velocity, both in mesh space.
+	 *
+	 * @param CurrentVelocity	Velocity of the character.
+	 * @param DesiredVelocity	Velocity the character is accelerating towards.
+	 * @param OutFeatures		Receives NumFeatures floats.
+	 */
+	void MakeQuery(const FVector& CurrentVelocity, const FVector& DesiredVelocity, TArrayView<float> OutFeatures) const;
+
+	/**
+	 * Searches the set matching the given pace and stance.
+	 *
+	 * @return False if there is no indexed set for the pace and stance.
+	 */
+	bool Search(EMovementPaces Pace, ECharacterStances Stance, TConstArrayView<float> Query, FTfppPoseSearchResult& OutResult) const;
+
+#if WITH_EDITOR
+	/** Samples every clip and rebuilds the search indices. */
+	UFUNCTION(CallInEditor, Category = "Setup|Locomotion")
+	void BuildIndices();
+#endif
+
+private:
+	void RebuildSetLookup();
+
+	// Index into LocomotionSets for every pace and stance, INDEX_NONE when there is no set.
+	int8 SetLookup[TfppTypes::NumPaces][TfppTypes::NumStances];
+};
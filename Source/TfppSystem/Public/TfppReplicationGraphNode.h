@@ -0,0 +1,88 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "TfppReplicationGraphNode.generated.h"
+
+/**
+ * Replication graph node that gathers TFPP characters by what each connection's head camera is looking at.
+ *
+ * Characters are bucketed into a 2D spatial grid every frame. For each viewer only the cells within CullDistance
+ * are visited, and every character found there is scored from its distance and from its angle to the viewer's
+ * adjusted view rotation. Characters inside the first person view cone are gathered every frame, the best scored
+ * first and up to MaxInViewPawnsPerConnection. The rest are gathered once every OutOfViewUpdateInterval frames.
+ *
+ * To use it, route ATfppCharacter (and its subclasses) to this node instead of the regular spatialization node
+ * in RouteAddNetworkActorToNodes and RouteRemoveNetworkActorToNodes of the game's replication graph, and add it
+ * as a global node. Keep OutOfViewUpdateInterval below the graph's ActorChannelFrameTimeout so throttled
+ * characters keep their channels open.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppReplicationGraphNode_FirstPersonView : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	UTfppReplicationGraphNode_FirstPersonView();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void PrepareForReplication() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Characters further than this from a viewer are never gathered for it. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Replication", meta = (ClampMin = "0.0"))
+	float CullDistance = 15000.f;
+
+	/** Size of a cell of the spatial grid. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Replication", meta = (ClampMin = "100.0"))
+	float CellSize = 5000.f;
+
+	/** Half angle of the first person view cone, in degrees. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Replication", meta = (ClampMin = "0.0", ClampMax = "180.0"))
+	float ViewConeHalfAngle = 70.f;
+
+	/** Characters closer than this are always treated as in view, whatever the viewer looks at. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Replication", meta = (ClampMin = "0.0"))
+	float AlwaysInViewDistance = 1500.f;
+
+	/** Characters outside the view cone are only gathered once every this many frames. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Replication", meta = (ClampMin = "1"))
+	int32 OutOfViewUpdateInterval = 3;
+
+	/** In view characters beyond this count are throttled like out of view ones, lowest score first. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Replication", meta = (ClampMin = "1"))
+	int32 MaxInViewPawnsPerConnection = 64;
+
+private:
+	struct FCandidate
+	{
+		AActor* Actor;
+		float Score;
+		bool bInView;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+	}
+
+	/** Location and view direction the node scores characters against for a viewer. */
+	static void GetViewerView(const FNetViewer& Viewer, FVector& OutLocation, FVector& OutDirection);
+
+	TArray<AActor*> Characters;
+	TMap<FIntPoint, TArray<AActor*>> Grid;
+
+	// Reused between gathers to avoid allocating every frame.
+	TArray<FCandidate> Candidates;
+	FActorRepListRefView GatheredActors;
+};
@@ -0,0 +1,71 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ATfppCharacter;
+
+/**
+ * State of a TFPP character kept across its destruction, when World Partition streams its cell out and back in
+ * or when a match is checkpointed.
+ *
+ * Fields are written one after the other without any reflection. Rotations use the engine short compression and
+ * the velocity is stored in single precision, a serialized snapshot takes SerializedSize bytes.
+ */
+struct TFPPSYSTEM_API FTfppCharacterSnapshot
+{
+	static constexpr int32 SerializedSize = 51;
+
+	FVector Location = FVector::ZeroVector;
+	FVector3f Velocity = FVector3f::ZeroVector;
+	uint16 ActorYaw = 0;
+	uint16 ControlPitch = 0;
+	uint16 ControlYaw = 0;
+	uint16 ViewPitch = 0;
+	uint16 ViewYaw = 0;
+	uint8 MovementMode = 0;
+	uint8 CustomMovementMode = 0;
+	uint8 Pace = 0;
+	uint8 Stance = 0;
+	uint8 Flags = 0;
+
+	enum EFlags : uint8
+	{
+		Crouched = 1 << 0,
+		HasControlRotation = 1 << 1,
+	};
+
+	/** Captures the state of a character. */
+	static FTfppCharacterSnapshot Capture(const ATfppCharacter& Character);
+
+	/**
+	 * Applies the snapshot to a character. When the character hasn't begun play yet the pace and stance are restored
+	 * without broadcasting their change events and its BeginPlay doesn't reset them, otherwise the events are
+	 * broadcast for whatever changed. Paces and stances the character doesn't have are ignored.
+	 */
+	void Apply(ATfppCharacter& Character) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FTfppCharacterSnapshot& Snapshot);
+};
+
+namespace TfppSnapshot
+{
+	/**
+	 * Saves many characters into a single buffer, one snapshot after the other in the order given.
+	 *
+	 * @param Characters	Characters to save.
+	 * @param OutData		Receives the snapshots, it is overwritten.
+	 */
+	TFPPSYSTEM_API void SaveCharacters(TConstArrayView<const ATfppCharacter*> Characters, TArray<uint8>& OutData);
+
+	/**
+	 * Restores characters from a buffer written by SaveCharacters. The characters must be given in the order they
+	 * were saved in, which is up to the caller to keep.
+	 *
+	 * @param Characters	Characters to restore, null entries are skipped.
+	 * @param Data			Buffer written by SaveCharacters.
+	 * @return False if the buffer was written by another version or doesn't hold as many snapshots as characters.
+	 */
+	TFPPSYSTEM_API bool RestoreCharacters(TConstArrayView<ATfppCharacter*> Characters, TConstArrayView<uint8> Data);
+}
@@ -0,0 +1,163 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Math/RandomStream.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TfppTypes.h"
+#include "TfppSoak.generated.h"
+
+class ATfppCharacter;
+class UTfppCharacterMovementComponent;
+class FOutputDevice;
+
+/**
+ * Drives a TFPP character like a restless player for soak runs: it churns paces and stances, crouches and uncrouches,
+ * and moves at varying angles to the view while turning, so sprints keep hitting the direction angle restrictions.
+ *
+ * The soak subsystem of the server adds it to the character of every connection. It only does something on clients
+ * started with -TfppSoakBot=<Seed>. Every decision is drawn from a random stream seeded by that value, at fixed game
+ * time intervals, so a bot makes the same decisions in every run whatever its frame rate. Pace and stance changes are
+ * applied locally and sent to the server, which doesn't get them from the movement otherwise.
+ */
+UCLASS(ClassGroup=("True First Person Perspective | Components"), NotBlueprintable)
+class TFPPSYSTEM_API UTfppSoakBotComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTfppSoakBotComponent();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Heap memory owned by this component, reported by Tfpp.MemReport. */
+	SIZE_T GetAllocatedSize() const
+	{
+		return Paces.GetAllocatedSize() + Stances.GetAllocatedSize();
+	}
+
+private:
+	/** Applies the pace and stance the bot switched to on the server. */
+	UFUNCTION(Server, Reliable)
+	void ServerSetPaceAndStance(EMovementPaces NewPace, ECharacterStances NewStance);
+
+	/** Draws the next decision from the stream, called every DecisionInterval of game time. */
+	void Decide(ATfppCharacter* Character);
+
+	// Time between two decisions, decisions only depend on the seed and on how many came before.
+	static constexpr float DecisionInterval = 0.1f;
+
+	FRandomStream Stream;
+	bool bIsBot = false;
+	float DecisionTime = 0.f;
+
+	// Paces and stances configured on the movement component, sorted so every run draws from the same lists.
+	TArray<EMovementPaces> Paces;
+	TArray<ECharacterStances> Stances;
+
+	// Current input: direction of the move relative to the view, turn rate of the view and whether it stands still.
+	float MoveAngle = 0.f;
+	float TurnRate = 0.f;
+	bool bIdle = false;
+};
+
+/**
+ * Soak harness of the server, reporting the cost of TFPP movement with bots connected over loopback.
+ *
+ * Only created with -TfppSoak on the command line. The server waits for -TfppSoakBots=<N> bots (1 by default), lets
+ * the game settle for -TfppSoakWarmup=<Seconds> (10), then measures for -TfppSoakDuration=<Seconds> (60):
+ * - the game thread time of the server frames, without the time spent waiting for the tick rate,
+ * - the bytes per second each bot connection sends and receives,
+ * - the corrections the movement components sent to the bots, apart from those sent within a round trip of the
+ *   pace and stance RPC of a bot, which the harness causes rather than the movement.
+ * The results are logged and written to -TfppSoakReport=<Path>, Saved/Profiling/TfppSoak.csv by default, as one line
+ * appended per run so runs can be compared. -TfppSoakExit quits the server when the run is over.
+ * Extras/TfppSoak/TfppSoak.py starts the server and the bots on localhost and compares runs.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppSoakSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Logs the phase of the run and the results measured so far. */
+	void DumpState(FOutputDevice& Ar) const;
+
+private:
+	enum class EPhase : uint8
+	{
+		WaitingForBots,
+		Warmup,
+		Measuring,
+		Done
+	};
+
+	/** Adds a bot component to the characters of remote players that don't have one yet. */
+	void AddBots();
+
+	struct FCorrections
+	{
+		int32 Total = 0;
+		int32 OutOfBand = 0;
+	};
+
+	/** Server corrections sent to the bots since the measure started. */
+	FCorrections CountCorrections() const;
+
+	/** Samples the traffic of every bot connection, once per second. */
+	void SampleConnections();
+
+	void StartMeasuring();
+	void FinishMeasuring();
+
+	// Formats the results as a CSV line, with its header.
+	FString GetReportHeader() const;
+	FString GetReportLine() const;
+
+	EPhase Phase = EPhase::WaitingForBots;
+	double PhaseTime = 0.0;
+
+	int32 NumBots = 1;
+	float Warmup = 10.f;
+	float Duration = 60.f;
+	bool bExitWhenDone = false;
+	FString ReportPath;
+
+	// Game thread time of every measured frame.
+	TArray<float> FrameMs;
+
+	// Traffic samples summed over the bot connections, and the number of connection samples.
+	int64 InBytesPerSecond = 0;
+	int64 OutBytesPerSecond = 0;
+	int32 MaxOutBytesPerSecond = 0;
+	int32 NumConnectionSamples = 0;
+	double NextConnectionSample = 0.0;
+
+	// Corrections every bot had when the measure started. The out of band ones follow the pace and stance RPC of the
+	// bots, they are reported apart from the corrections of the movement itself.
+	TMap<TWeakObjectPtr<const UTfppCharacterMovementComponent>, FCorrections> StartCorrections;
+	int32 NumCorrections = 0;
+	int32 NumOutOfBandCorrections = 0;
+	int32 NumMeasuredBots = 0;
+};
@@ -0,0 +1,102 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TfppSpeedValidation.generated.h"
+
+class ATfppCharacter;
+class UTfppCharacterMovementComponent;
+class FOutputDevice;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTfppSpeedViolation, ATfppCharacter*, Character, float, SpeedRatio);
+
+/**
+ * Ground movement of a pawn since its last validation, against what its pace limits allowed.
+ * Recording a move is a few additions, the comparison happens when the validation subsystem gets to the pawn.
+ */
+struct FTfppSpeedAccumulator
+{
+	// Horizontal distance moved on the ground.
+	float Distance = 0.f;
+
+	// Distance the fastest allowed pace would have covered over the same moves.
+	float AllowedDistance = 0.f;
+
+	// Time spent moving on the ground.
+	float Time = 0.f;
+
+	void Add(float MovedDistance, float DeltaTime, float SpeedLimit)
+	{
+		Distance += MovedDistance;
+		AllowedDistance += SpeedLimit * DeltaTime;
+		Time += DeltaTime;
+	}
+
+	void Reset()
+	{
+		*this = FTfppSpeedAccumulator();
+	}
+};
+
+/**
+ * Validates on the server that the TFPP characters of remote players don't move faster than their paces allow.
+ *
+ * The movement component of every such character accumulates how far it moved on the ground and how far the fastest
+ * pace allowed in its stance, mobility and surface would have taken it, whatever pace the client claims. The
+ * subsystem goes through the characters round robin, so each of them is checked once every SpeedValidationInterval
+ * whatever their number, and compares the two distances. Moves on moving bases or driven by root motion aren't
+ * recorded.
+ *
+ * Violators are reported through OnSpeedViolation and, depending on the TFPP settings, sent back to where they last
+ * passed a check. The time spent checking is reported per connection under stat Tfpp and by Tfpp.SpeedValidation.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppSpeedValidationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	void RegisterMovement(UTfppCharacterMovementComponent* Movement);
+	void UnregisterMovement(UTfppCharacterMovementComponent* Movement);
+
+	/** Broadcast for every failed check with the ratio between the distance moved and the allowed one. */
+	UPROPERTY(BlueprintAssignable, Category = "TFPP|Server")
+	FOnTfppSpeedViolation OnSpeedViolation;
+
+	/** Logs the validated characters, their violations and the cost of the validation. */
+	void DumpState(FOutputDevice& Ar) const;
+
+private:
+	struct FValidatedMovement
+	{
+		TWeakObjectPtr<UTfppCharacterMovementComponent> Movement;
+		int32 NumChecks = 0;
+		int32 NumViolations = 0;
+		float LastRatio = 0.f;
+	};
+
+	/** Compares the accumulated distances of a character and starts a new window. */
+	void Validate(FValidatedMovement& Validated);
+
+	TArray<FValidatedMovement> Movements;
+
+	// Next character to check and the fraction of a check carried over to the next tick.
+	int32 NextMovement = 0;
+	float PendingChecks = 0.f;
+
+	// Time spent checking, and time characters were validated for, to get the cost per connection.
+	double CheckSeconds = 0.0;
+	double ValidatedSeconds = 0.0;
+};
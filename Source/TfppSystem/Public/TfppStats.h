@@ -0,0 +1,125 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+/**
+ * Profiling for the True First Person Perspective system.
+ *
+ * Everything declared here is compiled out of Shipping builds, so the instrumentation can stay in the hot paths
+ * without costing anything in production. Use "stat Tfpp" to see the cycle counters and call counts in game,
+ * or the "Tfpp" CSV category and the Tfpp trace counters in Insights captures.
+ */
+
+#ifndef TFPP_WITH_PROFILING
+#define TFPP_WITH_PROFILING !UE_BUILD_SHIPPING
+#endif
+
+DECLARE_STATS_GROUP(TEXT("TFPP"), STATGROUP_Tfpp, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Tick"), STAT_TfppCharacterTick, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Calculate View Rotation"), STAT_TfppCalculateViewRotation, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Get Moving Direction"), STAT_TfppGetMovingDirection, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Set Pace"), STAT_TfppSetPace, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Set Stance"), STAT_TfppSetStance, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Movement Set Pace"), STAT_TfppMovementSetPace, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Movement Set Stance"), STAT_TfppMovementSetStance, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Is Pace Allowed On Direction Angle"), STAT_TfppIsPaceAllowedOnDirectionAngle, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pose Search"), STAT_TfppPoseSearch, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Foot Placement"), STAT_TfppFootPlacement, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Camera Collision"), STAT_TfppCameraCollision, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Replication Gather"), STAT_TfppReplicationGather, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Head History Record"), STAT_TfppHeadHistoryRecord, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Head History Rewind"), STAT_TfppHeadHistoryRewind, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Head Motion"), STAT_TfppHeadMotion, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Snapshot Save"), STAT_TfppSnapshotSave, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Snapshot Restore"), STAT_TfppSnapshotRestore, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Traversal Bake"), STAT_TfppTraversalBake, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Traversal Lookup"), STAT_TfppTraversalLookup, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Speed Validation"), STAT_TfppSpeedValidation, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Footsteps"), STAT_TfppFootsteps, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Soak Bots"), STAT_TfppSoakBots, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Stance Navigation Bake"), STAT_TfppStanceNavBake, STATGROUP_Tfpp, TFPPSYSTEM_API);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Pawns"), STAT_TfppActivePawns, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pace Transitions"), STAT_TfppPaceTransitions, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Stance Transitions"), STAT_TfppStanceTransitions, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Foot Traces"), STAT_TfppFootTraces, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Surface Resolves"), STAT_TfppSurfaceResolves, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Simulation Steps"), STAT_TfppSimulationSteps, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Camera Sweeps"), STAT_TfppCameraSweeps, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mantles"), STAT_TfppMantles, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Speed Violations"), STAT_TfppSpeedViolations, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Server Corrections"), STAT_TfppServerCorrections, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Navigation Stance Switches"), STAT_TfppNavStanceSwitches, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Footsteps Emitted"), STAT_TfppFootstepsEmitted, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Footsteps Culled"), STAT_TfppFootstepsCulled, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Footsteps Dropped"), STAT_TfppFootstepsDropped, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Anim Bundles Resident"), STAT_TfppAnimBundlesResident, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Anim Bundle Load Stalls"), STAT_TfppAnimBundleStalls, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Replicated Pawns In View"), STAT_TfppReplicatedInView, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Replicated Pawns Out Of View"), STAT_TfppReplicatedOutOfView, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Throttled Pawns"), STAT_TfppReplicationThrottled, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Anim Budget Pawns"), STAT_TfppAnimBudgetPawns, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Anim Budget Throttled Pawns"), STAT_TfppAnimBudgetThrottled, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Anim Budget Configured (ms)"), STAT_TfppAnimBudgetConfiguredMs, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Speed Validation per Connection (us)"), STAT_TfppSpeedValidationUs, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Anim Bundle Memory"), STAT_TfppAnimBundleMemory, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Head History Memory"), STAT_TfppHeadHistoryMemory, STATGROUP_Tfpp, TFPPSYSTEM_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Traversal Memory"), STAT_TfppTraversalMemory, STATGROUP_Tfpp, TFPPSYSTEM_API);
+
+#if TFPP_WITH_PROFILING && CSV_PROFILER
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(TFPPSYSTEM_API, Tfpp);
+#endif
+
+/**
+ * Scoped cycle counter that also shows up as a timing stat in the "Tfpp" CSV category.
+ *
+ * @param Stat		Name of a cycle stat declared in this file, without quotes.
+ */
+#if TFPP_WITH_PROFILING
+#define TFPP_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	CSV_SCOPED_TIMING_STAT(Tfpp, Stat)
+#else
+#define TFPP_SCOPE_CYCLE_COUNTER(Stat)
+#endif
+
+namespace TfppStats
+{
+#if TFPP_WITH_PROFILING
+	/** Counts a TFPP pawn entering play. */
+	TFPPSYSTEM_API void AddActivePawn();
+
+	/** Counts a TFPP pawn leaving play. */
+	TFPPSYSTEM_API void RemoveActivePawn();
+
+	/** Counts a pace transition for the current frame. */
+	TFPPSYSTEM_API void AddPaceTransition();
+
+	/** Counts a stance transition for the current frame. */
+	TFPPSYSTEM_API void AddStanceTransition();
+
+	/**
+	 * Counts the footstep events of this frame.
+	 *
+	 * @param Emitted	Events played.
+	 * @param Culled	Events too far from every listener to be heard.
+	 * @param Dropped	Audible events that found no audio component to play on.
+	 */
+	TFPPSYSTEM_API void AddFootstepEvents(int32 Emitted, int32 Culled, int32 Dropped);
+
+	/** Publishes the per frame counters to the CSV profiler and to trace, then resets them. Called at the end of every frame. */
+	void FlushFrameCounters();
+#else
+	inline void AddActivePawn() {}
+	inline void RemoveActivePawn() {}
+	inline void AddPaceTransition() {}
+	inline void AddStanceTransition() {}
+	inline void AddFootstepEvents(int32 Emitted, int32 Culled, int32 Dropped) {}
+	inline void FlushFrameCounters() {}
+#endif
+}
@@ -19,4 +19,11 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+	// Flushes the per frame TFPP profiling counters.
+	FDelegateHandle EndFrameHandle;
+
+	// Publishes the TFPP telemetry to shared memory.
+	FDelegateHandle TelemetryHandle;
 };
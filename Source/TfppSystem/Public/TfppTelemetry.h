@@ -0,0 +1,46 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TfppTypes.h"
+
+/**
+ * Live telemetry of the TFPP characters, published to a named shared memory region.
+ *
+ * Unlike the profiling stats it is meant for production servers, so it is compiled in every configuration of the
+ * platforms that support named shared memory and only enabled through the TFPP settings. Recording is a relaxed
+ * atomic increment, publishing is a copy of a few hundred bytes at the end of every frame.
+ * The layout of the region is described in TfppTelemetryLayout.h, Extras/TfppTelemetryReader reads it.
+ */
+
+#ifndef TFPP_WITH_TELEMETRY
+#define TFPP_WITH_TELEMETRY (PLATFORM_WINDOWS || PLATFORM_LINUX || PLATFORM_MAC)
+#endif
+
+namespace TfppTelemetry
+{
+#if TFPP_WITH_TELEMETRY
+	TFPPSYSTEM_API void AddActivePawn();
+	TFPPSYSTEM_API void RemoveActivePawn();
+	TFPPSYSTEM_API void AddPaceChange(EMovementPaces NewPace);
+	TFPPSYSTEM_API void AddStanceChange(ECharacterStances NewStance);
+	TFPPSYSTEM_API void AddSprintGateRejection();
+	TFPPSYSTEM_API void AddPitchClampHit();
+
+	/** Writes the counters to the shared memory region, opening it first if needed. Called at the end of every frame. */
+	void Publish();
+
+	/** Unmaps the shared memory region. */
+	void Shutdown();
+#else
+	inline void AddActivePawn() {}
+	inline void RemoveActivePawn() {}
+	inline void AddPaceChange(EMovementPaces NewPace) {}
+	inline void AddStanceChange(ECharacterStances NewStance) {}
+	inline void AddSprintGateRejection() {}
+	inline void AddPitchClampHit() {}
+	inline void Publish() {}
+	inline void Shutdown() {}
+#endif
+}
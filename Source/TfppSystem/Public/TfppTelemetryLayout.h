@@ -0,0 +1,167 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+// This header is shared with external readers such as Extras/TfppTelemetryReader, it must not depend on the engine.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Layout of the TFPP telemetry shared memory region.
+ *
+ * The region is a header followed by a payload. The game is the only writer and never waits on readers: it makes
+ * Sequence odd, copies the whole payload and makes Sequence even again. A reader copies the payload between two
+ * reads of an even and identical Sequence, and retries otherwise. The checksum lets a reader verify the copy.
+ * Both sides of the protocol are implemented below, so the game, the reader and the tests share them.
+ *
+ * Counters are totals since the region was created. Any change to this layout has to bump TfppTelemetryVersion.
+ */
+constexpr uint32_t TfppTelemetryMagic = 0x50504654; // "TFPP"
+constexpr uint32_t TfppTelemetryVersion = 1;
+constexpr int32_t TfppTelemetryNumPaces = 10;
+constexpr int32_t TfppTelemetryNumStances = 10;
+constexpr int32_t TfppTelemetryNumHistogramBuckets = 8;
+
+struct FTfppTelemetryHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	// Size of the whole region in bytes.
+	uint32_t Size;
+	// Odd while the payload is being written.
+	std::atomic<uint32_t> Sequence;
+};
+
+// The region is shared between processes, the sequence has to be a plain lock free word in it
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "The telemetry sequence must be lock free to live in shared memory.");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The telemetry sequence must keep the size of a uint32_t.");
+
+struct FTfppTelemetryPayload
+{
+	uint64_t Frame;
+	double TimeSeconds;
+
+	uint64_t ActivePawns;
+
+	// Number of times each pace and each stance was entered.
+	uint64_t PacesEntered[TfppTelemetryNumPaces];
+	uint64_t StancesEntered[TfppTelemetryNumStances];
+
+	// Pace changes refused because the movement direction was outside the angle restriction of the pace.
+	uint64_t SprintGateRejections;
+
+	// View rotation updates whose pitch had to be clamped to the pitch range.
+	uint64_t PitchClampHits;
+
+	// Frames by number of stance transitions in them: bucket 0 counts frames without any, bucket N frames with
+	// 2^(N-1) to 2^N - 1 of them, the last bucket everything above.
+	uint64_t StanceTransitionsPerFrame[TfppTelemetryNumHistogramBuckets];
+
+	// FNV-1a of every byte above.
+	uint64_t Checksum;
+};
+
+struct FTfppTelemetryRegion
+{
+	FTfppTelemetryHeader Header;
+	FTfppTelemetryPayload Payload;
+};
+
+inline uint64_t TfppTelemetryChecksum(const FTfppTelemetryPayload& Payload)
+{
+	const unsigned char* Bytes = reinterpret_cast<const unsigned char*>(&Payload);
+	uint64_t Hash = 14695981039346656037ull;
+	for (size_t Index = 0; Index < offsetof(FTfppTelemetryPayload, Checksum); ++Index)
+	{
+		Hash = (Hash ^ Bytes[Index]) * 1099511628211ull;
+	}
+	return Hash;
+}
+
+/** Publishes a payload. Only one thread may write a region. */
+inline void TfppTelemetryWrite(FTfppTelemetryRegion& Region, const FTfppTelemetryPayload& Payload)
+{
+	const uint32_t Sequence = Region.Header.Sequence.load(std::memory_order_relaxed);
+	Region.Header.Sequence.store(Sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(&Region.Payload, &Payload, sizeof(Payload));
+	Region.Header.Sequence.store(Sequence + 2, std::memory_order_release);
+}
+
+/**
+ * Copies the payload out of a region.
+ *
+ * @return False if the writer was busy and the copy has to be retried.
+ */
+inline bool TfppTelemetryTryRead(const FTfppTelemetryRegion& Region, FTfppTelemetryPayload& OutPayload)
+{
+	const uint32_t Before = Region.Header.Sequence.load(std::memory_order_acquire);
+	if ((Before & 1) != 0)
+	{
+		return false;
+	}
+	std::memcpy(&OutPayload, &Region.Payload, sizeof(OutPayload));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return Region.Header.Sequence.load(std::memory_order_relaxed) == Before;
+}
+
+/**
+ * Checks a snapshot against its checksum and against a snapshot read before it: counters never decrease and the
+ * frame never goes backwards.
+ *
+ * @return What is wrong with the snapshot, or nullptr if it is consistent.
+ */
+inline const char* TfppTelemetryFindInconsistency(const FTfppTelemetryPayload& Previous, const FTfppTelemetryPayload& Current)
+{
+	if (TfppTelemetryChecksum(Current) != Current.Checksum)
+	{
+		return "checksum mismatch";
+	}
+	if (Current.Frame < Previous.Frame)
+	{
+		return "frame went backwards";
+	}
+	if (Current.SprintGateRejections < Previous.SprintGateRejections)
+	{
+		return "SprintGateRejections decreased";
+	}
+	if (Current.PitchClampHits < Previous.PitchClampHits)
+	{
+		return "PitchClampHits decreased";
+	}
+	for (int32_t Index = 0; Index < TfppTelemetryNumPaces; ++Index)
+	{
+		if (Current.PacesEntered[Index] < Previous.PacesEntered[Index])
+		{
+			return "PacesEntered decreased";
+		}
+	}
+	for (int32_t Index = 0; Index < TfppTelemetryNumStances; ++Index)
+	{
+		if (Current.StancesEntered[Index] < Previous.StancesEntered[Index])
+		{
+			return "StancesEntered decreased";
+		}
+	}
+	for (int32_t Index = 0; Index < TfppTelemetryNumHistogramBuckets; ++Index)
+	{
+		if (Current.StanceTransitionsPerFrame[Index] < Previous.StanceTransitionsPerFrame[Index])
+		{
+			return "StanceTransitionsPerFrame decreased";
+		}
+	}
+	return nullptr;
+}
+
+inline int32_t TfppTelemetryHistogramBucket(uint64_t Count)
+{
+	int32_t Bucket = 0;
+	while (Count > 0 && Bucket < TfppTelemetryNumHistogramBuckets - 1)
+	{
+		Count >>= 1;
+		++Bucket;
+	}
+	return Bucket;
+}
@@ -0,0 +1,105 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TfppTypes.h"
+#include "TfppTransitionGraph.generated.h"
+
+/**
+ * Transition rules of a single stance, configured in the TFPP settings.
+ */
+USTRUCT(BlueprintType)
+struct FTfppStanceTransitionRules
+{
+	GENERATED_BODY()
+
+	/** Paces the character may use while in this stance. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement", meta = (Bitmask, BitmaskEnum = "/Script/TfppSystem.EMovementPaces"))
+	int32 AllowedPaces = 0x3FF;
+
+	/** Stances the character may switch to from this stance. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement", meta = (Bitmask, BitmaskEnum = "/Script/TfppSystem.ECharacterStances"))
+	int32 AllowedNextStances = 0x3FF;
+};
+
+/**
+ * Transition rules of a single mobility, configured in the TFPP settings.
+ */
+USTRUCT(BlueprintType)
+struct FTfppMobilityTransitionRules
+{
+	GENERATED_BODY()
+
+	/** Stances the character may be in while using this mobility. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement", meta = (Bitmask, BitmaskEnum = "/Script/TfppSystem.ECharacterStances"))
+	int32 AllowedStances = 0x3FF;
+
+	/** Paces the character may use while using this mobility. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Movement", meta = (Bitmask, BitmaskEnum = "/Script/TfppSystem.EMovementPaces"))
+	int32 AllowedPaces = 0x3FF;
+};
+
+/**
+ * Transition graph over stances, paces and mobilities, compiled into fixed size bitmask tables.
+ *
+ * A state is a stance and a pace within a mobility. Entering a stance requires an edge from the current stance
+ * and the stance to be allowed by the mobility, a pace is usable when both the stance and the mobility allow it.
+ * Every query is a couple of table reads and bit operations, so AI planners can call them as often as they need.
+ *
+ * Paces are expected to be declared from slowest to fastest, which is what "best allowed pace" relies on.
+ */
+struct TFPPSYSTEM_API FTfppTransitionTable
+{
+	FTfppTransitionTable();
+
+	/**
+	 * Compiles the configured rules. Stances and mobilities without rules allow everything.
+	 */
+	void Build(const TMap<ECharacterStances, FTfppStanceTransitionRules>& StanceRules, const TMap<EMobilities, FTfppMobilityTransitionRules>& MobilityRules);
+
+	/** Table compiled from the TFPP settings. */
+	static const FTfppTransitionTable& Get();
+
+	bool CanEnterStance(EMobilities Mobility, ECharacterStances FromStance, ECharacterStances ToStance) const
+	{
+		return (GetReachableStances(Mobility, FromStance) & StanceBit(ToStance)) != 0;
+	}
+
+	bool CanUsePace(EMobilities Mobility, ECharacterStances Stance, EMovementPaces Pace) const
+	{
+		return (GetAllowedPaces(Mobility, Stance) & PaceBit(Pace)) != 0;
+	}
+
+	/** Stances that can be entered from the given stance, as a bitmask indexed by ECharacterStances. */
+	uint16 GetReachableStances(EMobilities Mobility, ECharacterStances FromStance) const
+	{
+		return StanceNextStances[Index(FromStance)] & MobilityStances[Index(Mobility)];
+	}
+
+	/** Paces usable in the given stance, as a bitmask indexed by EMovementPaces. */
+	uint16 GetAllowedPaces(EMobilities Mobility, ECharacterStances Stance) const
+	{
+		return StancePaces[Index(Stance)] & MobilityPaces[Index(Mobility)];
+	}
+
+	/**
+	 * Finds the fastest allowed pace that isn't faster than the requested one.
+	 * Falls back to the slowest allowed pace when every allowed pace is faster than the requested one.
+	 *
+	 * @return False if no pace at all is allowed in the given stance and mobility.
+	 */
+	bool GetBestAllowedPace(EMobilities Mobility, ECharacterStances Stance, EMovementPaces RequestedPace, EMovementPaces& OutPace) const;
+
+private:
+	static uint8 Index(ECharacterStances Stance) { return static_cast<uint8>(Stance); }
+	static uint8 Index(EMovementPaces Pace) { return static_cast<uint8>(Pace); }
+	static uint8 Index(EMobilities Mobility) { return static_cast<uint8>(Mobility); }
+	static uint16 StanceBit(ECharacterStances Stance) { return static_cast<uint16>(1u << Index(Stance)); }
+	static uint16 PaceBit(EMovementPaces Pace) { return static_cast<uint16>(1u << Index(Pace)); }
+
+	uint16 StancePaces[TfppTypes::NumStances];
+	uint16 StanceNextStances[TfppTypes::NumStances];
+	uint16 MobilityStances[TfppTypes::NumMobilities];
+	uint16 MobilityPaces[TfppTypes::NumMobilities];
+};
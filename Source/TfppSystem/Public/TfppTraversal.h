@@ -0,0 +1,273 @@
+﻿// Copyright (c) 2025, Balbjorn Bran. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Volume.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TfppTraversal.generated.h"
+
+/**
+ * A ledge that can be mantled, baked from the level geometry.
+ * Long ledges are split so no edge is longer than the cell size of the index that holds it.
+ */
+USTRUCT()
+struct FTfppTraversalEdge
+{
+	GENERATED_BODY()
+
+	// Ends of the ledge, at the height of its top.
+	UPROPERTY()
+	FVector3f Start = FVector3f::ZeroVector;
+
+	UPROPERTY()
+	FVector3f End = FVector3f::ZeroVector;
+
+	// Horizontal direction pointing from the ledge towards the side it is climbed from.
+	UPROPERTY()
+	FVector2f Normal = FVector2f::ZeroVector;
+
+	// Height of the top above the floor it is climbed from.
+	UPROPERTY()
+	float Height = 0.f;
+
+	// Depth of the top before it drops again, 0 when the obstacle is too deep to be vaulted.
+	UPROPERTY()
+	float Depth = 0.f;
+
+	// Drop from the top to the floor behind the obstacle when it can be vaulted.
+	UPROPERTY()
+	float LandingDrop = 0.f;
+
+	bool IsVaultable() const
+	{
+		return Depth > 0.f;
+	}
+};
+
+/** Range of the edges of FTfppTraversalIndex filed under a cell. */
+USTRUCT()
+struct FTfppTraversalCell
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Begin = 0;
+
+	UPROPERTY()
+	int32 Num = 0;
+};
+
+/** What a pawn looks for in FTfppTraversalIndex::FindEdge. */
+struct FTfppTraversalQuery
+{
+	// Bottom of the pawn.
+	FVector Location = FVector::ZeroVector;
+
+	// Horizontal, normalized direction the pawn wants to move in.
+	FVector Direction = FVector::ForwardVector;
+
+	// Maximum horizontal distance from Location to the ledge.
+	float Reach = 0.f;
+
+	// Range of ledge heights above Location.
+	float MinHeight = 0.f;
+	float MaxHeight = 0.f;
+
+	// Cosine of the maximum angle between Direction and the ledge.
+	float MinFacing = 0.f;
+};
+
+/** Edge found by FTfppTraversalIndex::FindEdge. */
+struct FTfppTraversalHit
+{
+	FTfppTraversalEdge Edge;
+
+	// Point of the ledge closest to the pawn.
+	FVector Point = FVector::ZeroVector;
+};
+
+/**
+ * Spatial hash of baked traversal edges.
+ *
+ * Edges are filed under the 3D cell of their middle and sorted by cell, so a lookup visits a handful of cells and
+ * reads contiguous edges from each of them. It is built offline and never changes at runtime.
+ */
+USTRUCT()
+struct TFPPSYSTEM_API FTfppTraversalIndex
+{
+	GENERATED_BODY()
+
+	/**
+	 * Builds the index.
+	 *
+	 * @param InEdges		Edges to index, none of them longer than InCellSize.
+	 * @param InCellSize	Size of a cell of the spatial hash.
+	 */
+	void Build(TArray<FTfppTraversalEdge>&& InEdges, float InCellSize);
+
+	/**
+	 * Finds the closest ledge in front of a pawn.
+	 *
+	 * @param Query		Where the pawn is and which ledges it can climb.
+	 * @param OutHit	The closest ledge matching the query.
+	 * @return True if a ledge was found.
+	 */
+	bool FindEdge(const FTfppTraversalQuery& Query, FTfppTraversalHit& OutHit) const;
+
+	int32 GetNumEdges() const
+	{
+		return Edges.Num();
+	}
+
+	int32 GetNumCells() const
+	{
+		return Cells.Num();
+	}
+
+	const TArray<FTfppTraversalEdge>& GetEdges() const
+	{
+		return Edges;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Edges.GetAllocatedSize() + Cells.GetAllocatedSize();
+	}
+
+private:
+	FIntVector GetCell(const FVector& Location) const
+	{
+		return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize),
+			FMath::FloorToInt(Location.Z / CellSize));
+	}
+
+	UPROPERTY()
+	float CellSize = 400.f;
+
+	UPROPERTY()
+	TArray<FTfppTraversalEdge> Edges;
+
+	UPROPERTY()
+	TMap<FIntVector, FTfppTraversalCell> Cells;
+};
+
+/**
+ * Volume holding the traversal edges baked from the static geometry inside it.
+ *
+ * The bake traces a grid of vertical rays over the volume to build a heightfield of its walkable tops, and turns
+ * every drop between MinLedgeHeight and MaxLedgeHeight into a ledge. Only the highest walkable surface of every
+ * sample is seen, ledges under overhangs need a volume of their own. Bake again whenever the geometry changes,
+ * the runtime never traces for ledges, it only confirms that the pawn fits along its way up and where it lands.
+ */
+UCLASS()
+class TFPPSYSTEM_API ATfppTraversalVolume : public AVolume
+{
+	GENERATED_BODY()
+
+public:
+	ATfppTraversalVolume();
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	/** Distance between two rays of the bake. Walls thinner than this may be missed. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Traversal", meta = (ClampMin = "5.0", Units = "cm"))
+	float SampleSpacing = 25.f;
+
+	/** Size of a cell of the spatial hash, and maximum length of a baked edge. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Traversal", meta = (ClampMin = "50.0", Units = "cm"))
+	float CellSize = 400.f;
+
+	/** Lower drops are left to the step up of the movement component. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Traversal", meta = (ClampMin = "0.0", Units = "cm"))
+	float MinLedgeHeight = 40.f;
+
+	UPROPERTY(EditAnywhere, Category = "Setup|Traversal", meta = (ClampMin = "0.0", Units = "cm"))
+	float MaxLedgeHeight = 250.f;
+
+	/** Obstacles whose top is at most this deep can be vaulted. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Traversal", meta = (ClampMin = "0.0", Units = "cm"))
+	float MaxVaultDepth = 80.f;
+
+	/** Minimum Z of the normal of a surface for a pawn to stand on it. */
+	UPROPERTY(EditAnywhere, Category = "Setup|Traversal", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float WalkableFloorZ = 0.71f;
+
+	UPROPERTY(EditAnywhere, Category = "Setup|Traversal")
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** Bakes the edges of the geometry inside the volume. */
+	UFUNCTION(CallInEditor, Category = "Setup|Traversal")
+	void Bake();
+
+	/** Bakes the edges of the geometry inside a box instead of the volume, for volumes spawned without a brush. */
+	void BakeBounds(const FBox& Bounds);
+
+	/**
+	 * Traces the geometry inside the volume for ledges without touching the baked data.
+	 *
+	 * @param OutEdges	Ledges found, none longer than CellSize.
+	 */
+	void BakeEdges(TArray<FTfppTraversalEdge>& OutEdges) const;
+
+	/** Traces the geometry inside a box for ledges without touching the baked data. */
+	void BakeEdges(const FBox& Bounds, TArray<FTfppTraversalEdge>& OutEdges) const;
+
+	const FTfppTraversalIndex& GetIndex() const
+	{
+		return Index;
+	}
+
+	/** Bounds of the volume when it was baked. */
+	const FBox& GetBakedBounds() const
+	{
+		return BakedBounds;
+	}
+
+private:
+	UPROPERTY()
+	FTfppTraversalIndex Index;
+
+	UPROPERTY()
+	FBox BakedBounds = FBox(ForceInit);
+};
+
+/**
+ * Answers the traversal lookups of the pawns from the traversal volumes of the world.
+ */
+UCLASS()
+class TFPPSYSTEM_API UTfppTraversalSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// ----------------------------------------------------------------------------------------------------------------
+	// Begin Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// ----------------------------------------------------------------------------------------------------------------
+	// End Overriden Parent Functions
+	// ----------------------------------------------------------------------------------------------------------------
+
+	void RegisterVolume(ATfppTraversalVolume* Volume);
+	void UnregisterVolume(ATfppTraversalVolume* Volume);
+
+	/**
+	 * Finds the closest ledge in front of a pawn in every volume around it.
+	 *
+	 * @param Query		Where the pawn is and which ledges it can climb.
+	 * @param OutHit	The closest ledge matching the query.
+	 * @return True if a ledge was found.
+	 */
+	bool FindEdge(const FTfppTraversalQuery& Query, FTfppTraversalHit& OutHit) const;
+
+private:
+	TArray<TWeakObjectPtr<ATfppTraversalVolume>> Volumes;
+};
@@ -79,3 +79,13 @@ enum class EMobilities : uint8
 	MobilityType18 UMETA(Hidden),
 	MobilityType19 UMETA(Hidden),
 };
+
+/**
+ * Number of values in each of the enums above, used to size lookup tables indexed by them.
+ */
+namespace TfppTypes
+{
+	constexpr int32 NumStances = 10;
+	constexpr int32 NumPaces = 10;
+	constexpr int32 NumMobilities = 20;
+}
@@ -25,9 +25,12 @@ public class TfppSystem : ModuleRules
 		PublicDependencyModuleNames.AddRange(
 			new string[]
 			{
+				"AIModule",
 				"Core",
 				"DeveloperSettings",
-				"GameplayTags"
+				"GameplayTags",
+				"NavigationSystem",
+				"ReplicationGraph"
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -36,6 +39,7 @@ public class TfppSystem : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
+				"AnimationBudgetAllocator",
 				"CoreUObject",
 				"Engine",
 				"Slate",